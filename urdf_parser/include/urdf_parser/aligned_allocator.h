@@ -0,0 +1,70 @@
+#ifndef URDF_PARSER_ALIGNED_ALLOCATOR_H
+#define URDF_PARSER_ALIGNED_ALLOCATOR_H
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+namespace urdf{
+
+/// Allocator returning storage aligned to Alignment bytes, so that the
+/// batched kernels can use full-width vector loads on std::vector buffers.
+template <typename T, std::size_t Alignment = 64>
+class AlignedAllocator
+{
+public:
+  typedef T value_type;
+
+  template <typename U>
+  struct rebind
+  {
+    typedef AlignedAllocator<U, Alignment> other;
+  };
+
+  AlignedAllocator() {}
+  template <typename U>
+  AlignedAllocator(const AlignedAllocator<U, Alignment> &) {}
+
+  T *allocate(std::size_t n)
+  {
+    if (n == 0)
+      return nullptr;
+    void *p = nullptr;
+#ifdef _WIN32
+    p = _aligned_malloc(n * sizeof(T), Alignment);
+#else
+    if (posix_memalign(&p, Alignment, n * sizeof(T)) != 0)
+      p = nullptr;
+#endif
+    if (!p)
+      throw std::bad_alloc();
+    return static_cast<T *>(p);
+  }
+
+  void deallocate(T *p, std::size_t)
+  {
+#ifdef _WIN32
+    _aligned_free(p);
+#else
+    free(p);
+#endif
+  }
+};
+
+template <typename T, typename U, std::size_t A>
+bool operator==(const AlignedAllocator<T, A> &, const AlignedAllocator<U, A> &) { return true; }
+
+template <typename T, typename U, std::size_t A>
+bool operator!=(const AlignedAllocator<T, A> &, const AlignedAllocator<U, A> &) { return false; }
+
+/// Cache-line aligned vector of doubles used for structure-of-arrays data.
+typedef std::vector<double, AlignedAllocator<double> > AlignedDoubleVector;
+
+}
+
+#endif
@@ -0,0 +1,95 @@
+#ifndef URDF_PARSER_CAMERA_MODEL_H
+#define URDF_PARSER_CAMERA_MODEL_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include <urdf_sensor/sensor.h>
+
+#include "exportdecl.h"
+
+namespace urdf{
+
+/// Pinhole projection derived once from a Camera description.
+///
+/// Points are given in the optical frame of the sensor (z forward, x right,
+/// y down).  Pixel coordinates run from (0, 0) at the top left corner of the
+/// image to (width, height) at the bottom right, with square pixels, so
+///   fx = fy = width / (2 tan(hfov / 2)),  cx = width / 2,  cy = height / 2.
+///
+/// The batch kernels work on structure-of-arrays inputs and outputs.
+class URDFDOM_DLLAPI CameraModel
+{
+public:
+  /// A point p is on the inner side of a plane when
+  /// normal[0] p.x + normal[1] p.y + normal[2] p.z + offset >= 0.
+  struct Plane
+  {
+    double normal[3];
+    double offset;
+  };
+
+  enum
+  {
+    NEAR_PLANE,
+    FAR_PLANE,
+    LEFT_PLANE,
+    RIGHT_PLANE,
+    TOP_PLANE,
+    BOTTOM_PLANE,
+    PLANE_COUNT
+  };
+
+  CameraModel() { this->clear(); }
+
+  /// Returns false if camera has an empty image, an hfov outside (0, pi)
+  /// or clip distances that do not satisfy 0 < near < far.
+  bool init(const Camera &camera);
+
+  /// Builds the model of a camera sensor.
+  bool init(const Sensor &sensor);
+
+  void clear();
+
+  unsigned int width() const { return width_; }
+  unsigned int height() const { return height_; }
+  double fx() const { return fx_; }
+  double fy() const { return fy_; }
+  double cx() const { return cx_; }
+  double cy() const { return cy_; }
+  double nearClip() const { return near_; }
+  double farClip() const { return far_; }
+  double verticalFov() const { return vfov_; }
+
+  /// Frustum planes with inward normals, indexed by the *_PLANE values.
+  const Plane &plane(std::size_t i) const { return planes_[i]; }
+
+  /// Projects count points to pixel coordinates.  Points with z <= 0 get
+  /// NaN coordinates.
+  void project(std::size_t count, const double *x, const double *y, const double *z,
+               double *u, double *v) const;
+
+  /// Lifts count pixels with the given depths (distance along z) to points.
+  void unproject(std::size_t count, const double *u, const double *v, const double *depth,
+                 double *x, double *y, double *z) const;
+
+  /// Sets inside[i] to 1 for the points within the view frustum, 0 for the
+  /// others, and returns the number of points inside.
+  std::size_t cull(std::size_t count, const double *x, const double *y, const double *z,
+                   uint8_t *inside) const;
+
+  /// Same, testing only the near and far clip distances.
+  std::size_t cullDepth(std::size_t count, const double *z, uint8_t *inside) const;
+
+private:
+  unsigned int width_;
+  unsigned int height_;
+  double fx_, fy_, cx_, cy_;
+  double near_, far_;
+  double vfov_;
+  Plane planes_[PLANE_COUNT];
+};
+
+}
+
+#endif
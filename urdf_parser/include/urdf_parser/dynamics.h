@@ -0,0 +1,267 @@
+#ifndef URDF_PARSER_DYNAMICS_H
+#define URDF_PARSER_DYNAMICS_H
+
+#include <cstddef>
+#include <vector>
+
+#include <urdf_model/model.h>
+
+#include "aligned_allocator.h"
+#include "exportdecl.h"
+#include "kinematics.h"
+
+namespace urdf{
+
+/// Inertia of a body about its origin, in its own frame.  These are the ten
+/// parameters the dynamics depend on linearly: the mass m, the first moment
+/// h = m c of the center of mass c, and the rotational inertia I about the
+/// body origin, stored as (xx, xy, xz, yy, yz, zz).
+struct SpatialInertia
+{
+  double mass;
+  double h[3];
+  double I[6];
+
+  void setZero()
+  {
+    mass = 0.0;
+    h[0] = h[1] = h[2] = 0.0;
+    for (int k = 0; k < 6; ++k)
+      I[k] = 0.0;
+  }
+};
+
+class DynamicsData;
+class ClusterBlockMatrix;
+
+/// Rigid body dynamics of a ModelInterface on top of its KinematicModel.
+///
+/// Bodies are grouped by the clusters ModelInterface derives from its loop
+/// and coupling constraints: the bodies of a cluster move together, and
+/// the mass matrix and its factorization are stored in blocks of them.
+/// Clusters are numbered so that a parent
+/// cluster comes before its children, and order() lists the bodies
+/// cluster by cluster, depth first within a cluster, so per body data
+/// stored in that order is contiguous for every cluster.  Links without a
+/// cluster, or models without constraints, give one cluster per body.
+///
+/// Coordinates are those of the spanning tree, in the q/v layout of
+/// KinematicModel.  Spatial vectors are (angular, linear), in body frames.
+class URDFDOM_DLLAPI DynamicsModel
+{
+public:
+  struct Cluster
+  {
+    /// Parent cluster, -1 for the cluster of the root link.
+    int parent;
+    /// The bodies of the cluster are order()[first, end).
+    std::size_t first, end;
+    /// Number of spanning tree velocity coordinates of the bodies, which
+    /// are velocityOrder()[v_first, v_first + v_size).
+    std::size_t v_first, v_size;
+    /// Number of ancestor clusters.
+    std::size_t depth;
+  };
+
+  DynamicsModel() { this->clear(); }
+
+  /// Compiles the kinematics, inertias and clusters of model.  Returns
+  /// false if the kinematics cannot be compiled or a cluster is entered
+  /// from more than one parent cluster.
+  bool init(const ModelInterface &model);
+
+  void clear();
+
+  const KinematicModel &kinematics() const { return kinematics_; }
+
+  std::size_t clusterCount() const { return clusters_.size(); }
+  const Cluster &cluster(std::size_t c) const { return clusters_[c]; }
+  /// Cluster of body i.
+  std::size_t clusterOf(std::size_t i) const { return cluster_of_[i]; }
+
+  /// Bodies in cluster order, and the position of each body in it.
+  const std::vector<std::size_t> &order() const { return order_; }
+  std::size_t slot(std::size_t i) const { return slot_[i]; }
+  /// Velocity coordinates in cluster order.
+  const std::vector<std::size_t> &velocityOrder() const { return velocity_order_; }
+
+  const SpatialInertia &inertia(std::size_t i) const { return inertias_[i]; }
+
+  /// Motion subspace of velocity coordinate k: the spatial velocity, in the
+  /// frame of the body it moves, produced by a unit value of v[k].
+  const double *motionSubspace(std::size_t k) const { return &subspace_[6 * k]; }
+
+  /// Gravity acceleration in the root frame, (0, 0, -9.81) by default.
+  void setGravity(const double *gravity);
+  const double *gravity() const { return gravity_; }
+
+  /// Recursive Newton-Euler inverse dynamics: the generalized forces tau
+  /// that give acceleration a at configuration q and velocity v, including
+  /// gravity.  One forward and one backward pass over the bodies, one body
+  /// at a time; the clusters only set the order in which the bodies are
+  /// visited and their data stored.  The forces are those of the spanning
+  /// tree coordinates, without loop closure forces: for a constrained
+  /// model, IndependentCoordinateMap::inverseDynamics() gives those of the
+  /// independent coordinates.
+  void inverseDynamics(DynamicsData &data, const double *q, const double *v, const double *a, double *tau) const;
+
+  /// The generalized gravity forces g(q): the inverse dynamics at zero
+  /// velocity and acceleration, which hold the model still.  With the
+  /// subtree masses precomputed, one forward pass expresses gravity in
+  /// every body and one backward pass sums the first moments of mass of the
+  /// subtrees, three vectors per body rather than spatial inertias.
+  void gravityTorques(DynamicsData &data, const double *q, double *tau) const;
+
+  /// Mass of the subtree of body i, and of the whole model.
+  double subtreeMass(std::size_t i) const { return subtree_mass_[i]; }
+  double totalMass() const { return subtree_mass_.empty() ? 0.0 : subtree_mass_[0]; }
+
+  /// Articulated body algorithm: the accelerations a of the spanning tree
+  /// at configuration q and velocity v under generalized forces tau and
+  /// gravity, in three O(n) passes over the bodies.  Floating and planar
+  /// joints are solved as blocks of their degrees of freedom.  Loop and
+  /// coupling constraints are not enforced, so this is the forward dynamics
+  /// of tree-structured models.  Does not allocate.  Returns false if the
+  /// inertia a joint moves is singular, as for a massless subtree.
+  bool forwardDynamics(DynamicsData &data, const double *q, const double *v, const double *tau, double *a) const;
+
+  /// The center of mass com[3] of the model in the root frame and, unless J
+  /// is NULL, its Jacobian J, row-major 3 x velocitySize(), with the
+  /// velocity of com = J v.  A forward pass places the first moment of mass
+  /// of every body in the root frame and a backward pass sums them over the
+  /// subtrees; a coordinate of body i then moves the subtree mass
+  /// subtreeMass(i) about its joint.  Zero for a massless model.
+  void centerOfMass(DynamicsData &data, const double *q, double *com, double *J = NULL) const;
+
+  /// The inertial parameters pi[10 * bodyCount()] of all bodies, ten per
+  /// body in the order of SpatialInertia: mass, h, then I.
+  void inertialParameters(double *pi) const;
+  /// Replaces the inertias of all bodies by pi, as identified for example.
+  void setInertialParameters(const double *pi);
+  /// Writes pi back to the Inertial of every link of model, which this was
+  /// compiled from: the center of mass h / mass and the inertia about it,
+  /// in an unrotated inertial frame.  Links whose parameters are all zero
+  /// lose their Inertial.  Returns false, leaving model unchanged, if a
+  /// body with parameters has no positive mass.
+  bool writeInertialParameters(const double *pi, ModelInterface &model) const;
+
+  /// The inertial parameter regressor: Y, row-major velocitySize() x
+  /// 10 bodyCount(), with inverseDynamics() = Y pi for the parameters pi of
+  /// inertialParameters().  Column 10 i + p holds the forces due to
+  /// parameter p of body i, nonzero only in the rows of its ancestors.
+  void regressor(DynamicsData &data, const double *q, const double *v, const double *a, double *Y) const;
+  /// The regressors of count samples stored one after another, computed on
+  /// up to threads threads (0: one per hardware thread).
+  void regressors(std::size_t count, const double *q, const double *v, const double *a, double *Y,
+                  unsigned int threads = 0) const;
+
+  /// Composite rigid body algorithm: the joint space mass matrix M at
+  /// configuration q, written block by block to M, which must have been
+  /// resized for this model.  Only the blocks between a cluster and its
+  /// ancestors are computed.
+  void massMatrix(DynamicsData &data, const double *q, ClusterBlockMatrix &M) const;
+
+private:
+  // the forward pass of the Newton-Euler recursion: the joint transforms,
+  // velocities and accelerations (with gravity) of all bodies in data
+  void motionPass(DynamicsData &data, const double *q, const double *v, const double *a) const;
+
+  KinematicModel kinematics_;
+  std::vector<Cluster> clusters_;
+  std::vector<std::size_t> cluster_of_;
+  std::vector<std::size_t> order_;
+  std::vector<std::size_t> slot_;
+  std::vector<std::size_t> velocity_order_;
+  std::vector<SpatialInertia> inertias_;
+  std::vector<double> subtree_mass_;
+  std::vector<double> subspace_;
+  double gravity_[3];
+};
+
+/// Work space of the DynamicsModel algorithms, sized once for a model so
+/// that the algorithms do not allocate.  Each thread uses its own.  Body
+/// quantities are stored in DynamicsModel::order(), six values per body.
+class URDFDOM_DLLAPI DynamicsData
+{
+public:
+  DynamicsData() {}
+  explicit DynamicsData(const DynamicsModel &model) { this->resize(model); }
+
+  void resize(const DynamicsModel &model);
+
+  /// Pose of each body in its parent, and in the root frame.
+  std::vector<RigidTransform> local;
+  std::vector<RigidTransform> world;
+  /// Spatial velocity, acceleration and force of each body.
+  std::vector<double> velocity;
+  std::vector<double> acceleration;
+  std::vector<double> force;
+  /// Inertia of the subtree of each body, about its origin.
+  std::vector<SpatialInertia> composite;
+  /// Articulated body algorithm storage: the 6x6 articulated inertia of
+  /// each body, row-major, padded to 40 values so that every body starts on
+  /// a cache line; and per velocity coordinate k, U = I^A S_k and the
+  /// inverse of the joint inertia S^T I^A S of its body, six values each.
+  AlignedDoubleVector articulated_inertia;
+  AlignedDoubleVector joint_inertia;
+  AlignedDoubleVector joint_inverse;
+};
+
+/// A symmetric matrix over the velocity coordinates of a DynamicsModel,
+/// stored as dense blocks between each cluster and its ancestors, which is
+/// where the mass matrix of a tree can be nonzero.  Cluster c has
+/// depth + 1 blocks: block k couples the coordinates of c (rows) with
+/// those of its k-th ancestor (columns), k = 0 being the full diagonal
+/// block.  Blocks are row-major, with rows and columns in the order of
+/// DynamicsModel::velocityOrder(); their transposes above the diagonal are
+/// not stored.
+class URDFDOM_DLLAPI ClusterBlockMatrix
+{
+public:
+  ClusterBlockMatrix() {}
+  explicit ClusterBlockMatrix(const DynamicsModel &model) { this->resize(model); }
+
+  void resize(const DynamicsModel &model);
+  void setZero();
+
+  std::size_t size() const { return velocity_order_.size(); }
+  std::size_t clusterCount() const { return parent_.size(); }
+  std::size_t blockCount(std::size_t c) const { return block_begin_[c + 1] - block_begin_[c]; }
+  /// Cluster of the columns of block k of cluster c.
+  std::size_t blockColumn(std::size_t c, std::size_t k) const;
+  double *block(std::size_t c, std::size_t k) { return values_.data() + offset_[block_begin_[c] + k]; }
+  const double *block(std::size_t c, std::size_t k) const { return values_.data() + offset_[block_begin_[c] + k]; }
+
+  /// Number of stored values, against size()^2 for the dense matrix.
+  std::size_t valueCount() const { return values_.size(); }
+
+  /// Entry (row, col) for velocity coordinates row and col, where the
+  /// cluster of col is the cluster of row or one of its ancestors.
+  double &entry(std::size_t row, std::size_t col) { return values_[this->entryOffset(row, col)]; }
+  /// Position of that entry in data().
+  std::size_t entryOffset(std::size_t row, std::size_t col) const;
+  /// The blocks one after another.
+  const double *data() const { return values_.data(); }
+
+  /// The full matrix, row-major, in the v layout of KinematicModel.
+  void toDense(double *M) const;
+  /// y = M x, in the v layout of KinematicModel.
+  void multiply(const double *x, double *y) const;
+
+private:
+  std::vector<int> parent_;
+  std::vector<std::size_t> v_first_;
+  std::vector<std::size_t> v_size_;
+  std::vector<std::size_t> depth_;
+  std::vector<std::size_t> velocity_order_;
+  /// Cluster of each velocity coordinate, and its index within it.
+  std::vector<std::size_t> cluster_;
+  std::vector<std::size_t> rank_;
+  std::vector<std::size_t> block_begin_;
+  std::vector<std::size_t> offset_;
+  std::vector<double> values_;
+};
+
+}
+
+#endif
@@ -0,0 +1,71 @@
+#ifndef URDF_PARSER_FIXED_JOINT_LUMPING_H
+#define URDF_PARSER_FIXED_JOINT_LUMPING_H
+
+#include <cstddef>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <urdf_model/model.h>
+
+#include "exportdecl.h"
+#include "kinematics.h"
+
+namespace urdf{
+
+/// The link frames of a model before lumpFixedJoints(): every original
+/// link, as a fixed offset from the link of the reduced model it was
+/// merged into.  Links that were kept map to themselves.
+class URDFDOM_DLLAPI FrameTable
+{
+public:
+  struct Frame
+  {
+    /// Original link name, and the reduced link carrying it.
+    std::string name;
+    std::string link;
+    /// Pose of the frame in the reduced link.
+    RigidTransform offset;
+  };
+
+  FrameTable() { this->clear(); }
+
+  void clear();
+
+  void add(const std::string &name, const std::string &link, const RigidTransform &offset);
+
+  std::size_t frameCount() const { return frames_.size(); }
+  const Frame &frame(std::size_t k) const { return frames_[k]; }
+  /// Frame of original link name, or frameCount() if there is none.
+  std::size_t frameIndex(const std::string &name) const;
+
+  /// Resolves the links to the bodies of kinematics, compiled from the
+  /// reduced model.  Returns false if a link is missing from it.
+  bool bind(const KinematicModel &kinematics);
+  /// Body carrying frame k, once bound.
+  std::size_t body(std::size_t k) const { return body_[k]; }
+
+  /// Pose of frame k in the root frame, given the poses of
+  /// KinematicModel::forwardKinematics() of the bound model.
+  void pose(const RigidTransform *poses, std::size_t k, RigidTransform &out) const;
+
+private:
+  std::vector<Frame> frames_;
+  std::map<std::string, std::size_t> index_;
+  std::vector<std::size_t> body_;
+};
+
+/// Builds a copy of model with every fixed joint removed and its child link
+/// merged into the parent, through chains of fixed joints.  The inertials
+/// of merged links are combined about their joint center of mass by the
+/// parallel axis theorem; visuals, collisions, the joints leaving them and
+/// the loop constraints attached to them move to the merged link with
+/// their origins composed.  Links named by a coupling constraint are kept,
+/// since the coupling refers to their joints.  frames receives the frame of
+/// every original link.  Returns NULL, logging the reason, if the reduced
+/// tree cannot be built.  model is not modified.
+URDFDOM_DLLAPI ModelInterfaceSharedPtr lumpFixedJoints(const ModelInterface &model, FrameTable &frames);
+
+}
+
+#endif
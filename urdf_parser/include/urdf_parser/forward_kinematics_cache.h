@@ -0,0 +1,68 @@
+#ifndef URDF_PARSER_FORWARD_KINEMATICS_CACHE_H
+#define URDF_PARSER_FORWARD_KINEMATICS_CACHE_H
+
+#include <cstddef>
+#include <vector>
+
+#include "exportdecl.h"
+#include "kinematics.h"
+
+namespace urdf{
+
+/// Forward kinematics of a KinematicModel kept up to date incrementally.
+///
+/// The cache holds a configuration and the poses of the bodies for it.
+/// Setting joint values marks the joints whose values changed, and the
+/// subtrees they move, [i, subtreeEnd(i)) in body order, as stale; nothing
+/// is computed until a pose is asked for.  pose() then recomputes only the
+/// stale ancestors of that body, and the joint transforms only of the
+/// joints that changed, so that after a small change a query costs a few
+/// compositions rather than a pass over the model.  A stale body always
+/// has a stale subtree, which lets marking stop at subtrees already stale.
+class URDFDOM_DLLAPI ForwardKinematicsCache
+{
+public:
+  ForwardKinematicsCache() {}
+  /// Binds the cache to a copy of kinematics, at its neutral configuration.
+  explicit ForwardKinematicsCache(const KinematicModel &kinematics) { this->init(kinematics); }
+
+  void init(const KinematicModel &kinematics);
+
+  const KinematicModel &kinematics() const { return kinematics_; }
+  const std::vector<double> &configuration() const { return q_; }
+
+  /// Sets the whole configuration, marking only the joints whose values
+  /// differ from the cached ones.
+  void setConfiguration(const double *q);
+  /// Sets the q_size values of the joint into body i.
+  void setJointPositions(std::size_t i, const double *values);
+  /// Sets coordinate k of q.
+  void setPosition(std::size_t k, double value);
+
+  bool stale(std::size_t i) const { return stale_[i] != 0; }
+
+  /// Pose of body i in the root frame, computed lazily.
+  const RigidTransform &pose(std::size_t i);
+  /// Brings every body up to date, in one pass over the stale subtrees, and
+  /// returns the poses of all bodies.
+  const RigidTransform *poses();
+
+private:
+  void markJoint(std::size_t i);
+
+  KinematicModel kinematics_;
+  std::vector<double> q_;
+  /// Body of each position coordinate.
+  std::vector<std::size_t> body_of_;
+  std::vector<RigidTransform> local_;
+  std::vector<RigidTransform> poses_;
+  std::vector<unsigned char> stale_;
+  /// Whether the joint transform of each body must be recomputed.
+  std::vector<unsigned char> moved_;
+  /// Stale ancestors of a queried body, reused across queries.
+  std::vector<std::size_t> path_;
+};
+
+}
+
+#endif
@@ -0,0 +1,190 @@
+#ifndef URDF_PARSER_INDEPENDENT_COORDINATES_H
+#define URDF_PARSER_INDEPENDENT_COORDINATES_H
+
+#include <cstddef>
+#include <vector>
+
+#include <urdf_model/model.h>
+
+#include "dynamics.h"
+#include "exportdecl.h"
+#include "loop_constraints.h"
+
+namespace urdf{
+
+struct LoopClosureOptions
+{
+  LoopClosureOptions() : tolerance(1e-10), max_iterations(20) {}
+
+  /// Largest loop residual accepted.
+  double tolerance;
+  /// Gauss-Newton steps per cluster.
+  unsigned int max_iterations;
+};
+
+struct LoopClosureStatus
+{
+  /// Most steps taken by a cluster, and the largest loop residual left.
+  std::size_t iterations;
+  double residual;
+  bool converged;
+};
+
+/// The map x = G y + g from the independent coordinates y of a model to
+/// its spanning tree coordinates x, one dense block per cluster.
+///
+/// The joints with Joint::independent set give the independent
+/// coordinates, numbered cluster by cluster.  A dependent joint that is the
+/// successor of a CouplingConstraint follows its predecessor times the
+/// ratio, through chains of couplings; these rows of G are constant.  The
+/// other dependent joints of a cluster are determined by its loop
+/// constraints: update() linearizes the loops at a configuration, giving
+/// those rows of G and the offset g.  Until then they are zero.
+///
+/// G acts on velocity coordinates, in the v layout of KinematicModel, and
+/// its transpose maps generalized forces back.  For positions the affine
+/// map holds on the coordinates of one degree of freedom joints; floating
+/// and planar joints are always independent and map by identity.
+class URDFDOM_DLLAPI IndependentCoordinateMap
+{
+public:
+  struct Block
+  {
+    /// Rows: the spanning coordinates DynamicsModel::velocityOrder()
+    /// [span_first, span_first + span_size) of the cluster.
+    std::size_t span_first, span_size;
+    /// Columns: independentCoordinates()[ind_first, ind_first + ind_size).
+    std::size_t ind_first, ind_size;
+  };
+
+  IndependentCoordinateMap() { this->clear(); }
+
+  /// Builds the map for the clusters of model, using the loop constraints
+  /// loops compiled against model.kinematics().  Returns false if a
+  /// coupling joins joints that are not single degree of freedom, drives an
+  /// independent joint, leaves its cluster or closes a cycle.
+  bool init(const ModelInterface &urdf_model, const DynamicsModel &model, const LoopConstraintModel &loops);
+
+  void clear();
+
+  std::size_t spanningSize() const { return velocity_order_.size(); }
+  std::size_t independentSize() const { return independent_.size(); }
+  /// Spanning velocity coordinate of each independent coordinate.
+  const std::vector<std::size_t> &independentCoordinates() const { return independent_; }
+
+  std::size_t blockCount() const { return blocks_.size(); }
+  const Block &block(std::size_t c) const { return blocks_[c]; }
+  /// G block of cluster c, span_size x ind_size row-major.
+  const double *matrix(std::size_t c) const { return &values_[value_offset_[c]]; }
+  /// g of cluster c, span_size values.
+  const double *offset(std::size_t c) const { return &offset_[blocks_[c].span_first]; }
+
+  /// Linearizes the loop constraints at configuration q with link poses
+  /// from KinematicModel::forwardKinematics(), in the least squares sense
+  /// where loops are redundant.  Does not allocate.  Returns false if the
+  /// loops of a cluster do not determine its dependent coordinates there,
+  /// leaving that block unchanged.
+  bool update(const LoopConstraintModel &loops, const RigidTransform *poses, const double *q);
+
+  /// The same for cluster c only.  Clusters use separate work space, so
+  /// different clusters may be updated concurrently.
+  bool update(std::size_t c, const LoopConstraintModel &loops, const RigidTransform *poses, const double *q);
+
+  /// Sets the dependent coordinates of q from its independent ones: coupled
+  /// joints exactly, loop determined joints by Gauss-Newton on the loop
+  /// residual starting from their values in q, so the previous solution
+  /// warm starts the next.  Also writes the link poses at the solution and,
+  /// unless v is NULL, the dependent velocities of v from its independent
+  /// ones, leaving G and g linearized at the solution.  Clusters are closed
+  /// one after another, parents first, on the calling thread; a cluster
+  /// takes a few microseconds, less than handing it to another thread
+  /// costs.  Does not allocate.  Returns false if a cluster did not
+  /// converge.
+  bool closeLoops(const DynamicsModel &model, const LoopConstraintModel &loops, double *q, double *v,
+                  RigidTransform *poses, const LoopClosureOptions &options = LoopClosureOptions(),
+                  LoopClosureStatus *status = NULL);
+
+  /// Inverse dynamics in the independent coordinates: the forces
+  /// tau[independentSize()] that give the independent coordinates
+  /// acceleration ydd at velocity yd, with the model at configuration q,
+  /// whose loops and couplings must hold, as after closeLoops().  The
+  /// spanning tree moves with velocity G yd and acceleration G ydd plus the
+  /// bias that keeps the loops closed at that velocity, and the forces of
+  /// DynamicsModel::inverseDynamics() come back as G^T tau, which drops the
+  /// loop closure forces.  Leaves G and g linearized at q.  Does not
+  /// allocate.  Returns false if the loops do not determine their
+  /// coordinates at q.
+  bool inverseDynamics(const DynamicsModel &model, const LoopConstraintModel &loops, DynamicsData &data,
+                       const double *q, const double *yd, const double *ydd, double *tau);
+
+  /// y = the independent coordinates of x.
+  void gather(const double *x, double *y) const;
+
+  /// x = G y, and with the offset x = G y + g.
+  void apply(const double *y, double *x) const;
+  void applyAffine(const double *y, double *x) const;
+  /// y = G^T x.
+  void applyTranspose(const double *x, double *y) const;
+
+  /// The same for count vectors stored one after another.
+  void apply(std::size_t count, const double *y, double *x) const;
+  void applyTranspose(std::size_t count, const double *x, double *y) const;
+
+private:
+  // the loop Jacobian of cluster c on its coupled basis, and the Cholesky
+  // factor of its normal matrix; false if singular
+  bool factor(std::size_t c, const LoopConstraintModel &loops, const RigidTransform *poses);
+  void couple(std::size_t c, double *q) const;
+  void closeCluster(std::size_t c, const DynamicsModel &model, const LoopConstraintModel &loops,
+                    const LoopClosureOptions &options, double *q, double *v, RigidTransform *poses);
+  // adds to a the loop bias acceleration of cluster c, -E_D (A^T A)^-1 A^T
+  // k, with the bias k in phi_ and A factored at the current poses
+  void addLoopBias(std::size_t c, const LoopConstraintModel &loops, double *a);
+
+  std::vector<Block> blocks_;
+  std::vector<std::size_t> velocity_order_;
+  std::vector<std::size_t> independent_;
+  /// Position coordinate of each velocity coordinate, or positionSize() for
+  /// those of multi degree of freedom joints.
+  std::vector<std::size_t> position_;
+  std::vector<std::size_t> value_offset_;
+  std::vector<double> values_;
+  std::vector<double> offset_;
+
+  /// The coupled basis x = E_I y + E_D z of each cluster, with z the
+  /// coordinates its loops determine, dependent_[dep_first_[c],
+  /// dep_first_[c + 1]).
+  std::vector<double> coupled_;
+  std::vector<std::size_t> dependent_;
+  std::vector<std::size_t> dep_first_;
+  std::vector<std::size_t> dependent_offset_;
+  std::vector<double> dependent_basis_;
+
+  /// The loop constraints of each cluster, loop_[loop_first_[c],
+  /// loop_first_[c + 1]), and the row within its cluster of each entry of
+  /// LoopConstraintModel::columns().
+  std::vector<std::size_t> loop_;
+  std::vector<std::size_t> loop_first_;
+  std::vector<std::size_t> column_rank_;
+  std::vector<std::size_t> loop_rows_;
+  /// Whether each spanning coordinate, in cluster order, follows a coupling.
+  std::vector<bool> coupled_row_;
+  std::size_t position_size_;
+
+  // work space, separate per cluster
+  std::vector<double> jacobian_;
+  std::vector<double> phi_;
+  std::vector<std::size_t> work_offset_;
+  std::vector<double> work_;
+  std::vector<std::size_t> iterations_;
+  std::vector<double> residual_;
+  // inverseDynamics() work space
+  std::vector<RigidTransform> poses_;
+  std::vector<double> velocity_;
+  std::vector<double> acceleration_;
+  std::vector<double> force_;
+};
+
+}
+
+#endif
@@ -0,0 +1,115 @@
+#ifndef URDF_PARSER_INVERSE_KINEMATICS_H
+#define URDF_PARSER_INVERSE_KINEMATICS_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include <urdf_model/model.h>
+
+#include "exportdecl.h"
+#include "kinematics.h"
+
+namespace urdf{
+
+struct InverseKinematicsOptions
+{
+  InverseKinematicsOptions()
+    : position_tolerance(1e-6), orientation_tolerance(1e-6), orientation_weight(1.0), damping(1e-2),
+      max_step(0.5), max_iterations(100), position_only(false), threads(0) {}
+
+  /// Largest position (m) and orientation (rad) errors accepted.
+  double position_tolerance;
+  double orientation_tolerance;
+  /// Weight of the orientation rows against the position rows, in m/rad.
+  double orientation_weight;
+  /// Damping lambda of the step J^T (J J^T + lambda^2 1)^-1 e, scaled down
+  /// by min(1, sqrt(|e|)) so that the last steps are Gauss-Newton steps.
+  double damping;
+  /// Largest change of a coordinate in one step; longer steps are scaled.
+  double max_step;
+  unsigned int max_iterations;
+  /// Solve for the tip position only.
+  bool position_only;
+  /// Batches are solved on up to threads threads (0: one per hardware
+  /// thread).
+  unsigned int threads;
+};
+
+struct InverseKinematicsStatus
+{
+  std::size_t iterations;
+  double position_error;
+  double orientation_error;
+  bool converged;
+};
+
+/// Damped least squares inverse kinematics of one tip link, with the
+/// chain from the root to the tip precomputed.
+///
+/// The single degree of freedom joints on the path to the tip are the
+/// variables; the other coordinates of q, including floating and planar
+/// joints on the path, keep their values.  Revolute and prismatic joints
+/// stay within their JointLimits: every step is projected back onto them.
+/// Targets are poses of the tip link origin in the root frame.
+class URDFDOM_DLLAPI InverseKinematics
+{
+public:
+  struct ChainJoint
+  {
+    std::size_t body;
+    std::size_t q_offset, v_offset;
+    bool limited;
+    double lower, upper;
+  };
+
+  InverseKinematics() { this->clear(); }
+
+  /// Compiles the chain of tip in model, which kinematics must have been
+  /// compiled from.  Returns false if there is no link tip.
+  bool init(const ModelInterface &model, const KinematicModel &kinematics, const std::string &tip);
+
+  void clear();
+
+  std::size_t tip() const { return tip_; }
+  std::size_t chainSize() const { return joints_.size(); }
+  const ChainJoint &chainJoint(std::size_t k) const { return joints_[k]; }
+
+  /// Pose of the tip for configuration q, along the chain only.
+  void tipPose(const double *q, RigidTransform &pose) const;
+
+  /// Moves q, the warm start, to a configuration placing the tip at
+  /// target.  Returns whether the tolerances were met.
+  bool solve(const RigidTransform &target, double *q, InverseKinematicsStatus *status = NULL,
+             const InverseKinematicsOptions &options = InverseKinematicsOptions()) const;
+
+  /// Solves count queries in parallel: targets[n] from the warm start
+  /// q_start + n positionSize(), written to q + n positionSize() (q may
+  /// be q_start), with the statistics of each query in status unless it is
+  /// NULL.  Each worker allocates its work space once.  Returns whether
+  /// every query converged.
+  bool solve(std::size_t count, const RigidTransform *targets, const double *q_start, double *q,
+             InverseKinematicsStatus *status = NULL,
+             const InverseKinematicsOptions &options = InverseKinematicsOptions()) const;
+
+private:
+  // tip pose, and the root frame pose of the body of every chain joint
+  void chainPoses(const double *q, RigidTransform *joint_poses, RigidTransform &pose) const;
+  bool solve(const RigidTransform &target, double *q, InverseKinematicsStatus &status,
+             const InverseKinematicsOptions &options, std::vector<RigidTransform> &poses,
+             std::vector<double> &work) const;
+
+  KinematicModel kinematics_;
+  std::size_t tip_;
+  std::vector<ChainJoint> joints_;
+  /// Bodies from the root to the tip, root excluded, and the chain joint
+  /// of each, or -1.
+  std::vector<std::size_t> path_;
+  std::vector<int> path_joint_;
+  /// Motion subspace of each chain joint in its body frame.
+  std::vector<double> subspace_;
+};
+
+}
+
+#endif
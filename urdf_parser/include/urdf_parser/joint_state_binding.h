@@ -0,0 +1,95 @@
+#ifndef URDF_PARSER_JOINT_STATE_BINDING_H
+#define URDF_PARSER_JOINT_STATE_BINDING_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include <urdf_model/model.h>
+#include <urdf_model_state/model_state.h>
+
+#include "exportdecl.h"
+
+namespace urdf{
+
+/// Maps joint states listed in some fixed external order (a driver, a
+/// controller, a log) to dense configuration vectors in model order, without
+/// any name lookup per message.
+///
+/// Model order visits the movable joints depth first from the root link,
+/// children in Link::child_joints order.  Each joint takes 1 slot in the
+/// position and velocity vectors, except planar joints (3 and 3) and
+/// floating joints (7 and 6: xyz plus quaternion xyzw, and a 6D twist).
+/// Efforts use the velocity layout.  Fixed joints take no slots.
+///
+/// After init() no member function allocates.
+class URDFDOM_DLLAPI JointStateBinding
+{
+public:
+  JointStateBinding();
+
+  /// Binds the external order joint_names to model.  Returns false if a name
+  /// is not a joint of model or is listed twice.
+  bool init(const ModelInterface &model, const std::vector<std::string> &joint_names);
+
+  /// Binds the order in which prototype lists its joint states.
+  bool init(const ModelInterface &model, const ModelState &prototype);
+
+  /// Size of the dense position (and velocity/effort) vectors.
+  std::size_t positionSize() const { return position_size_; }
+  std::size_t velocitySize() const { return velocity_size_; }
+
+  /// Movable joints of the model in model order, with the index of their
+  /// first slot in the dense vectors.
+  const std::vector<std::string> &modelJoints() const { return model_joints_; }
+  const std::vector<std::size_t> &positionOffsets() const { return model_position_offset_; }
+  const std::vector<std::size_t> &velocityOffsets() const { return model_velocity_offset_; }
+
+  /// The bound external order.
+  const std::vector<std::string> &boundJoints() const { return bound_joints_; }
+
+  /// Number of values in a flat external-order array: the concatenation of
+  /// the per-joint vectors of the bound joints.
+  std::size_t boundPositionSize() const { return position_map_.size(); }
+  std::size_t boundVelocitySize() const { return velocity_map_.size(); }
+
+  /// True if ms lists exactly the bound joints, in the bound order.
+  bool matches(const ModelState &ms) const;
+
+  /// Writes the channels of ms into the dense vectors q, v and effort, any of
+  /// which may be null.  Channels that a joint state leaves empty are skipped,
+  /// as are model joints that are not bound.  Returns false, writing nothing,
+  /// if ms does not match the binding.
+  bool scatter(const ModelState &ms, double *q, double *v, double *effort) const;
+
+  /// Copies the dense vectors back into ms, which must already match the
+  /// binding; only channels that are non-empty in ms are written.
+  bool gather(const double *q, const double *v, const double *effort, ModelState &ms) const;
+
+  /// Flat external-order arrays to dense vectors and back.
+  void scatterPositions(const double *bound, double *q) const;
+  void scatterVelocities(const double *bound, double *v) const;
+  void gatherPositions(const double *q, double *bound) const;
+  void gatherVelocities(const double *v, double *bound) const;
+
+private:
+  std::vector<std::string> model_joints_;
+  std::vector<std::size_t> model_position_offset_;
+  std::vector<std::size_t> model_velocity_offset_;
+  std::size_t position_size_;
+  std::size_t velocity_size_;
+
+  std::vector<std::string> bound_joints_;
+  // per bound joint: first dense slot and width
+  std::vector<std::size_t> bound_position_offset_;
+  std::vector<std::size_t> bound_position_width_;
+  std::vector<std::size_t> bound_velocity_offset_;
+  std::vector<std::size_t> bound_velocity_width_;
+  // dense slot of every value of a flat external-order array
+  std::vector<std::size_t> position_map_;
+  std::vector<std::size_t> velocity_map_;
+};
+
+}
+
+#endif
@@ -0,0 +1,164 @@
+#ifndef URDF_PARSER_KINEMATICS_H
+#define URDF_PARSER_KINEMATICS_H
+
+#include <cstddef>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <urdf_model/model.h>
+
+#include "exportdecl.h"
+
+namespace urdf{
+
+/// Rigid transform stored as a row-major rotation matrix R and a
+/// translation p, mapping x to R x + p.
+struct RigidTransform
+{
+  double R[9];
+  double p[3];
+
+  void setIdentity()
+  {
+    R[0] = 1.0; R[1] = 0.0; R[2] = 0.0;
+    R[3] = 0.0; R[4] = 1.0; R[5] = 0.0;
+    R[6] = 0.0; R[7] = 0.0; R[8] = 1.0;
+    p[0] = p[1] = p[2] = 0.0;
+  }
+};
+
+/// The kinematic tree of a ModelInterface, compiled into flat arrays.
+///
+/// Every link is a body.  Bodies are numbered depth first from the root
+/// link (body 0), children in Link::child_joints order, so parent(i) < i and
+/// the subtree of body i is [i, subtreeEnd(i)).  Body i > 0 moves with the
+/// joint connecting it to its parent.
+///
+/// The configuration vector q and the velocity vector v list the movable
+/// joints in body order, in the layout used by JointStateBinding:
+///   revolute, continuous, prismatic: 1 and 1 values;
+///   planar: q = (x, y, angle) in the plane normal to the axis, v = the
+///     velocity along the two in-plane axes of the child frame and the
+///     angular rate, 3 values each;
+///   floating: q = (x, y, z, qx, qy, qz, qw), v = the angular then linear
+///     velocity of the child in its own frame, 7 and 6 values;
+///   fixed: none.
+///
+/// Jacobians and other spatial quantities order the angular part before
+/// the linear part.
+class URDFDOM_DLLAPI KinematicModel
+{
+public:
+  struct Body
+  {
+    /// Parent body, -1 for the root.
+    int parent;
+    /// One past the last body of the subtree rooted here.
+    std::size_t subtree_end;
+    /// Joint::type of the joint into this body, Joint::FIXED for the root.
+    int type;
+    std::size_t q_offset, q_size;
+    std::size_t v_offset, v_size;
+    /// Unit joint axis, in the joint frame.
+    double axis[3];
+    /// For planar joints, the in-plane axes with u x w = axis.
+    double plane_u[3];
+    double plane_w[3];
+    /// parent_to_joint_origin_transform.
+    RigidTransform origin;
+    /// For revolute joints the rotation of the child in the parent is
+    /// rot_const + cos(q) rot_cos + sin(q) rot_sin; for prismatic joints the
+    /// translation is origin.p + q slide.
+    double rot_const[9], rot_cos[9], rot_sin[9];
+    double slide[3];
+  };
+
+  KinematicModel() { this->clear(); }
+
+  /// Compiles model.  Returns false if model has no root or a movable joint
+  /// has a zero axis.
+  bool init(const ModelInterface &model);
+
+  void clear();
+
+  const std::string &name() const { return name_; }
+
+  std::size_t bodyCount() const { return bodies_.size(); }
+  std::size_t positionSize() const { return position_size_; }
+  std::size_t velocitySize() const { return velocity_size_; }
+
+  const Body &body(std::size_t i) const { return bodies_[i]; }
+  const std::string &linkName(std::size_t i) const { return link_names_[i]; }
+  /// Name of the joint into body i, empty for the root.
+  const std::string &jointName(std::size_t i) const { return joint_names_[i]; }
+
+  /// Body of link name, or bodyCount() if there is none.
+  std::size_t linkIndex(const std::string &name) const;
+  /// Body moved by joint name, or bodyCount() if there is none.
+  std::size_t jointIndex(const std::string &name) const;
+
+  /// Movable bodies whose joints move body i, root first: the ancestors of
+  /// i and i itself with v_size > 0.  There are supportSize(i) of them.
+  const std::size_t *support(std::size_t i) const { return &support_[support_begin_[i]]; }
+  std::size_t supportSize(std::size_t i) const { return support_begin_[i + 1] - support_begin_[i]; }
+
+  /// Writes the neutral configuration (zero, identity quaternions) to q.
+  void neutralConfiguration(double *q) const;
+
+  /// Configuration reached from q by moving with velocity v for time dt,
+  /// written to out (which may alias q).  Rotations, including the angle of
+  /// planar joints, are integrated exactly; translations move along the
+  /// velocity expressed at the start.
+  void integrate(const double *q, const double *v, double dt, double *out) const;
+
+  /// Pose of body i in its parent body for configuration q.
+  void jointTransform(std::size_t i, const double *q, RigidTransform &transform) const;
+
+  /// Poses of all bodies in the root frame, poses[bodyCount()], in a single
+  /// pass over the bodies.  Floating joint quaternions are normalized.
+  void forwardKinematics(const double *q, RigidTransform *poses) const;
+
+  /// Forward kinematics for count configurations at once, in
+  /// structure-of-arrays layout: coordinate k of configuration n is
+  /// q[k * count + n], and component c of the pose of body i in
+  /// configuration n is poses[(12 * i + c) * count + n], where c = 0..8 is
+  /// R in row-major order and c = 9..11 is p.  The configurations are
+  /// processed in vector lanes, using the widest instruction set of the
+  /// running CPU where the compiler supports dispatching on it.
+  void forwardKinematicsBatch(std::size_t count, const double *q, double *poses) const;
+
+  /// Geometric Jacobian of body i, as a row-major 6 x velocitySize() matrix
+  /// J with J v = (angular velocity, linear velocity of point), both in the
+  /// root frame.  point is in the frame of body i; NULL means its origin.
+  /// poses come from forwardKinematics().  Only the columns of support(i)
+  /// are computed, the others are set to zero.
+  void jacobian(const RigidTransform *poses, std::size_t i, const double *point, double *J) const;
+
+  /// Jacobians of count bodies, bodies[m] at point points + 3 m (points may
+  /// be NULL), written to J + 6 * velocitySize() * m.  The motion of each
+  /// joint in the union of the supports is computed once and shared, in
+  /// work, which holds jacobiansWorkSize() values owned by the caller.
+  void jacobians(const RigidTransform *poses, std::size_t count, const std::size_t *bodies,
+                 const double *points, double *J, double *work) const;
+  std::size_t jacobiansWorkSize() const { return 7 * velocity_size_; }
+
+private:
+  /// Pose of body in its parent for the coordinates qi of its own joint.
+  static void bodyTransform(const Body &body, const double *qi, RigidTransform &transform);
+
+  std::string name_;
+  std::vector<Body> bodies_;
+  std::vector<std::string> link_names_;
+  std::vector<std::string> joint_names_;
+  std::map<std::string, std::size_t> link_index_;
+  std::map<std::string, std::size_t> joint_index_;
+  std::vector<std::size_t> support_begin_;
+  std::vector<std::size_t> support_;
+  std::size_t position_size_;
+  std::size_t velocity_size_;
+};
+
+}
+
+#endif
@@ -0,0 +1,140 @@
+#ifndef URDF_PARSER_LOOP_CONSTRAINTS_H
+#define URDF_PARSER_LOOP_CONSTRAINTS_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include <urdf_model/model.h>
+
+#include "exportdecl.h"
+#include "kinematics.h"
+
+namespace urdf{
+
+/// The loop constraints of a ModelInterface, compiled against its
+/// KinematicModel.
+///
+/// A loop constraint joins a frame on the predecessor link to a frame on
+/// the successor link with a virtual joint of LoopConstraint::type about
+/// LoopConstraint::axis.  It constrains the motions that joint does not
+/// allow, along directions fixed in the predecessor frame, angular before
+/// linear:
+///   revolute, continuous: rotation normal to the axis (2), translation (3);
+///   prismatic: rotation (3), translation normal to the axis (2);
+///   planar: rotation normal to the axis (2), translation along it (1);
+///   fixed: rotation (3), translation (3).
+/// With phi the residual, zero when the loop is closed, the Jacobian K is
+/// d phi / dv and the bias k = dK/dt v, so that K a + k is the second
+/// derivative of phi.  The rows of the constraints are stacked in the
+/// order of ModelInterface::constraints_.
+///
+/// Only the joints between the predecessor and successor and their
+/// nearest common ancestor enter a constraint; these columns are its
+/// sparsity pattern.
+class URDFDOM_DLLAPI LoopConstraintModel
+{
+public:
+  struct Constraint
+  {
+    std::string name;
+    /// LoopConstraint::type.
+    int type;
+    std::size_t predecessor, successor;
+    /// The constraint frame in the predecessor and successor bodies.
+    RigidTransform predecessor_frame, successor_frame;
+    /// Unit axis in the constraint frame, and two unit normals with
+    /// u x w = axis.
+    double axis[3], u[3], w[3];
+    /// The rows are [row, row + rows) and the nonzero columns
+    /// columns()[column_begin, column_end).
+    std::size_t row, rows;
+    std::size_t column_begin, column_end;
+    /// The sparse Jacobian block of the constraint, rows x its columns
+    /// row-major, starts at value_offset.
+    std::size_t value_offset;
+  };
+
+  LoopConstraintModel() { this->clear(); }
+
+  /// Compiles the loop constraints of model, which kinematics must have been
+  /// compiled from.  Returns false if a constraint names an unknown link or
+  /// has an unknown type or a zero axis.
+  bool init(const ModelInterface &model, const KinematicModel &kinematics);
+
+  void clear();
+
+  std::size_t constraintCount() const { return constraints_.size(); }
+  const Constraint &constraint(std::size_t c) const { return constraints_[c]; }
+  /// Total number of constrained directions.
+  std::size_t rowCount() const { return row_count_; }
+  std::size_t velocitySize() const { return velocity_size_; }
+
+  /// Velocity coordinates of the nonzero columns of each constraint, in
+  /// increasing order within a constraint.
+  const std::vector<std::size_t> &columns() const { return columns_; }
+  /// Size of the sparse Jacobian.
+  std::size_t valueCount() const { return value_count_; }
+
+  /// The residual phi[rowCount()] for the link poses from
+  /// KinematicModel::forwardKinematics().
+  void residual(const RigidTransform *poses, double *phi) const;
+
+  /// The Jacobian as a dense row-major rowCount() x velocitySize() matrix.
+  void jacobian(const RigidTransform *poses, double *K) const;
+
+  /// The Jacobian as the blocks of the constraints, values[valueCount()].
+  void sparseJacobian(const RigidTransform *poses, double *values) const;
+
+  /// The bias k[rowCount()] for velocity v.
+  void bias(const RigidTransform *poses, const double *v, double *k) const;
+
+  /// The rows of constraint c only, in the same storage.
+  void residual(std::size_t c, const RigidTransform *poses, double *phi) const;
+  void sparseJacobian(std::size_t c, const RigidTransform *poses, double *values) const;
+
+private:
+  // a movable body on the path from the root to a constrained body
+  struct PathJoint
+  {
+    std::size_t body;
+    std::size_t v_offset, v_size;
+    /// Column of the first coordinate within the constraint, or -1 for
+    /// common ancestors, which do not enter the constraint.
+    int column;
+    /// Motion subspace in the body frame, 6 v_size values.
+    std::size_t subspace;
+  };
+
+  // spatial velocity and bias acceleration, in the root frame about the
+  // root origin, accumulated along a path
+  struct PathMotion
+  {
+    double V[6];
+    double A[6];
+  };
+
+  void accumulate(const PathJoint &joint, const RigidTransform *poses, const double *v, PathMotion &m) const;
+
+  // Any of phi, K and k may be NULL.  K points to the first row of the
+  // constraint; dense selects velocity coordinates over sparse columns.
+  void compute(std::size_t c, const RigidTransform *poses, double *phi, double *K, bool dense,
+               const double *v, double *k) const;
+
+  std::vector<Constraint> constraints_;
+  /// Per constraint the joints of the successor path then those of the
+  /// predecessor path, root first, at [path_begin_[c], path_split_[c]) and
+  /// [path_split_[c], path_begin_[c + 1]).
+  std::vector<PathJoint> path_;
+  std::vector<std::size_t> path_begin_;
+  std::vector<std::size_t> path_split_;
+  std::vector<double> subspace_;
+  std::vector<std::size_t> columns_;
+  std::size_t row_count_;
+  std::size_t velocity_size_;
+  std::size_t value_count_;
+};
+
+}
+
+#endif
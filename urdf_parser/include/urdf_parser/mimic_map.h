@@ -0,0 +1,77 @@
+#ifndef URDF_PARSER_MIMIC_MAP_H
+#define URDF_PARSER_MIMIC_MAP_H
+
+#include <cstddef>
+#include <vector>
+
+#include <urdf_model/model.h>
+
+#include "exportdecl.h"
+#include "kinematics.h"
+
+namespace urdf{
+
+/// The mimic joints of a model compiled into a sparse affine map from the
+/// active coordinates to the full q and v vectors of its KinematicModel.
+///
+/// Every joint without a JointMimic is active, and its coordinates are the
+/// active coordinates, in the q or v layout order.  A mimic joint follows
+/// the active joint at the end of its chain of mimics: with the
+/// multipliers and offsets of the chain composed,
+///   q[joint] = multiplier q[active] + offset, v[joint] = multiplier v[active],
+/// so each row of the map has at most one nonzero and chains are resolved
+/// once, at init().
+class URDFDOM_DLLAPI MimicMap
+{
+public:
+  MimicMap() { this->clear(); }
+
+  /// Compiles the mimics of model, which kinematics must have been
+  /// compiled from.  Returns false if a mimic names an unknown joint, is
+  /// not between single degree of freedom joints, or closes a cycle.
+  bool init(const ModelInterface &model, const KinematicModel &kinematics);
+
+  void clear();
+
+  std::size_t positionSize() const { return position_source_.size(); }
+  std::size_t velocitySize() const { return velocity_source_.size(); }
+  std::size_t activePositionSize() const { return active_positions_.size(); }
+  std::size_t activeVelocitySize() const { return active_velocities_.size(); }
+  /// Full coordinate of each active coordinate.
+  const std::vector<std::size_t> &activePositions() const { return active_positions_; }
+  const std::vector<std::size_t> &activeVelocities() const { return active_velocities_; }
+
+  /// Active coordinate full coordinate k follows, and the multiplier and
+  /// offset it follows it with.
+  std::size_t positionSource(std::size_t k) const { return position_source_[k]; }
+  std::size_t velocitySource(std::size_t k) const { return velocity_source_[k]; }
+  double multiplier(std::size_t k) const { return position_multiplier_[k]; }
+  double offset(std::size_t k) const { return position_offset_[k]; }
+
+  /// q = the full positions of active positions a, and v = the full
+  /// velocities of active velocities a, for count vectors stored one after
+  /// another.
+  void applyPositions(std::size_t count, const double *a, double *q) const;
+  void applyVelocities(std::size_t count, const double *a, double *v) const;
+  /// a = the transpose of the velocity map applied to full generalized
+  /// forces tau: each active coordinate collects the forces of its mimics
+  /// times their multipliers.
+  void applyTranspose(std::size_t count, const double *tau, double *a) const;
+
+  /// The active coordinates of full vectors.
+  void gatherPositions(std::size_t count, const double *q, double *a) const;
+  void gatherVelocities(std::size_t count, const double *v, double *a) const;
+
+private:
+  std::vector<std::size_t> active_positions_;
+  std::vector<std::size_t> active_velocities_;
+  std::vector<std::size_t> position_source_;
+  std::vector<double> position_multiplier_;
+  std::vector<double> position_offset_;
+  std::vector<std::size_t> velocity_source_;
+  std::vector<double> velocity_multiplier_;
+};
+
+}
+
+#endif
@@ -0,0 +1,132 @@
+#ifndef URDF_PARSER_MODEL_STATE_LOG_H
+#define URDF_PARSER_MODEL_STATE_LOG_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <urdf_model_state/model_state.h>
+
+#include "exportdecl.h"
+
+namespace urdf{
+
+/// Column layout shared by every record of a model state log.
+///
+/// A record holds one value per column.  Columns are grouped by channel:
+/// first the positions of all joints (in joint order), then all velocities,
+/// then all efforts, so position_offset[j] is the column of the first
+/// position value of joint j, and likewise for the other channels.
+class URDFDOM_DLLAPI ModelStateLogLayout
+{
+public:
+  ModelStateLogLayout() { this->clear(); }
+
+  /// Builds the layout from the joint names and vector sizes of prototype.
+  void init(const ModelState &prototype);
+
+  void clear();
+
+  std::size_t columnCount() const { return column_count; }
+
+  std::string model_name;
+  std::vector<std::string> joints;
+  std::vector<uint32_t> position_size;
+  std::vector<uint32_t> velocity_size;
+  std::vector<uint32_t> effort_size;
+  std::vector<uint32_t> position_offset;
+  std::vector<uint32_t> velocity_offset;
+  std::vector<uint32_t> effort_offset;
+
+private:
+  std::size_t column_count;
+};
+
+/// Appends ModelState records to a compact binary log.
+///
+/// Records are buffered in blocks; each block stores its time stamps as
+/// varint deltas of deltas (one byte per record at a steady rate) and each
+/// column as the XOR with the previous value, keeping only the bytes between
+/// its leading and trailing zero bytes.  An unchanged value takes one byte
+/// and a value with few significant mantissa bits (quantized sensor
+/// readings) a few bytes; noisy full precision signals save little over the
+/// raw 8 bytes, at most 9.  Blocks are independent, so a log cut short by a
+/// crash stays readable up to its last complete block.  All buffers are
+/// sized in open(), append() never allocates.
+class URDFDOM_DLLAPI ModelStateLogWriter
+{
+public:
+  ModelStateLogWriter();
+  ~ModelStateLogWriter();
+
+  ModelStateLogWriter(const ModelStateLogWriter &) = delete;
+  ModelStateLogWriter &operator=(const ModelStateLogWriter &) = delete;
+
+  /// Creates the log at path.  Every record must have the joints of
+  /// prototype, in the same order and with the same vector sizes.
+  bool open(const std::string &path, const ModelState &prototype, std::size_t block_records = 1024);
+
+  /// Appends ms, returns false if it does not match the layout or its time
+  /// stamp is not later than that of the previous record.
+  bool append(const ModelState &ms);
+
+  /// Appends a record given as one value per column of layout(), with the
+  /// same time stamp rule.
+  bool append(int64_t time_stamp_ns, const double *values);
+
+  /// Writes the pending partial block.
+  bool flush();
+
+  void close();
+
+  const ModelStateLogLayout &layout() const;
+  std::size_t recordCount() const;
+
+private:
+  struct Impl;
+  std::unique_ptr<Impl> impl_;
+};
+
+/// Memory-mapped random-access reader for logs written by ModelStateLogWriter.
+class URDFDOM_DLLAPI ModelStateLogReader
+{
+public:
+  ModelStateLogReader();
+  ~ModelStateLogReader();
+
+  ModelStateLogReader(const ModelStateLogReader &) = delete;
+  ModelStateLogReader &operator=(const ModelStateLogReader &) = delete;
+
+  bool open(const std::string &path);
+  void close();
+
+  const ModelStateLogLayout &layout() const;
+  std::size_t recordCount() const;
+
+  /// Time stamps, in nanoseconds, of the first and last record.
+  int64_t startTime() const;
+  int64_t endTime() const;
+
+  /// Index of the first record whose time stamp is >= time_stamp_ns, or
+  /// recordCount() if there is none.  Binary search over the blocks.
+  std::size_t seek(int64_t time_stamp_ns) const;
+
+  /// Decodes records [first, first + count) as structure-of-arrays: the
+  /// time stamps go to time_stamps_ns[i] and column c of record first + i to
+  /// values[c * count + i].  Either output may be null.  Returns the number
+  /// of records decoded, which is smaller than count at the end of the log.
+  std::size_t read(std::size_t first, std::size_t count, int64_t *time_stamps_ns, double *values);
+
+  /// Decodes a single record into ms, reusing the JointState objects it holds.
+  bool read(std::size_t index, ModelState &ms);
+
+private:
+  struct Impl;
+  std::unique_ptr<Impl> impl_;
+};
+
+}
+
+#endif
@@ -0,0 +1,57 @@
+#ifndef URDF_PARSER_MODEL_STATE_READER_H
+#define URDF_PARSER_MODEL_STATE_READER_H
+
+#include <cstddef>
+#include <istream>
+#include <memory>
+#include <string>
+
+#include <urdf_model_state/model_state.h>
+
+#include "exportdecl.h"
+
+namespace urdf{
+
+/// Reads a sequence of <model_state> records from a file or stream, one at a
+/// time, without loading the whole document.  The records may sit at any
+/// depth (e.g. inside a <model_states> wrapper); everything else is skipped.
+///
+/// next() overwrites the ModelState it is given in place: JointState objects
+/// and their position/velocity/effort vectors are reused, so after the first
+/// few records a replay loop performs no allocations.  Do not keep references
+/// to the joint states of a record across calls to next().
+class URDFDOM_DLLAPI ModelStateReader
+{
+public:
+  ModelStateReader();
+  ~ModelStateReader();
+
+  ModelStateReader(const ModelStateReader &) = delete;
+  ModelStateReader &operator=(const ModelStateReader &) = delete;
+
+  /// Starts reading from the file at path.  Returns false if it cannot be opened.
+  bool open(const std::string &path);
+
+  /// Starts reading from stream, which must outlive the reader (or the next
+  /// call to open()/close()).
+  void open(std::istream &stream);
+
+  void close();
+
+  /// Parses the next record into ms.  Returns false at the end of the input
+  /// or on a malformed record; use failed() to tell the two apart.
+  bool next(ModelState &ms);
+
+  bool failed() const;
+
+  /// Number of records successfully returned by next() since open().
+  std::size_t recordCount() const;
+
+private:
+  struct Impl;
+  std::unique_ptr<Impl> impl_;
+};
+
+}
+
+#endif
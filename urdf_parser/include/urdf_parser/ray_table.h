@@ -0,0 +1,80 @@
+#ifndef URDF_PARSER_RAY_TABLE_H
+#define URDF_PARSER_RAY_TABLE_H
+
+#include <cstddef>
+
+#include <urdf_model/pose.h>
+#include <urdf_sensor/sensor.h>
+
+#include "aligned_allocator.h"
+#include "exportdecl.h"
+
+namespace urdf{
+
+/// Unit ray directions of a Ray sensor, computed once.
+///
+/// As in SDF, the sensor returns samples * resolution ranges in each
+/// direction (rounded, at least one), so a resolution above one gives
+/// ranges between the simulated rays and one below one fewer ranges than
+/// rays.  The table holds one ray per returned range, at angles evenly
+/// spaced from min_angle to max_angle (both included).  Ray (v, h),
+/// with vertical angle pitch and horizontal angle yaw, points along
+/// (cos pitch cos yaw, cos pitch sin yaw, sin pitch) and has index
+/// v * horizontalCount() + h; range arrays passed to toPoints() use the
+/// same order.
+///
+/// Directions are kept as three aligned arrays (x, y, z), in the sensor
+/// frame and in the frame of the parent link, so that turning a scan into
+/// points is a single streaming pass without trigonometry.
+class URDFDOM_DLLAPI RayTable
+{
+public:
+  enum Frame
+  {
+    SENSOR_FRAME,
+    LINK_FRAME
+  };
+
+  RayTable() { this->clear(); }
+
+  /// Builds the table for ray, mounted at origin in its parent link.
+  /// Returns false if ray has no samples, a resolution that is not
+  /// positive or a min_angle above max_angle.
+  bool init(const Ray &ray, const Pose &origin = Pose());
+
+  /// Builds the table for a ray sensor, using its origin.
+  bool init(const Sensor &sensor);
+
+  void clear();
+
+  std::size_t horizontalCount() const { return horizontal_count_; }
+  std::size_t verticalCount() const { return vertical_count_; }
+  std::size_t size() const { return horizontal_count_ * vertical_count_; }
+
+  /// Direction components of every ray in frame, size() values each.
+  const double *directionX(Frame frame = SENSOR_FRAME) const { return directions_.data() + (frame == SENSOR_FRAME ? 0 : 3) * stride_; }
+  const double *directionY(Frame frame = SENSOR_FRAME) const { return directions_.data() + (frame == SENSOR_FRAME ? 1 : 4) * stride_; }
+  const double *directionZ(Frame frame = SENSOR_FRAME) const { return directions_.data() + (frame == SENSOR_FRAME ? 2 : 5) * stride_; }
+
+  /// Turns size() ranges into points in frame, written to x, y and z.
+  /// Non-finite ranges give non-finite points.
+  void toPoints(const double *ranges, double *x, double *y, double *z, Frame frame = SENSOR_FRAME) const;
+
+  /// Same as above for the rays [first, first + count), e.g. one firing
+  /// of a spinning lidar; ranges, x, y and z hold count values.
+  void toPoints(std::size_t first, std::size_t count, const double *ranges,
+                double *x, double *y, double *z, Frame frame = SENSOR_FRAME) const;
+
+private:
+  std::size_t horizontal_count_;
+  std::size_t vertical_count_;
+  // distance between the component arrays, a multiple of the alignment
+  std::size_t stride_;
+  // sensor frame x, y, z then link frame x, y, z
+  AlignedDoubleVector directions_;
+  Vector3 origin_;
+};
+
+}
+
+#endif
@@ -0,0 +1,69 @@
+#ifndef URDF_PARSER_SENSOR_TABLE_H
+#define URDF_PARSER_SENSOR_TABLE_H
+
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <urdf_model/model.h>
+#include <urdf_sensor/sensor.h>
+
+#include "exportdecl.h"
+
+namespace urdf{
+
+/// The <sensor> elements of a robot description, stored contiguously and
+/// grouped by parent link.
+///
+/// Links are numbered in the order of ModelInterface::links_.  The sensors of
+/// link l occupy [firstSensor(l), firstSensor(l) + sensorCount(l)) of
+/// sensors(), in document order, so the sensors mounted on a link and their
+/// frames are found without searching.
+class URDFDOM_DLLAPI SensorTable
+{
+public:
+  SensorTable() { this->clear(); }
+
+  /// Fills the table with sensors.  Returns false, leaving the table empty,
+  /// if a sensor has no visual sensor, names a link that is not part of
+  /// model, or shares its name with another sensor.
+  bool init(const ModelInterface &model, const std::vector<SensorSharedPtr> &sensors);
+
+  void clear();
+
+  bool empty() const { return sensors_.empty(); }
+  std::size_t size() const { return sensors_.size(); }
+
+  const std::vector<Sensor> &sensors() const { return sensors_; }
+  const Sensor &sensor(std::size_t i) const { return sensors_[i]; }
+
+  /// Index of the parent link of sensor i.
+  std::size_t sensorLink(std::size_t i) const { return sensor_link_[i]; }
+
+  /// Sensor called name, or null.
+  const Sensor *findSensor(const std::string &name) const;
+
+  /// Link names in index order.
+  const std::vector<std::string> &links() const { return links_; }
+  std::size_t linkCount() const { return links_.size(); }
+
+  /// Index of link name, or linkCount() if the model has no such link.
+  std::size_t linkIndex(const std::string &name) const;
+
+  std::size_t firstSensor(std::size_t link) const { return link_offset_[link]; }
+  std::size_t sensorCount(std::size_t link) const { return link_offset_[link + 1] - link_offset_[link]; }
+
+private:
+  std::vector<Sensor> sensors_;
+  std::vector<std::size_t> sensor_link_;
+  std::vector<std::string> links_;
+  // link l owns sensors [link_offset_[l], link_offset_[l + 1])
+  std::vector<std::size_t> link_offset_;
+  std::unordered_map<std::string, std::size_t> link_index_;
+  std::unordered_map<std::string, std::size_t> sensor_index_;
+};
+
+}
+
+#endif
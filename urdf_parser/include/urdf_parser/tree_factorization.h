@@ -0,0 +1,77 @@
+#ifndef URDF_PARSER_TREE_FACTORIZATION_H
+#define URDF_PARSER_TREE_FACTORIZATION_H
+
+#include <cstddef>
+#include <vector>
+
+#include "dynamics.h"
+#include "exportdecl.h"
+
+namespace urdf{
+
+/// Sparse factorizations of the joint space mass matrix of a tree, after
+/// Featherstone: M = L^T L or M = L^T D L with L lower triangular and D
+/// diagonal.
+///
+/// Velocity coordinates form a tree of their own: each coordinate's
+/// parent is the previous coordinate of its joint, or the last coordinate
+/// of the nearest movable ancestor for the first one.  M, and L with it,
+/// is nonzero only between a coordinate and its ancestors, so each row is
+/// stored as the diagonal followed by the entries against the ancestors,
+/// nearest first.  Factoring costs the sum of the squared depths rather
+/// than n^3 / 3; branches cause no fill in.  Nothing is allocated after
+/// resize().
+class URDFDOM_DLLAPI TreeFactorization
+{
+public:
+  TreeFactorization() { this->clear(); }
+  explicit TreeFactorization(const DynamicsModel &model) { this->resize(model); }
+
+  void resize(const DynamicsModel &model);
+  void clear();
+
+  std::size_t size() const { return parent_.size(); }
+  /// Parent coordinate of coordinate k, -1 at the root.
+  int parent(std::size_t k) const { return parent_[k]; }
+  /// Number of ancestors of coordinate k.
+  std::size_t depth(std::size_t k) const { return row_begin_[k + 1] - row_begin_[k] - 1; }
+  /// Stored values, against size()^2 for the dense matrix.
+  std::size_t valueCount() const { return values_.size(); }
+
+  /// Factors M = L^T L, or M = L^T D L with unit diagonal L, from the
+  /// blocks of DynamicsModel::massMatrix() or from a dense row-major
+  /// matrix.  Returns false if M is not positive definite.
+  bool factorLTL(const ClusterBlockMatrix &M);
+  bool factorLTL(const double *M);
+  bool factorLTDL(const ClusterBlockMatrix &M);
+  bool factorLTDL(const double *M);
+
+  /// Row k of L: L(k, k) then L(k, a) for the ancestors a of k, nearest
+  /// first.  After factorLTDL() the diagonal holds D(k, k) instead.
+  const double *row(std::size_t k) const { return &values_[row_begin_[k]]; }
+
+  /// x = M^-1 x, and the same for count vectors stored one after another.
+  void solve(double *x) const;
+  void solve(std::size_t count, double *x) const;
+  /// x = L^-1 x and x = L^-T x, so that M^-1 = L^-1 D^-1 L^-T, D being
+  /// the identity after factorLTL().
+  void solveL(double *x) const;
+  void solveLT(double *x) const;
+
+private:
+  void load(const ClusterBlockMatrix &M);
+  void load(const double *M);
+  bool factorLTL();
+  bool factorLTDL();
+
+  std::vector<int> parent_;
+  std::vector<std::size_t> row_begin_;
+  /// Position in ClusterBlockMatrix::data() of every stored entry.
+  std::vector<std::size_t> source_;
+  std::vector<double> values_;
+  bool unit_;
+};
+
+}
+
+#endif
@@ -50,6 +50,7 @@
 #include <urdf_world/types.h>
 
 #include "exportdecl.h"
+#include "sensor_table.h"
 
 namespace tinyxml2{
   // Forward declaration for APIs that use TinyXML2 structures.
@@ -152,6 +153,10 @@ namespace urdf{
   URDFDOM_DLLAPI ModelInterfaceSharedPtr parseURDFFile(const std::string &path);
   URDFDOM_DLLAPI ModelInterfaceSharedPtr parseURDFFiles(const std::vector<std::string> &paths);
 
+  /// Also parses the <sensor> elements of the robot into sensors.
+  URDFDOM_DLLAPI ModelInterfaceSharedPtr parseURDF(const std::string &xml_string, SensorTable &sensors);
+  URDFDOM_DLLAPI ModelInterfaceSharedPtr parseURDFFile(const std::string &path, SensorTable &sensors);
+
   [[deprecated("File an issue at https://github.com/ros/urdfdom if you rely on this")]]
   URDFDOM_DLLAPI tinyxml2::XMLDocument*  exportURDF(ModelInterfaceSharedPtr &model);
 
@@ -0,0 +1,92 @@
+#ifndef URDF_PARSER_WORLD_PARSER_H
+#define URDF_PARSER_WORLD_PARSER_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include <urdf_model/model.h>
+#include <urdf_world/world.h>
+
+#include "exportdecl.h"
+
+namespace urdf{
+
+/// A robot description referenced by a world, parsed once.
+struct WorldModel
+{
+  /// model_name of the <include> element.
+  std::string name;
+  /// Path of the description file, relative paths resolved against the
+  /// directory of the world file.
+  std::string filename;
+  /// Shared by every instance of the model.  Treat as immutable: changing it
+  /// changes all instances.
+  ModelInterfaceSharedPtr model;
+  /// Wall time spent reading and parsing the file.
+  double load_seconds;
+
+  WorldModel() : load_seconds(0.0) {}
+};
+
+/// One placement of a model in the world.
+struct WorldInstance
+{
+  /// Entity name, unique within the world.  Link and joint names of the
+  /// instance are qualified as "<name>/<link or joint name>".
+  std::string name;
+  /// Index into WorldDescription::models.
+  std::size_t model;
+};
+
+/// A parsed <world>:
+///
+///   <world name="cell">
+///     <include filename="arm.urdf" model_name="arm"/>
+///     <entity model="arm" name="left_arm">
+///       <origin xyz="0 0.5 0" rpy="0 0 0"/>
+///       <twist linear="0 0 0" angular="0 0 0"/>
+///     </entity>
+///     <entity model="arm" name="right_arm"> ... </entity>
+///   </world>
+///
+/// Each <include> is parsed once however many entities refer to it, and
+/// includes of the same file share one model.  world.models[i] is the
+/// placement of instances[i]; its model pointer is the shared one.
+struct URDFDOM_DLLAPI WorldDescription
+{
+  World world;
+  std::vector<WorldModel> models;
+  std::vector<WorldInstance> instances;
+  /// Wall time spent loading all models.
+  double load_seconds;
+
+  WorldDescription() : load_seconds(0.0) {}
+
+  void clear();
+
+  /// Index of the instance called name, or instances.size().
+  std::size_t findInstance(const std::string &name) const;
+
+  /// The world-unique name of a link or joint of an instance.
+  std::string qualifiedName(std::size_t instance, const std::string &name) const
+  {
+    return instances[instance].name + "/" + name;
+  }
+};
+
+/// Parses a <world> element.  Relative include filenames are resolved
+/// against base_directory.  The distinct models are parsed concurrently on
+/// up to threads threads (0: one per hardware thread); the result does not
+/// depend on the number of threads.  Returns false, leaving world empty, if
+/// a description cannot be read or an entity is malformed.
+URDFDOM_DLLAPI bool parseWorld(const std::string &xml_string, WorldDescription &world,
+                               const std::string &base_directory = std::string(),
+                               unsigned int threads = 0);
+
+URDFDOM_DLLAPI bool parseWorldFile(const std::string &path, WorldDescription &world,
+                                   unsigned int threads = 0);
+
+}
+
+#endif
@@ -0,0 +1,271 @@
+#include <cmath>
+#include <vector>
+
+#include <urdf_parser/dynamics.h>
+
+#include "./spatial.hpp"
+
+namespace urdf{
+
+// 6x6 articulated inertias are stored row-major, (angular, linear) blocks
+// [A B; B^T C], one cache line aligned block of ARTICULATED_STRIDE values
+// per body
+static const std::size_t ARTICULATED_STRIDE = 40;
+
+static void inertiaToMatrix(const SpatialInertia &I, double *M)
+{
+  const double *h = I.h;
+  const double A[9] = {I.I[0], I.I[1], I.I[2], I.I[1], I.I[3], I.I[4], I.I[2], I.I[4], I.I[5]};
+  // n = I w + h x v, f = m v - h x w
+  const double H[9] = {0.0, -h[2], h[1], h[2], 0.0, -h[0], -h[1], h[0], 0.0};
+  for (int r = 0; r < 3; ++r)
+    for (int c = 0; c < 3; ++c)
+    {
+      M[6 * r + c] = A[3 * r + c];
+      M[6 * r + 3 + c] = H[3 * r + c];
+      M[6 * (3 + r) + c] = -H[3 * r + c];
+      M[6 * (3 + r) + 3 + c] = r == c ? I.mass : 0.0;
+    }
+}
+
+static void multiply6(const double *M, const double *x, double *out)
+{
+  for (int r = 0; r < 6; ++r)
+    out[r] = dot6(M + 6 * r, x);
+}
+
+// out = a b^T for row-major 3x3 matrices
+static void mul33Transposed(const double *a, const double *b, double *out)
+{
+  for (int r = 0; r < 3; ++r)
+    for (int c = 0; c < 3; ++c)
+      out[3 * r + c] = a[3 * r] * b[3 * c] + a[3 * r + 1] * b[3 * c + 1] + a[3 * r + 2] * b[3 * c + 2];
+}
+
+// articulated inertia M of the child expressed about the parent origin in
+// the parent frame, added to out: with the blocks rotated by R,
+//   A + p^ B^T + (p^ B^T)^T - p^ C p^,  B + p^ C,  C
+static void addArticulatedToParent(const RigidTransform &X, const double *M, double *out)
+{
+  double A[9], B[9], C[9];
+  for (int r = 0; r < 3; ++r)
+    for (int c = 0; c < 3; ++c)
+    {
+      A[3 * r + c] = M[6 * r + c];
+      B[3 * r + c] = M[6 * r + 3 + c];
+      C[3 * r + c] = M[6 * (3 + r) + 3 + c];
+    }
+  double RA[9], RB[9], RC[9];
+  mul33(X.R, A, RA);
+  mul33Transposed(RA, X.R, A);
+  mul33(X.R, B, RB);
+  mul33Transposed(RB, X.R, B);
+  mul33(X.R, C, RC);
+  mul33Transposed(RC, X.R, C);
+
+  const double *p = X.p;
+  const double P[9] = {0.0, -p[2], p[1], p[2], 0.0, -p[0], -p[1], p[0], 0.0};
+  double PC[9], PB[9], PCP[9];
+  mul33(P, C, PC);
+  mul33Transposed(P, B, PB);
+  mul33(PC, P, PCP);
+  for (int r = 0; r < 3; ++r)
+    for (int c = 0; c < 3; ++c)
+    {
+      const double b = B[3 * r + c] + PC[3 * r + c];
+      out[6 * r + c] += A[3 * r + c] + PB[3 * r + c] + PB[3 * c + r] - PCP[3 * r + c];
+      out[6 * r + 3 + c] += b;
+      out[6 * (3 + c) + r] += b;
+      out[6 * (3 + r) + 3 + c] += C[3 * r + c];
+    }
+}
+
+// inverse of the symmetric positive definite n x n matrix D through its
+// Cholesky factor; false if D is not positive definite
+static bool invertPositiveDefinite(const double *D, std::size_t n, double *out)
+{
+  if (n == 1)
+  {
+    if (!(D[0] > 0.0))
+      return false;
+    out[0] = 1.0 / D[0];
+    return true;
+  }
+  double L[36];
+  for (std::size_t j = 0; j < n; ++j)
+  {
+    double d = D[j * n + j];
+    for (std::size_t k = 0; k < j; ++k)
+      d -= L[j * n + k] * L[j * n + k];
+    if (!(d > 0.0))
+      return false;
+    L[j * n + j] = std::sqrt(d);
+    for (std::size_t i = j + 1; i < n; ++i)
+    {
+      double s = D[i * n + j];
+      for (std::size_t k = 0; k < j; ++k)
+        s -= L[i * n + k] * L[j * n + k];
+      L[i * n + j] = s / L[j * n + j];
+    }
+  }
+  // columns of L^-T L^-1
+  for (std::size_t c = 0; c < n; ++c)
+  {
+    double x[6];
+    for (std::size_t i = 0; i < n; ++i)
+    {
+      double s = i == c ? 1.0 : 0.0;
+      for (std::size_t k = 0; k < i; ++k)
+        s -= L[i * n + k] * x[k];
+      x[i] = s / L[i * n + i];
+    }
+    for (std::size_t i = n; i-- > 0;)
+    {
+      double s = x[i];
+      for (std::size_t k = i + 1; k < n; ++k)
+        s -= L[k * n + i] * x[k];
+      x[i] = s / L[i * n + i];
+    }
+    for (std::size_t i = 0; i < n; ++i)
+      out[i * n + c] = x[i];
+  }
+  return true;
+}
+
+bool DynamicsModel::forwardDynamics(DynamicsData &data, const double *q, const double *v, const double *tau,
+                                    double *a) const
+{
+  const std::size_t bodies = order_.size();
+  if (bodies == 0)
+    return true;
+
+  // velocities, velocity product accelerations c (in acceleration), bias
+  // forces (in force) and the rigid inertias to start from
+  double *v0 = &data.velocity[0];
+  for (int k = 0; k < 6; ++k)
+    v0[k] = 0.0;
+  for (std::size_t s = 1; s < bodies; ++s)
+  {
+    const std::size_t i = order_[s];
+    const KinematicModel::Body &body = kinematics_.body(i);
+    RigidTransform &X = data.local[s];
+    kinematics_.jointTransform(i, q, X);
+
+    double *vi = &data.velocity[6 * s];
+    double vJ[6] = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+    motionToChild(X, &data.velocity[6 * slot_[body.parent]], vi);
+    for (std::size_t k = 0; k < body.v_size; ++k)
+    {
+      const double *S = &subspace_[6 * (body.v_offset + k)];
+      const double vk = v[body.v_offset + k];
+      for (int c = 0; c < 6; ++c)
+        vJ[c] += S[c] * vk;
+    }
+    for (int c = 0; c < 6; ++c)
+      vi[c] += vJ[c];
+    crossMotion(vi, vJ, &data.acceleration[6 * s]);
+
+    double Iv[6];
+    applyInertia(inertias_[i], vi, Iv);
+    crossForce(vi, Iv, &data.force[6 * s]);
+    inertiaToMatrix(inertias_[i], &data.articulated_inertia[ARTICULATED_STRIDE * s]);
+  }
+
+  // articulated inertias and bias forces, leaves first; a holds
+  // u = tau - S^T p until the last pass
+  for (std::size_t s = bodies; s-- > 1;)
+  {
+    const KinematicModel::Body &body = kinematics_.body(order_[s]);
+    const std::size_t n = body.v_size, parent = slot_[body.parent];
+    double *IA = &data.articulated_inertia[ARTICULATED_STRIDE * s];
+    double *pA = &data.force[6 * s];
+    double *U = &data.joint_inertia[6 * body.v_offset];
+    double *Dinv = &data.joint_inverse[6 * body.v_offset];
+    const double *S = &subspace_[6 * body.v_offset];
+    double D[36];
+    for (std::size_t k = 0; k < n; ++k)
+    {
+      multiply6(IA, S + 6 * k, U + 6 * k);
+      a[body.v_offset + k] = tau[body.v_offset + k] - dot6(S + 6 * k, pA);
+      for (std::size_t l = 0; l < n; ++l)
+        D[k * n + l] = dot6(S + 6 * k, U + 6 * l);
+    }
+    if (n > 0 && !invertPositiveDefinite(D, n, Dinv))
+      return false;
+    if (parent == 0)
+      continue;
+
+    // Ia = IA - U D^-1 U^T, pa = pA + Ia c + U D^-1 u
+    double W[36], Ia[36], pa[6];
+    for (int r = 0; r < 6; ++r)
+      for (std::size_t k = 0; k < n; ++k)
+      {
+        double w = 0.0;
+        for (std::size_t l = 0; l < n; ++l)
+          w += U[6 * l + r] * Dinv[l * n + k];
+        W[6 * k + r] = w;
+      }
+    for (int r = 0; r < 6; ++r)
+      for (int c = r; c < 6; ++c)
+      {
+        double m = IA[6 * r + c];
+        for (std::size_t k = 0; k < n; ++k)
+          m -= W[6 * k + r] * U[6 * k + c];
+        Ia[6 * r + c] = Ia[6 * c + r] = m;
+      }
+    multiply6(Ia, &data.acceleration[6 * s], pa);
+    for (int r = 0; r < 6; ++r)
+    {
+      pa[r] += pA[r];
+      for (std::size_t k = 0; k < n; ++k)
+        pa[r] += W[6 * k + r] * a[body.v_offset + k];
+    }
+    addArticulatedToParent(data.local[s], Ia, &data.articulated_inertia[ARTICULATED_STRIDE * parent]);
+    double fp[6];
+    forceToParent(data.local[s], pa, fp);
+    double *pp = &data.force[6 * parent];
+    for (int c = 0; c < 6; ++c)
+      pp[c] += fp[c];
+  }
+
+  // accelerations, root first; gravity enters as an upward acceleration of
+  // the root
+  double *a0 = &data.acceleration[0];
+  a0[0] = a0[1] = a0[2] = 0.0;
+  a0[3] = -gravity_[0];
+  a0[4] = -gravity_[1];
+  a0[5] = -gravity_[2];
+  for (std::size_t s = 1; s < bodies; ++s)
+  {
+    const KinematicModel::Body &body = kinematics_.body(order_[s]);
+    const std::size_t n = body.v_size;
+    const double *U = &data.joint_inertia[6 * body.v_offset];
+    const double *Dinv = &data.joint_inverse[6 * body.v_offset];
+    const double *S = &subspace_[6 * body.v_offset];
+    double *ai = &data.acceleration[6 * s];
+    double ap[6];
+    motionToChild(data.local[s], &data.acceleration[6 * slot_[body.parent]], ap);
+    for (int c = 0; c < 6; ++c)
+      ai[c] += ap[c];
+
+    double r[6], qdd[6];
+    for (std::size_t k = 0; k < n; ++k)
+      r[k] = a[body.v_offset + k] - dot6(U + 6 * k, ai);
+    for (std::size_t k = 0; k < n; ++k)
+    {
+      double x = 0.0;
+      for (std::size_t l = 0; l < n; ++l)
+        x += Dinv[k * n + l] * r[l];
+      qdd[k] = x;
+    }
+    for (std::size_t k = 0; k < n; ++k)
+    {
+      a[body.v_offset + k] = qdd[k];
+      for (int c = 0; c < 6; ++c)
+        ai[c] += S[6 * k + c] * qdd[k];
+    }
+  }
+  return true;
+}
+
+}
@@ -0,0 +1,145 @@
+#include <cmath>
+#include <limits>
+#include <console_bridge/console.h>
+
+#include <urdf_parser/camera_model.h>
+
+#ifndef M_PI
+  # define M_PI 3.141592653589793
+#endif
+
+namespace urdf{
+
+static void setPlane(CameraModel::Plane &plane, double nx, double ny, double nz, double offset)
+{
+  const double norm = std::sqrt(nx * nx + ny * ny + nz * nz);
+  plane.normal[0] = nx / norm;
+  plane.normal[1] = ny / norm;
+  plane.normal[2] = nz / norm;
+  plane.offset = offset / norm;
+}
+
+void CameraModel::clear()
+{
+  width_ = 0;
+  height_ = 0;
+  fx_ = fy_ = cx_ = cy_ = 0.0;
+  near_ = far_ = 0.0;
+  vfov_ = 0.0;
+  for (std::size_t i = 0; i < PLANE_COUNT; ++i)
+    setPlane(planes_[i], 0.0, 0.0, 1.0, 0.0);
+}
+
+bool CameraModel::init(const Camera &camera)
+{
+  this->clear();
+
+  if (camera.width == 0 || camera.height == 0)
+  {
+    CONSOLE_BRIDGE_logError("Camera image size [%u x %u] is empty", camera.width, camera.height);
+    return false;
+  }
+  if (!(camera.hfov > 0.0 && camera.hfov < M_PI))
+  {
+    CONSOLE_BRIDGE_logError("Camera hfov [%f] must lie in (0, pi)", camera.hfov);
+    return false;
+  }
+  if (!(camera.near > 0.0 && camera.near < camera.far))
+  {
+    CONSOLE_BRIDGE_logError("Camera clip distances [%f, %f] must satisfy 0 < near < far", camera.near, camera.far);
+    return false;
+  }
+
+  width_ = camera.width;
+  height_ = camera.height;
+  fx_ = width_ / (2.0 * std::tan(camera.hfov / 2.0));
+  fy_ = fx_;
+  cx_ = width_ / 2.0;
+  cy_ = height_ / 2.0;
+  near_ = camera.near;
+  far_ = camera.far;
+  vfov_ = 2.0 * std::atan(height_ / (2.0 * fy_));
+
+  // u >= 0, u <= width, v >= 0 and v <= height, multiplied through by z > 0
+  setPlane(planes_[NEAR_PLANE], 0.0, 0.0, 1.0, -near_);
+  setPlane(planes_[FAR_PLANE], 0.0, 0.0, -1.0, far_);
+  setPlane(planes_[LEFT_PLANE], fx_, 0.0, cx_, 0.0);
+  setPlane(planes_[RIGHT_PLANE], -fx_, 0.0, width_ - cx_, 0.0);
+  setPlane(planes_[TOP_PLANE], 0.0, fy_, cy_, 0.0);
+  setPlane(planes_[BOTTOM_PLANE], 0.0, -fy_, height_ - cy_, 0.0);
+  return true;
+}
+
+bool CameraModel::init(const Sensor &sensor)
+{
+  const Camera *camera = dynamic_cast<const Camera *>(sensor.sensor.get());
+  if (!camera)
+  {
+    CONSOLE_BRIDGE_logError("Sensor [%s] is not a camera", sensor.name.c_str());
+    this->clear();
+    return false;
+  }
+  return this->init(*camera);
+}
+
+void CameraModel::project(std::size_t count, const double *x, const double *y, const double *z,
+                          double *u, double *v) const
+{
+  const double fx = fx_, fy = fy_, cx = cx_, cy = cy_;
+  const double nan = std::numeric_limits<double>::quiet_NaN();
+  for (std::size_t i = 0; i < count; ++i)
+  {
+    const double inv_z = z[i] > 0.0 ? 1.0 / z[i] : nan;
+    u[i] = fx * x[i] * inv_z + cx;
+    v[i] = fy * y[i] * inv_z + cy;
+  }
+}
+
+void CameraModel::unproject(std::size_t count, const double *u, const double *v, const double *depth,
+                            double *x, double *y, double *z) const
+{
+  const double inv_fx = 1.0 / fx_, inv_fy = 1.0 / fy_, cx = cx_, cy = cy_;
+  for (std::size_t i = 0; i < count; ++i)
+  {
+    const double d = depth[i];
+    x[i] = (u[i] - cx) * inv_fx * d;
+    y[i] = (v[i] - cy) * inv_fy * d;
+    z[i] = d;
+  }
+}
+
+std::size_t CameraModel::cull(std::size_t count, const double *x, const double *y, const double *z,
+                              uint8_t *inside) const
+{
+  // the side planes pass through the optical center and the near and far
+  // planes are axis aligned, so the tests reduce to a few multiply-adds
+  const double near_clip = near_, far_clip = far_;
+  const double fx = fx_, fy = fy_, cx = cx_, cy = cy_;
+  const double rx = width_ - cx_, by = height_ - cy_;
+  std::size_t n = 0;
+  for (std::size_t i = 0; i < count; ++i)
+  {
+    const double px = fx * x[i], py = fy * y[i], pz = z[i];
+    const bool in = (pz >= near_clip) & (pz <= far_clip) &
+                    (px + cx * pz >= 0.0) & (rx * pz - px >= 0.0) &
+                    (py + cy * pz >= 0.0) & (by * pz - py >= 0.0);
+    inside[i] = in;
+    n += in;
+  }
+  return n;
+}
+
+std::size_t CameraModel::cullDepth(std::size_t count, const double *z, uint8_t *inside) const
+{
+  const double near_clip = near_, far_clip = far_;
+  std::size_t n = 0;
+  for (std::size_t i = 0; i < count; ++i)
+  {
+    const bool in = (z[i] >= near_clip) & (z[i] <= far_clip);
+    inside[i] = in;
+    n += in;
+  }
+  return n;
+}
+
+}
@@ -0,0 +1,156 @@
+#ifndef URDF_PARSER_DOUBLE_LIST_HPP
+#define URDF_PARSER_DOUBLE_LIST_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <urdf_exception/exception.h>
+#include <urdf_model/utils.h>
+
+namespace urdf {
+
+inline bool isListSeparator(char c)
+{
+  return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+// Parses the number starting at str without consulting the locale.  Plain
+// decimal numbers with at most 19 significant digits and a small exponent are
+// converted exactly (the mantissa and the power of ten are both exactly
+// representable, so a single multiplication or division rounds correctly).
+// Everything else is left to strToDouble.  On return end points one past the
+// last character of the token.
+inline double parseDoubleToken(const char *str, const char *&end)
+{
+  static const double powers_of_ten[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+  const char *p = str;
+  bool negative = false;
+  if (*p == '-' || *p == '+')
+  {
+    negative = (*p == '-');
+    ++p;
+  }
+
+  uint64_t mantissa = 0;
+  int digits = 0;
+  int exponent = 0;
+  bool any_digit = false;
+  bool exact = true;
+
+  for (; *p >= '0' && *p <= '9'; ++p)
+  {
+    any_digit = true;
+    if (mantissa == 0 && *p == '0')
+      continue;
+    if (digits < 19)
+    {
+      mantissa = mantissa * 10 + static_cast<uint64_t>(*p - '0');
+      ++digits;
+    }
+    else
+    {
+      exact = false;
+    }
+  }
+  if (*p == '.')
+  {
+    ++p;
+    for (; *p >= '0' && *p <= '9'; ++p)
+    {
+      any_digit = true;
+      if (mantissa == 0 && *p == '0')
+      {
+        --exponent;
+        continue;
+      }
+      if (digits < 19)
+      {
+        mantissa = mantissa * 10 + static_cast<uint64_t>(*p - '0');
+        ++digits;
+        --exponent;
+      }
+      else
+      {
+        exact = false;
+      }
+    }
+  }
+  if (any_digit && (*p == 'e' || *p == 'E'))
+  {
+    const char *exp_start = p;
+    ++p;
+    bool exp_negative = false;
+    if (*p == '-' || *p == '+')
+    {
+      exp_negative = (*p == '-');
+      ++p;
+    }
+    if (*p >= '0' && *p <= '9')
+    {
+      int exp_value = 0;
+      for (; *p >= '0' && *p <= '9'; ++p)
+      {
+        if (exp_value < 10000)
+          exp_value = exp_value * 10 + (*p - '0');
+      }
+      exponent += exp_negative ? -exp_value : exp_value;
+    }
+    else
+    {
+      p = exp_start;
+    }
+  }
+
+  const char *token_end = p;
+  while (*token_end != '\0' && !isListSeparator(*token_end))
+    ++token_end;
+  end = token_end;
+
+  if (any_digit && p == token_end && exact &&
+      mantissa <= (static_cast<uint64_t>(1) << 53) &&
+      exponent >= -22 && exponent <= 22)
+  {
+    double value = static_cast<double>(mantissa);
+    if (exponent < 0)
+      value /= powers_of_ten[-exponent];
+    else
+      value *= powers_of_ten[exponent];
+    return negative ? -value : value;
+  }
+
+  // Slow path: hand the token to the locale independent converter.
+  return strToDouble(std::string(str, token_end).c_str());
+}
+
+// Appends every whitespace separated number in str to values.  The vector is
+// not cleared, so callers that reuse it across records keep its capacity.
+// Throws ParseError naming the element if a token is not a valid float.
+inline void parseDoubleList(const char *str, std::vector<double> &values, const char *element)
+{
+  const char *p = str;
+  while (true)
+  {
+    while (isListSeparator(*p))
+      ++p;
+    if (*p == '\0')
+      break;
+
+    const char *end = p;
+    try {
+      values.push_back(parseDoubleToken(p, end));
+    } catch(std::runtime_error &) {
+      throw ParseError(std::string(element) + " element (" + std::string(p, end) + ") is not a valid float");
+    }
+    p = end;
+  }
+}
+
+}
+
+#endif
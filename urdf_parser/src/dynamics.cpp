@@ -0,0 +1,339 @@
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+#include <console_bridge/console.h>
+
+#include <urdf_parser/dynamics.h>
+
+#include "./spatial.hpp"
+
+namespace urdf{
+
+void DynamicsModel::clear()
+{
+  kinematics_.clear();
+  clusters_.clear();
+  cluster_of_.clear();
+  order_.clear();
+  slot_.clear();
+  velocity_order_.clear();
+  inertias_.clear();
+  subtree_mass_.clear();
+  subspace_.clear();
+  gravity_[0] = 0.0;
+  gravity_[1] = 0.0;
+  gravity_[2] = -9.81;
+}
+
+void DynamicsModel::setGravity(const double *gravity)
+{
+  gravity_[0] = gravity[0];
+  gravity_[1] = gravity[1];
+  gravity_[2] = gravity[2];
+}
+
+bool DynamicsModel::init(const ModelInterface &model)
+{
+  this->clear();
+  if (!kinematics_.init(model))
+    return false;
+
+  const std::size_t bodies = kinematics_.bodyCount();
+  inertias_.resize(bodies);
+  subspace_.resize(6 * kinematics_.velocitySize());
+  for (std::size_t i = 0; i < bodies; ++i)
+  {
+    LinkConstSharedPtr link = model.getLink(kinematics_.linkName(i));
+    if (link && link->inertial)
+      inertialToSpatial(*link->inertial, inertias_[i]);
+    else
+      inertias_[i].setZero();
+    const KinematicModel::Body &body = kinematics_.body(i);
+    jointSubspace(body, &subspace_[6 * body.v_offset]);
+  }
+
+  subtree_mass_.resize(bodies);
+  for (std::size_t i = 0; i < bodies; ++i)
+    subtree_mass_[i] = inertias_[i].mass;
+  for (std::size_t i = bodies; i-- > 1;)
+    subtree_mass_[kinematics_.body(i).parent] += subtree_mass_[i];
+
+  // number the clusters in the order their first body is reached, which
+  // puts every parent cluster before its children
+  std::map<std::size_t, std::size_t> numbers;
+  cluster_of_.resize(bodies);
+  for (std::size_t i = 0; i < bodies; ++i)
+  {
+    std::map<std::string, size_t>::const_iterator c = model.containing_cluster_.find(kinematics_.linkName(i));
+    std::size_t number = clusters_.size();
+    if (c != model.containing_cluster_.end())
+    {
+      std::map<std::size_t, std::size_t>::const_iterator n = numbers.find(c->second);
+      if (n != numbers.end())
+        number = n->second;
+      else
+        numbers[c->second] = number;
+    }
+    if (number == clusters_.size())
+    {
+      Cluster cluster;
+      const int parent = kinematics_.body(i).parent;
+      cluster.parent = parent < 0 ? -1 : static_cast<int>(cluster_of_[parent]);
+      cluster.first = cluster.end = 0;
+      cluster.v_first = cluster.v_size = 0;
+      cluster.depth = cluster.parent < 0 ? 0 : clusters_[cluster.parent].depth + 1;
+      clusters_.push_back(cluster);
+    }
+    cluster_of_[i] = number;
+    clusters_[number].end++;
+    clusters_[number].v_size += kinematics_.body(i).v_size;
+  }
+
+  // counting sort of the bodies by cluster, stable in body order
+  std::size_t first = 0, v_first = 0;
+  for (std::size_t c = 0; c < clusters_.size(); ++c)
+  {
+    const std::size_t size = clusters_[c].end;
+    clusters_[c].first = clusters_[c].end = first;
+    clusters_[c].v_first = v_first;
+    first += size;
+    v_first += clusters_[c].v_size;
+  }
+  order_.resize(bodies);
+  slot_.resize(bodies);
+  for (std::size_t i = 0; i < bodies; ++i)
+  {
+    Cluster &cluster = clusters_[cluster_of_[i]];
+    slot_[i] = cluster.end;
+    order_[cluster.end++] = i;
+  }
+  for (std::size_t s = 0; s < bodies; ++s)
+  {
+    const KinematicModel::Body &body = kinematics_.body(order_[s]);
+    for (std::size_t k = 0; k < body.v_size; ++k)
+      velocity_order_.push_back(body.v_offset + k);
+  }
+
+  for (std::size_t i = 1; i < bodies; ++i)
+  {
+    const std::size_t parent = kinematics_.body(i).parent;
+    if (cluster_of_[parent] != cluster_of_[i] &&
+        static_cast<int>(cluster_of_[parent]) != clusters_[cluster_of_[i]].parent)
+    {
+      // the block layout of the mass matrix needs one parent cluster per cluster
+      CONSOLE_BRIDGE_logError("Link [%s] enters its cluster from another parent cluster than the rest of it",
+                              kinematics_.linkName(i).c_str());
+      this->clear();
+      return false;
+    }
+  }
+  return true;
+}
+
+void DynamicsData::resize(const DynamicsModel &model)
+{
+  const std::size_t bodies = model.kinematics().bodyCount();
+  local.resize(bodies);
+  world.resize(bodies);
+  velocity.assign(6 * bodies, 0.0);
+  acceleration.assign(6 * bodies, 0.0);
+  force.assign(6 * bodies, 0.0);
+  composite.resize(bodies);
+  articulated_inertia.assign(40 * bodies, 0.0);
+  joint_inertia.assign(6 * model.kinematics().velocitySize(), 0.0);
+  joint_inverse.assign(6 * model.kinematics().velocitySize(), 0.0);
+}
+
+void DynamicsModel::motionPass(DynamicsData &data, const double *q, const double *v, const double *a) const
+{
+  const std::size_t bodies = order_.size();
+
+  // the root does not move; gravity enters as an upward acceleration of it
+  double *v0 = &data.velocity[0], *a0 = &data.acceleration[0];
+  for (int k = 0; k < 6; ++k)
+    v0[k] = a0[k] = 0.0;
+  a0[3] = -gravity_[0];
+  a0[4] = -gravity_[1];
+  a0[5] = -gravity_[2];
+
+  // in order(), parents first
+  for (std::size_t s = 1; s < bodies; ++s)
+  {
+    const std::size_t i = order_[s];
+    const KinematicModel::Body &body = kinematics_.body(i);
+    const std::size_t p = slot_[body.parent];
+    RigidTransform &X = data.local[s];
+    kinematics_.jointTransform(i, q, X);
+
+    double *vi = &data.velocity[6 * s], *ai = &data.acceleration[6 * s];
+    double vJ[6] = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+    motionToChild(X, &data.velocity[6 * p], vi);
+    motionToChild(X, &data.acceleration[6 * p], ai);
+    for (std::size_t k = 0; k < body.v_size; ++k)
+    {
+      const double *S = &subspace_[6 * (body.v_offset + k)];
+      const double vk = v[body.v_offset + k], ak = a[body.v_offset + k];
+      for (int c = 0; c < 6; ++c)
+      {
+        vJ[c] += S[c] * vk;
+        ai[c] += S[c] * ak;
+      }
+    }
+    double bias[6];
+    crossMotion(vi, vJ, bias);
+    for (int c = 0; c < 6; ++c)
+    {
+      ai[c] += bias[c];
+      vi[c] += vJ[c];
+    }
+  }
+}
+
+void DynamicsModel::inverseDynamics(DynamicsData &data, const double *q, const double *v, const double *a,
+                                    double *tau) const
+{
+  const std::size_t bodies = order_.size();
+  if (bodies == 0)
+    return;
+
+  // forward pass, then the body forces f = I a + v x* I v
+  this->motionPass(data, q, v, a);
+  for (int k = 0; k < 6; ++k)
+    data.force[k] = 0.0;
+  for (std::size_t s = 1; s < bodies; ++s)
+  {
+    const std::size_t i = order_[s];
+    const double *vi = &data.velocity[6 * s], *ai = &data.acceleration[6 * s];
+    double *fi = &data.force[6 * s];
+    double Iv[6], bias[6];
+    applyInertia(inertias_[i], ai, fi);
+    applyInertia(inertias_[i], vi, Iv);
+    crossForce(vi, Iv, bias);
+    for (int c = 0; c < 6; ++c)
+      fi[c] += bias[c];
+  }
+
+  // backward pass: project the forces on the joints, pass them to the parent
+  for (std::size_t s = bodies; s-- > 1;)
+  {
+    const KinematicModel::Body &body = kinematics_.body(order_[s]);
+    const double *fi = &data.force[6 * s];
+    for (std::size_t k = 0; k < body.v_size; ++k)
+      tau[body.v_offset + k] = dot6(&subspace_[6 * (body.v_offset + k)], fi);
+    double fp[6];
+    forceToParent(data.local[s], fi, fp);
+    double *parent = &data.force[6 * slot_[body.parent]];
+    for (int c = 0; c < 6; ++c)
+      parent[c] += fp[c];
+  }
+}
+
+void DynamicsModel::gravityTorques(DynamicsData &data, const double *q, double *tau) const
+{
+  const std::size_t bodies = order_.size();
+  if (bodies == 0)
+    return;
+
+  // gravity in every body frame, kept in the linear part of acceleration,
+  // and the first moment of mass of each body in force
+  double *g0 = &data.acceleration[3];
+  g0[0] = gravity_[0];
+  g0[1] = gravity_[1];
+  g0[2] = gravity_[2];
+  for (int c = 0; c < 3; ++c)
+    data.force[c] = inertias_[order_[0]].h[c];
+  for (std::size_t s = 1; s < bodies; ++s)
+  {
+    const std::size_t i = order_[s];
+    RigidTransform &X = data.local[s];
+    kinematics_.jointTransform(i, q, X);
+    rotateTransposed(X.R, &data.acceleration[6 * slot_[kinematics_.body(i).parent] + 3], &data.acceleration[6 * s + 3]);
+    for (int c = 0; c < 3; ++c)
+      data.force[6 * s + c] = inertias_[i].h[c];
+  }
+
+  // subtree first moments h about each body origin give the torque
+  // -(S_angular . h x g + S_linear . m g)
+  for (std::size_t s = bodies; s-- > 1;)
+  {
+    const std::size_t i = order_[s];
+    const KinematicModel::Body &body = kinematics_.body(i);
+    const double *h = &data.force[6 * s], *g = &data.acceleration[6 * s + 3];
+    const double m = subtree_mass_[i];
+    double hg[3];
+    cross(h, g, hg);
+    for (std::size_t k = 0; k < body.v_size; ++k)
+    {
+      const double *S = &subspace_[6 * (body.v_offset + k)];
+      tau[body.v_offset + k] = -(dot(S, hg) + m * dot(S + 3, g));
+    }
+    const RigidTransform &X = data.local[s];
+    double Rh[3];
+    rotate(X.R, h, Rh);
+    double *hp = &data.force[6 * slot_[body.parent]];
+    for (int c = 0; c < 3; ++c)
+      hp[c] += Rh[c] + m * X.p[c];
+  }
+}
+
+void DynamicsModel::centerOfMass(DynamicsData &data, const double *q, double *com, double *J) const
+{
+  const std::size_t bodies = order_.size(), nv = kinematics_.velocitySize();
+  const double total = this->totalMass();
+  com[0] = com[1] = com[2] = 0.0;
+  if (J)
+    std::fill(J, J + 3 * nv, 0.0);
+  if (bodies == 0 || total <= 0.0)
+    return;
+
+  // the first moment of mass of every body in the root frame, kept in the
+  // angular part of force
+  data.world[0].setIdentity();
+  for (int c = 0; c < 3; ++c)
+    data.force[c] = inertias_[order_[0]].h[c];
+  for (std::size_t s = 1; s < bodies; ++s)
+  {
+    const std::size_t i = order_[s];
+    kinematics_.jointTransform(i, q, data.local[s]);
+    const RigidTransform &parent = data.world[slot_[kinematics_.body(i).parent]];
+    RigidTransform &X = data.world[s];
+    compose(parent, data.local[s], X);
+    double *h = &data.force[6 * s];
+    rotate(X.R, inertias_[i].h, h);
+    for (int c = 0; c < 3; ++c)
+      h[c] += inertias_[i].mass * X.p[c];
+  }
+
+  // subtree sums, then the velocity of the subtree mass about each joint:
+  // m v_i + w_i x (h - m p_i) for the root frame motion (w_i, v_i) of a
+  // coordinate at the body origin p_i
+  for (std::size_t s = bodies; s-- > 1;)
+  {
+    const std::size_t i = order_[s];
+    const KinematicModel::Body &body = kinematics_.body(i);
+    const double *h = &data.force[6 * s];
+    double *hp = &data.force[6 * slot_[body.parent]];
+    for (int c = 0; c < 3; ++c)
+      hp[c] += h[c];
+    if (!J)
+      continue;
+    const RigidTransform &X = data.world[s];
+    const double m = subtree_mass_[i];
+    const double arm[3] = {h[0] - m * X.p[0], h[1] - m * X.p[1], h[2] - m * X.p[2]};
+    for (std::size_t k = 0; k < body.v_size; ++k)
+    {
+      const double *S = &subspace_[6 * (body.v_offset + k)];
+      double w[3], v[3], wh[3];
+      rotate(X.R, S, w);
+      rotate(X.R, S + 3, v);
+      cross(w, arm, wh);
+      for (int c = 0; c < 3; ++c)
+        J[c * nv + body.v_offset + k] = (m * v[c] + wh[c]) / total;
+    }
+  }
+  for (int c = 0; c < 3; ++c)
+    com[c] = data.force[c] / total;
+}
+
+}
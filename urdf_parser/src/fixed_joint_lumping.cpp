@@ -0,0 +1,230 @@
+#include <map>
+#include <string>
+#include <vector>
+#include <console_bridge/console.h>
+
+#include <urdf_parser/fixed_joint_lumping.h>
+
+#include "./spatial.hpp"
+
+namespace urdf{
+
+void FrameTable::clear()
+{
+  frames_.clear();
+  index_.clear();
+  body_.clear();
+}
+
+void FrameTable::add(const std::string &name, const std::string &link, const RigidTransform &offset)
+{
+  index_[name] = frames_.size();
+  Frame frame;
+  frame.name = name;
+  frame.link = link;
+  frame.offset = offset;
+  frames_.push_back(frame);
+  body_.clear();
+}
+
+std::size_t FrameTable::frameIndex(const std::string &name) const
+{
+  std::map<std::string, std::size_t>::const_iterator it = index_.find(name);
+  return it == index_.end() ? frames_.size() : it->second;
+}
+
+bool FrameTable::bind(const KinematicModel &kinematics)
+{
+  body_.resize(frames_.size());
+  for (std::size_t k = 0; k < frames_.size(); ++k)
+  {
+    body_[k] = kinematics.linkIndex(frames_[k].link);
+    if (body_[k] >= kinematics.bodyCount())
+    {
+      CONSOLE_BRIDGE_logError("Frame [%s] is on link [%s], which is not in the model",
+                              frames_[k].name.c_str(), frames_[k].link.c_str());
+      body_.clear();
+      return false;
+    }
+  }
+  return true;
+}
+
+void FrameTable::pose(const RigidTransform *poses, std::size_t k, RigidTransform &out) const
+{
+  compose(poses[body_[k]], frames_[k].offset, out);
+}
+
+static Pose composePoses(const Pose &a, const Pose &b)
+{
+  Pose out;
+  out.rotation = a.rotation * b.rotation;
+  out.position = a.position;
+  out.position = out.position + a.rotation * b.position;
+  return out;
+}
+
+ModelInterfaceSharedPtr lumpFixedJoints(const ModelInterface &model, FrameTable &frames)
+{
+  frames.clear();
+  ModelInterfaceSharedPtr reduced;
+  LinkConstSharedPtr root = model.getRoot();
+  if (!root)
+  {
+    CONSOLE_BRIDGE_logError("Cannot lump the fixed joints of model [%s]: it has no root link",
+                            model.getName().c_str());
+    return reduced;
+  }
+
+  std::map<std::string, bool> coupled;
+  for (std::map<std::string, ConstraintSharedPtr>::const_iterator c = model.constraints_.begin();
+       c != model.constraints_.end(); ++c)
+    if (c->second->class_type == Constraint::COUPLING)
+      coupled[c->second->predecessor_link_name] = coupled[c->second->successor_link_name] = true;
+
+  // the link each link merges into and its pose there, root first so that
+  // parents are placed before their children
+  std::map<std::string, std::string> target;
+  std::map<std::string, Pose> offset;
+  std::vector<LinkConstSharedPtr> order(1, root);
+  target[root->name] = root->name;
+  offset[root->name] = Pose();
+  for (std::size_t n = 0; n < order.size(); ++n)
+  {
+    const Link &link = *order[n];
+    for (std::size_t k = 0; k < link.child_joints.size(); ++k)
+    {
+      const Joint &joint = *link.child_joints[k];
+      LinkConstSharedPtr child = link.child_links[k];
+      if (joint.type == Joint::FIXED && !coupled.count(child->name))
+      {
+        target[child->name] = target[link.name];
+        offset[child->name] = composePoses(offset[link.name], joint.parent_to_joint_origin_transform);
+      }
+      else
+      {
+        target[child->name] = child->name;
+        offset[child->name] = Pose();
+      }
+      order.push_back(child);
+    }
+  }
+
+  reduced.reset(new ModelInterface());
+  reduced->name_ = model.name_;
+  reduced->materials_ = model.materials_;
+  // inertias about the origin of the link they merge into
+  std::map<std::string, SpatialInertia> inertias;
+  for (std::size_t n = 0; n < order.size(); ++n)
+  {
+    const Link &link = *order[n];
+    const std::string &into = target[link.name];
+    const Pose &placed = offset[link.name];
+    RigidTransform X;
+    poseToTransform(placed, X);
+    frames.add(link.name, into, X);
+
+    LinkSharedPtr merged;
+    if (into == link.name)
+    {
+      merged.reset(new Link());
+      merged->name = link.name;
+      reduced->links_[link.name] = merged;
+    }
+    else
+      reduced->getLink(into, merged);
+
+    if (link.inertial)
+    {
+      SpatialInertia I;
+      inertialToSpatial(*link.inertial, I);
+      if (!inertias.count(into))
+        inertias[into].setZero();
+      addInertiaToParent(X, I, inertias[into]);
+    }
+    for (std::size_t k = 0; k < link.visual_array.size(); ++k)
+    {
+      VisualSharedPtr visual(new Visual(*link.visual_array[k]));
+      visual->origin = composePoses(placed, visual->origin);
+      merged->visual_array.push_back(visual);
+      if (!merged->visual)
+        merged->visual = visual;
+    }
+    for (std::size_t k = 0; k < link.collision_array.size(); ++k)
+    {
+      CollisionSharedPtr collision(new Collision(*link.collision_array[k]));
+      collision->origin = composePoses(placed, collision->origin);
+      merged->collision_array.push_back(collision);
+      if (!merged->collision)
+        merged->collision = collision;
+    }
+
+    // the joints that remain leave the merged link
+    if (into != link.name || !link.parent_joint)
+      continue;
+    JointSharedPtr joint(new Joint(*link.parent_joint));
+    const std::string parent = joint->parent_link_name;
+    joint->parent_link_name = target[parent];
+    joint->parent_to_joint_origin_transform =
+      composePoses(offset[parent], joint->parent_to_joint_origin_transform);
+    reduced->joints_[joint->name] = joint;
+  }
+  for (std::map<std::string, SpatialInertia>::const_iterator m = inertias.begin(); m != inertias.end(); ++m)
+  {
+    LinkSharedPtr merged;
+    reduced->getLink(m->first, merged);
+    merged->inertial.reset(new Inertial());
+    if (m->second.mass > 0.0)
+      spatialToInertial(m->second, *merged->inertial);
+  }
+
+  for (std::map<std::string, ConstraintSharedPtr>::const_iterator c = model.constraints_.begin();
+       c != model.constraints_.end(); ++c)
+  {
+    LoopConstraintSharedPtr loop = std::dynamic_pointer_cast<LoopConstraint>(c->second);
+    CouplingConstraintSharedPtr coupling = std::dynamic_pointer_cast<CouplingConstraint>(c->second);
+    ConstraintSharedPtr constraint;
+    if (loop)
+    {
+      LoopConstraintSharedPtr moved(new LoopConstraint(*loop));
+      moved->predecessor_to_constraint_origin_transform =
+        composePoses(offset[loop->predecessor_link_name], loop->predecessor_to_constraint_origin_transform);
+      moved->successor_to_constraint_origin_transform =
+        composePoses(offset[loop->successor_link_name], loop->successor_to_constraint_origin_transform);
+      constraint = moved;
+    }
+    else if (coupling)
+      constraint.reset(new CouplingConstraint(*coupling));
+    else
+    {
+      CONSOLE_BRIDGE_logWarn("Constraint [%s] of unknown class is dropped from the reduced model",
+                             c->second->name.c_str());
+      continue;
+    }
+    constraint->predecessor_link_name = target[constraint->predecessor_link_name];
+    constraint->successor_link_name = target[constraint->successor_link_name];
+    if (loop && constraint->predecessor_link_name == constraint->successor_link_name)
+    {
+      CONSOLE_BRIDGE_logWarn("Loop constraint [%s] joins two links merged into [%s] and is dropped",
+                             constraint->name.c_str(), constraint->predecessor_link_name.c_str());
+      continue;
+    }
+    reduced->constraints_[constraint->name] = constraint;
+  }
+
+  std::map<std::string, std::string> parent_link_tree;
+  try
+  {
+    reduced->initTree(parent_link_tree);
+    reduced->initRoot(parent_link_tree);
+  }
+  catch (ParseError &e)
+  {
+    CONSOLE_BRIDGE_logError("Failed to build the reduced tree: %s", e.what());
+    reduced.reset();
+    frames.clear();
+  }
+  return reduced;
+}
+
+}
@@ -0,0 +1,124 @@
+#include <algorithm>
+#include <vector>
+
+#include <urdf_parser/forward_kinematics_cache.h>
+
+#include "./rigid_transform.hpp"
+
+namespace urdf{
+
+void ForwardKinematicsCache::init(const KinematicModel &kinematics)
+{
+  kinematics_ = kinematics;
+  const std::size_t bodies = kinematics.bodyCount();
+  q_.resize(kinematics.positionSize());
+  kinematics.neutralConfiguration(q_.data());
+  body_of_.resize(kinematics.positionSize());
+  for (std::size_t i = 0; i < bodies; ++i)
+  {
+    const KinematicModel::Body &body = kinematics.body(i);
+    for (std::size_t k = 0; k < body.q_size; ++k)
+      body_of_[body.q_offset + k] = i;
+  }
+  local_.resize(bodies);
+  poses_.resize(bodies);
+  path_.clear();
+  path_.reserve(bodies);
+
+  // every body but the root starts stale, with its joint to compute
+  stale_.assign(bodies, 1);
+  moved_.assign(bodies, 1);
+  if (bodies > 0)
+  {
+    stale_[0] = moved_[0] = 0;
+    local_[0].setIdentity();
+    poses_[0].setIdentity();
+  }
+}
+
+void ForwardKinematicsCache::markJoint(std::size_t i)
+{
+  moved_[i] = 1;
+  if (stale_[i])
+    return;
+  // nothing under a fresh body is known to be stale; mark the subtree,
+  // skipping subtrees already stale as a whole
+  const std::size_t end = kinematics_.body(i).subtree_end;
+  for (std::size_t j = i; j < end;)
+  {
+    if (stale_[j])
+    {
+      j = kinematics_.body(j).subtree_end;
+      continue;
+    }
+    stale_[j] = 1;
+    ++j;
+  }
+}
+
+void ForwardKinematicsCache::setConfiguration(const double *q)
+{
+  for (std::size_t i = 1; i < poses_.size(); ++i)
+    this->setJointPositions(i, q + kinematics_.body(i).q_offset);
+}
+
+void ForwardKinematicsCache::setJointPositions(std::size_t i, const double *values)
+{
+  const KinematicModel::Body &body = kinematics_.body(i);
+  double *qi = &q_[body.q_offset];
+  if (std::equal(values, values + body.q_size, qi))
+    return;
+  std::copy(values, values + body.q_size, qi);
+  this->markJoint(i);
+}
+
+void ForwardKinematicsCache::setPosition(std::size_t k, double value)
+{
+  if (q_[k] == value)
+    return;
+  q_[k] = value;
+  this->markJoint(body_of_[k]);
+}
+
+const RigidTransform &ForwardKinematicsCache::pose(std::size_t i)
+{
+  if (!stale_[i])
+    return poses_[i];
+
+  // the root is never stale, so the walk up ends at a fresh ancestor
+  path_.clear();
+  for (std::size_t j = i; stale_[j]; j = kinematics_.body(j).parent)
+    path_.push_back(j);
+  for (std::size_t n = path_.size(); n-- > 0;)
+  {
+    const std::size_t j = path_[n];
+    if (moved_[j])
+    {
+      kinematics_.jointTransform(j, q_.data(), local_[j]);
+      moved_[j] = 0;
+    }
+    compose(poses_[kinematics_.body(j).parent], local_[j], poses_[j]);
+    stale_[j] = 0;
+  }
+  return poses_[i];
+}
+
+const RigidTransform *ForwardKinematicsCache::poses()
+{
+  // parents come before their children, so one pass in body order suffices
+  for (std::size_t i = 1; i < poses_.size(); ++i)
+  {
+    if (!stale_[i])
+      continue;
+    if (moved_[i])
+    {
+      kinematics_.jointTransform(i, q_.data(), local_[i]);
+      moved_[i] = 0;
+    }
+    compose(poses_[kinematics_.body(i).parent], local_[i], poses_[i]);
+    stale_[i] = 0;
+  }
+  return poses_.data();
+}
+
+}
@@ -0,0 +1,657 @@
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <string>
+#include <vector>
+#include <console_bridge/console.h>
+
+#include <urdf_parser/independent_coordinates.h>
+
+#include "./rigid_transform.hpp"
+
+namespace urdf{
+
+static const std::size_t NONE = static_cast<std::size_t>(-1);
+
+void IndependentCoordinateMap::clear()
+{
+  blocks_.clear();
+  velocity_order_.clear();
+  independent_.clear();
+  position_.clear();
+  value_offset_.clear();
+  values_.clear();
+  offset_.clear();
+  coupled_.clear();
+  dependent_.clear();
+  dep_first_.assign(1, 0);
+  dependent_offset_.clear();
+  dependent_basis_.clear();
+  loop_.clear();
+  loop_first_.assign(1, 0);
+  column_rank_.clear();
+  position_size_ = 0;
+  loop_rows_.clear();
+  coupled_row_.clear();
+  jacobian_.clear();
+  phi_.clear();
+  work_offset_.clear();
+  work_.clear();
+  iterations_.clear();
+  residual_.clear();
+  poses_.clear();
+  velocity_.clear();
+  acceleration_.clear();
+  force_.clear();
+}
+
+bool IndependentCoordinateMap::init(const ModelInterface &urdf_model, const DynamicsModel &model,
+                                    const LoopConstraintModel &loops)
+{
+  this->clear();
+  const KinematicModel &kin = model.kinematics();
+  const std::size_t nv = kin.velocitySize();
+  velocity_order_ = model.velocityOrder();
+  position_size_ = kin.positionSize();
+
+  // body, cluster and rank within the cluster of each velocity coordinate
+  std::vector<std::size_t> body_of(nv), cluster_of(nv), rank(nv);
+  std::vector<bool> independent(nv, true);
+  for (std::size_t i = 0; i < kin.bodyCount(); ++i)
+  {
+    const KinematicModel::Body &body = kin.body(i);
+    LinkConstSharedPtr link = urdf_model.getLink(kin.linkName(i));
+    const bool free = !link || !link->parent_joint || link->parent_joint->independent;
+    for (std::size_t k = 0; k < body.v_size; ++k)
+    {
+      body_of[body.v_offset + k] = i;
+      independent[body.v_offset + k] = free;
+    }
+  }
+  for (std::size_t c = 0; c < model.clusterCount(); ++c)
+  {
+    const DynamicsModel::Cluster &cluster = model.cluster(c);
+    for (std::size_t r = 0; r < cluster.v_size; ++r)
+    {
+      cluster_of[velocity_order_[cluster.v_first + r]] = c;
+      rank[velocity_order_[cluster.v_first + r]] = r;
+    }
+  }
+
+  // couplings: the successor coordinate is ratio times the predecessor one
+  std::vector<std::size_t> source(nv, NONE);
+  std::vector<double> ratio(nv, 0.0);
+  for (std::map<std::string, ConstraintSharedPtr>::const_iterator it = urdf_model.constraints_.begin();
+       it != urdf_model.constraints_.end(); ++it)
+  {
+    CouplingConstraintSharedPtr coupling = std::dynamic_pointer_cast<CouplingConstraint>(it->second);
+    if (!coupling)
+      continue;
+    const std::size_t p = kin.linkIndex(coupling->predecessor_link_name);
+    const std::size_t s = kin.linkIndex(coupling->successor_link_name);
+    if (p == kin.bodyCount() || s == kin.bodyCount() || kin.body(p).v_size != 1 || kin.body(s).v_size != 1)
+    {
+      CONSOLE_BRIDGE_logError("Coupling [%s] does not join two single degree of freedom joints",
+                              coupling->name.c_str());
+      this->clear();
+      return false;
+    }
+    const std::size_t k = kin.body(s).v_offset, j = kin.body(p).v_offset;
+    if (independent[k] || source[k] != NONE)
+    {
+      CONSOLE_BRIDGE_logError("Coupling [%s] drives joint [%s], which is independent or already coupled",
+                              coupling->name.c_str(), kin.jointName(s).c_str());
+      this->clear();
+      return false;
+    }
+    if (cluster_of[k] != cluster_of[j])
+    {
+      CONSOLE_BRIDGE_logError("Coupling [%s] joins links of different clusters", coupling->name.c_str());
+      this->clear();
+      return false;
+    }
+    source[k] = j;
+    ratio[k] = coupling->ratio;
+  }
+
+  // the loops of each cluster, and the cluster rows of their columns
+  const std::size_t clusters = model.clusterCount();
+  std::vector<std::vector<std::size_t> > cluster_loops(clusters);
+  std::vector<std::size_t> loop_rows(clusters, 0);
+  column_rank_.assign(loops.columns().size(), NONE);
+  for (std::size_t l = 0; l < loops.constraintCount(); ++l)
+  {
+    const LoopConstraintModel::Constraint &constraint = loops.constraint(l);
+    const std::size_t c = model.clusterOf(constraint.successor);
+    cluster_loops[c].push_back(l);
+    loop_rows[c] += constraint.rows;
+    for (std::size_t j = constraint.column_begin; j < constraint.column_end; ++j)
+    {
+      const std::size_t k = loops.columns()[j];
+      if (cluster_of[k] == c)
+        column_rank_[j] = rank[k];
+      else
+        CONSOLE_BRIDGE_logWarn("Loop constraint [%s] moves joint [%s] outside its cluster, which is ignored",
+                               constraint.name.c_str(), kin.jointName(body_of[k]).c_str());
+    }
+  }
+
+  // dependent coordinates with neither a coupling nor a loop to follow are
+  // left independent
+  for (std::size_t k = 0; k < nv; ++k)
+  {
+    if (independent[k] || source[k] != NONE)
+      continue;
+    if (cluster_loops[cluster_of[k]].empty() || kin.body(body_of[k]).v_size != 1)
+    {
+      CONSOLE_BRIDGE_logWarn("Joint [%s] is not independent, but no coupling or loop determines it",
+                             kin.jointName(body_of[k]).c_str());
+      independent[k] = true;
+    }
+  }
+
+  // number the independent and loop determined coordinates cluster by
+  // cluster
+  std::vector<std::size_t> local(nv, NONE);
+  std::size_t values = 0, basis = 0, work = 0;
+  for (std::size_t c = 0; c < clusters; ++c)
+  {
+    const DynamicsModel::Cluster &cluster = model.cluster(c);
+    Block block;
+    block.span_first = cluster.v_first;
+    block.span_size = cluster.v_size;
+    block.ind_first = independent_.size();
+    for (std::size_t r = 0; r < cluster.v_size; ++r)
+    {
+      const std::size_t k = velocity_order_[cluster.v_first + r];
+      if (independent[k])
+      {
+        local[k] = independent_.size() - block.ind_first;
+        independent_.push_back(k);
+      }
+      else if (source[k] == NONE)
+      {
+        local[k] = dependent_.size() - dep_first_.back();
+        dependent_.push_back(k);
+      }
+    }
+    block.ind_size = independent_.size() - block.ind_first;
+    dep_first_.push_back(dependent_.size());
+    blocks_.push_back(block);
+
+    value_offset_.push_back(values);
+    values += block.span_size * block.ind_size;
+    dependent_offset_.push_back(basis);
+    const std::size_t nd = dep_first_[c + 1] - dep_first_[c];
+    basis += block.span_size * nd;
+    // A, B, L, X, z and a step for the loops, then the independent
+    // velocities
+    loop_rows_.push_back(loop_rows[c]);
+    work_offset_.push_back(work);
+    if (nd > 0)
+      work += loop_rows[c] * (nd + block.ind_size) + nd * (nd + block.ind_size + 2);
+    work += block.ind_size;
+    loop_.insert(loop_.end(), cluster_loops[c].begin(), cluster_loops[c].end());
+    loop_first_.push_back(loop_.size());
+  }
+
+  // the coupled basis, following chains of couplings to an independent or
+  // loop determined coordinate
+  coupled_.assign(values, 0.0);
+  dependent_basis_.assign(basis, 0.0);
+  for (std::size_t c = 0; c < clusters; ++c)
+  {
+    const Block &block = blocks_[c];
+    const std::size_t nd = dep_first_[c + 1] - dep_first_[c];
+    for (std::size_t r = 0; r < block.span_size; ++r)
+    {
+      std::size_t k = velocity_order_[block.span_first + r];
+      double factor = 1.0;
+      for (std::size_t steps = 0; source[k] != NONE; ++steps)
+      {
+        if (steps == nv)
+        {
+          CONSOLE_BRIDGE_logError("Couplings form a cycle through joint [%s]", kin.jointName(body_of[k]).c_str());
+          this->clear();
+          return false;
+        }
+        factor *= ratio[k];
+        k = source[k];
+      }
+      if (independent[k])
+        coupled_[value_offset_[c] + r * block.ind_size + local[k]] = factor;
+      else
+        dependent_basis_[dependent_offset_[c] + r * nd + local[k]] = factor;
+    }
+  }
+
+  values_ = coupled_;
+  offset_.assign(nv, 0.0);
+  position_.resize(nv);
+  for (std::size_t k = 0; k < nv; ++k)
+  {
+    const KinematicModel::Body &body = kin.body(body_of[k]);
+    position_[k] = body.v_size == 1 ? body.q_offset : position_size_;
+  }
+  coupled_row_.assign(nv, false);
+  for (std::size_t s = 0; s < nv; ++s)
+    coupled_row_[s] = source[velocity_order_[s]] != NONE;
+  jacobian_.assign(loops.valueCount(), 0.0);
+  phi_.assign(loops.rowCount(), 0.0);
+  work_.assign(work, 0.0);
+  iterations_.assign(clusters, 0);
+  residual_.assign(clusters, 0.0);
+  poses_.resize(kin.bodyCount());
+  velocity_.assign(nv, 0.0);
+  acceleration_.assign(nv, 0.0);
+  force_.assign(nv, 0.0);
+  return true;
+}
+
+bool IndependentCoordinateMap::factor(std::size_t c, const LoopConstraintModel &loops, const RigidTransform *poses)
+{
+  const std::size_t nd = dep_first_[c + 1] - dep_first_[c], ni = blocks_[c].ind_size, m = loop_rows_[c];
+  const double *EI = &coupled_[value_offset_[c]], *ED = &dependent_basis_[dependent_offset_[c]];
+  double *A = &work_[work_offset_[c]], *B = A + m * nd, *N = B + m * ni;
+
+  // the loop Jacobian on the coupled basis: K x = A z + B y
+  std::fill(A, N, 0.0);
+  std::size_t row = 0;
+  for (std::size_t l = loop_first_[c]; l < loop_first_[c + 1]; ++l)
+  {
+    loops.sparseJacobian(loop_[l], poses, jacobian_.data());
+    const LoopConstraintModel::Constraint &constraint = loops.constraint(loop_[l]);
+    const std::size_t columns = constraint.column_end - constraint.column_begin;
+    for (std::size_t r = 0; r < constraint.rows; ++r, ++row)
+    {
+      for (std::size_t j = 0; j < columns; ++j)
+      {
+        const std::size_t s = column_rank_[constraint.column_begin + j];
+        if (s == NONE)
+          continue;
+        const double k = jacobian_[constraint.value_offset + r * columns + j];
+        for (std::size_t e = 0; e < nd; ++e)
+          A[row * nd + e] += k * ED[s * nd + e];
+        for (std::size_t e = 0; e < ni; ++e)
+          B[row * ni + e] += k * EI[s * ni + e];
+      }
+    }
+  }
+
+  // A^T A = L L^T, in the lower triangle of N
+  double largest = 0.0;
+  for (std::size_t i = 0; i < nd; ++i)
+  {
+    for (std::size_t j = 0; j <= i; ++j)
+    {
+      double sum = 0.0;
+      for (std::size_t r = 0; r < m; ++r)
+        sum += A[r * nd + i] * A[r * nd + j];
+      N[i * nd + j] = sum;
+    }
+    largest = std::max(largest, N[i * nd + i]);
+  }
+  if (largest == 0.0)
+    return false;
+  for (std::size_t j = 0; j < nd; ++j)
+  {
+    double d = N[j * nd + j];
+    for (std::size_t e = 0; e < j; ++e)
+      d -= N[j * nd + e] * N[j * nd + e];
+    if (d <= 1e-12 * largest)
+      return false;
+    d = std::sqrt(d);
+    N[j * nd + j] = d;
+    for (std::size_t i = j + 1; i < nd; ++i)
+    {
+      double sum = N[i * nd + j];
+      for (std::size_t e = 0; e < j; ++e)
+        sum -= N[i * nd + e] * N[j * nd + e];
+      N[i * nd + j] = sum / d;
+    }
+  }
+  return true;
+}
+
+// solves L L^T x = b in place for the columns x[i * stride + col]
+static void choleskySolve(const double *L, std::size_t n, double *x, std::size_t stride, std::size_t columns)
+{
+  for (std::size_t col = 0; col < columns; ++col)
+  {
+    for (std::size_t i = 0; i < n; ++i)
+    {
+      double sum = x[i * stride + col];
+      for (std::size_t e = 0; e < i; ++e)
+        sum -= L[i * n + e] * x[e * stride + col];
+      x[i * stride + col] = sum / L[i * n + i];
+    }
+    for (std::size_t i = n; i-- > 0;)
+    {
+      double sum = x[i * stride + col];
+      for (std::size_t e = i + 1; e < n; ++e)
+        sum -= L[e * n + i] * x[e * stride + col];
+      x[i * stride + col] = sum / L[i * n + i];
+    }
+  }
+}
+
+bool IndependentCoordinateMap::update(std::size_t c, const LoopConstraintModel &loops, const RigidTransform *poses,
+                                      const double *q)
+{
+  const std::size_t nd = dep_first_[c + 1] - dep_first_[c];
+  if (nd == 0)
+    return true;
+  if (!this->factor(c, loops, poses))
+    return false;
+  const Block &block = blocks_[c];
+  const std::size_t ni = block.ind_size, ns = block.span_size, m = loop_rows_[c];
+  const double *EI = &coupled_[value_offset_[c]], *ED = &dependent_basis_[dependent_offset_[c]];
+  const double *A = &work_[work_offset_[c]], *B = A + m * nd, *N = B + m * ni;
+  double *X = &work_[work_offset_[c]] + m * (nd + ni) + nd * nd, *z = X + nd * ni;
+
+  // X = -(A^T A)^-1 A^T B
+  for (std::size_t i = 0; i < nd; ++i)
+    for (std::size_t j = 0; j < ni; ++j)
+    {
+      double sum = 0.0;
+      for (std::size_t r = 0; r < m; ++r)
+        sum += A[r * nd + i] * B[r * ni + j];
+      X[i * ni + j] = -sum;
+    }
+  choleskySolve(N, nd, X, ni, ni);
+
+  // G = E_I + E_D X, and g = E_D (z0 - X y0) about the positions q
+  for (std::size_t i = 0; i < nd; ++i)
+  {
+    double sum = q[position_[dependent_[dep_first_[c] + i]]];
+    for (std::size_t j = 0; j < ni; ++j)
+    {
+      const std::size_t p = position_[independent_[block.ind_first + j]];
+      if (p != position_size_)
+        sum -= X[i * ni + j] * q[p];
+    }
+    z[i] = sum;
+  }
+  double *G = &values_[value_offset_[c]];
+  for (std::size_t r = 0; r < ns; ++r)
+  {
+    double g = 0.0;
+    for (std::size_t i = 0; i < nd; ++i)
+      g += ED[r * nd + i] * z[i];
+    offset_[block.span_first + r] = g;
+    for (std::size_t j = 0; j < ni; ++j)
+    {
+      double sum = EI[r * ni + j];
+      for (std::size_t i = 0; i < nd; ++i)
+        sum += ED[r * nd + i] * X[i * ni + j];
+      G[r * ni + j] = sum;
+    }
+  }
+  return true;
+}
+
+bool IndependentCoordinateMap::update(const LoopConstraintModel &loops, const RigidTransform *poses, const double *q)
+{
+  bool determined = true;
+  for (std::size_t c = 0; c < blocks_.size(); ++c)
+  {
+    if (!this->update(c, loops, poses, q))
+      determined = false;
+  }
+  return determined;
+}
+
+// the positions of the coupled coordinates of cluster c from the
+// independent and loop determined ones
+void IndependentCoordinateMap::couple(std::size_t c, double *q) const
+{
+  const Block &block = blocks_[c];
+  const std::size_t nd = dep_first_[c + 1] - dep_first_[c], ni = block.ind_size;
+  const double *EI = &coupled_[value_offset_[c]], *ED = &dependent_basis_[dependent_offset_[c]];
+  for (std::size_t r = 0; r < block.span_size; ++r)
+  {
+    if (!coupled_row_[block.span_first + r])
+      continue;
+    double sum = 0.0;
+    for (std::size_t j = 0; j < ni; ++j)
+    {
+      const std::size_t p = position_[independent_[block.ind_first + j]];
+      if (EI[r * ni + j] != 0.0 && p != position_size_)
+        sum += EI[r * ni + j] * q[p];
+    }
+    for (std::size_t i = 0; i < nd; ++i)
+      sum += ED[r * nd + i] * q[position_[dependent_[dep_first_[c] + i]]];
+    q[position_[velocity_order_[block.span_first + r]]] = sum;
+  }
+}
+
+void IndependentCoordinateMap::closeCluster(std::size_t c, const DynamicsModel &model,
+                                            const LoopConstraintModel &loops, const LoopClosureOptions &options,
+                                            double *q, double *v, RigidTransform *poses)
+{
+  const KinematicModel &kin = model.kinematics();
+  const DynamicsModel::Cluster &cluster = model.cluster(c);
+  const std::size_t nd = dep_first_[c + 1] - dep_first_[c], ni = blocks_[c].ind_size, m = loop_rows_[c];
+  this->couple(c, q);
+
+  // Gauss-Newton on the loop determined coordinates, with the poses of the
+  // cluster bodies recomputed from those of their parents each step
+  std::size_t iterations = 0;
+  double residual = 0.0;
+  for (;;)
+  {
+    RigidTransform local;
+    for (std::size_t s = cluster.first; s < cluster.end; ++s)
+    {
+      const std::size_t i = model.order()[s];
+      if (i == 0)
+      {
+        poses[0].setIdentity();
+        continue;
+      }
+      kin.jointTransform(i, q, local);
+      compose(poses[kin.body(i).parent], local, poses[i]);
+    }
+    if (nd == 0)
+      break;
+
+    residual = 0.0;
+    for (std::size_t l = loop_first_[c]; l < loop_first_[c + 1]; ++l)
+    {
+      const LoopConstraintModel::Constraint &constraint = loops.constraint(loop_[l]);
+      loops.residual(loop_[l], poses, phi_.data());
+      for (std::size_t r = 0; r < constraint.rows; ++r)
+        residual = std::max(residual, std::fabs(phi_[constraint.row + r]));
+    }
+    if (residual <= options.tolerance || iterations == options.max_iterations ||
+        !this->factor(c, loops, poses))
+      break;
+
+    // z -= (A^T A)^-1 A^T phi
+    const double *A = &work_[work_offset_[c]];
+    double *step = &work_[work_offset_[c]] + m * (nd + ni) + nd * nd + nd * ni + nd;
+    for (std::size_t i = 0; i < nd; ++i)
+      step[i] = 0.0;
+    std::size_t row = 0;
+    for (std::size_t l = loop_first_[c]; l < loop_first_[c + 1]; ++l)
+    {
+      const LoopConstraintModel::Constraint &constraint = loops.constraint(loop_[l]);
+      for (std::size_t r = 0; r < constraint.rows; ++r, ++row)
+        for (std::size_t i = 0; i < nd; ++i)
+          step[i] += A[row * nd + i] * phi_[constraint.row + r];
+    }
+    choleskySolve(A + m * (nd + ni), nd, step, 1, 1);
+    for (std::size_t i = 0; i < nd; ++i)
+      q[position_[dependent_[dep_first_[c] + i]]] -= step[i];
+    this->couple(c, q);
+    ++iterations;
+  }
+  iterations_[c] = iterations;
+  residual_[c] = residual;
+
+  // velocities from the map linearized at the solution
+  if (v)
+  {
+    this->update(c, loops, poses, q);
+    const Block &block = blocks_[c];
+    const double *G = &values_[value_offset_[c]];
+    double *y = &work_[work_offset_[c]] + (nd > 0 ? m * (nd + ni) + nd * (nd + ni + 2) : 0);
+    for (std::size_t j = 0; j < ni; ++j)
+      y[j] = v[independent_[block.ind_first + j]];
+    for (std::size_t r = 0; r < block.span_size; ++r)
+    {
+      double sum = 0.0;
+      for (std::size_t j = 0; j < ni; ++j)
+        sum += G[r * ni + j] * y[j];
+      v[velocity_order_[block.span_first + r]] = sum;
+    }
+  }
+}
+
+bool IndependentCoordinateMap::closeLoops(const DynamicsModel &model, const LoopConstraintModel &loops, double *q,
+                                          double *v, RigidTransform *poses, const LoopClosureOptions &options,
+                                          LoopClosureStatus *status)
+{
+  // clusters are numbered parents first, so the poses of a parent are
+  // final when its children are closed
+  const std::size_t clusters = blocks_.size();
+  for (std::size_t c = 0; c < clusters; ++c)
+    this->closeCluster(c, model, loops, options, q, v, poses);
+
+  LoopClosureStatus result;
+  result.iterations = 0;
+  result.residual = 0.0;
+  for (std::size_t c = 0; c < clusters; ++c)
+  {
+    result.iterations = std::max(result.iterations, iterations_[c]);
+    result.residual = std::max(result.residual, residual_[c]);
+  }
+  result.converged = result.residual <= options.tolerance;
+  if (status)
+    *status = result;
+  return result.converged;
+}
+
+void IndependentCoordinateMap::addLoopBias(std::size_t c, const LoopConstraintModel &loops, double *a)
+{
+  const Block &block = blocks_[c];
+  const std::size_t nd = dep_first_[c + 1] - dep_first_[c], ni = block.ind_size, m = loop_rows_[c];
+  const double *ED = &dependent_basis_[dependent_offset_[c]];
+  const double *A = &work_[work_offset_[c]];
+  double *beta = &work_[work_offset_[c]] + m * (nd + ni) + nd * nd + nd * ni + nd;
+
+  // K (E_I ydd + E_D zdd) + k = 0 gives zdd = X ydd + beta
+  for (std::size_t i = 0; i < nd; ++i)
+    beta[i] = 0.0;
+  std::size_t row = 0;
+  for (std::size_t l = loop_first_[c]; l < loop_first_[c + 1]; ++l)
+  {
+    const LoopConstraintModel::Constraint &constraint = loops.constraint(loop_[l]);
+    for (std::size_t r = 0; r < constraint.rows; ++r, ++row)
+      for (std::size_t i = 0; i < nd; ++i)
+        beta[i] -= A[row * nd + i] * phi_[constraint.row + r];
+  }
+  choleskySolve(A + m * (nd + ni), nd, beta, 1, 1);
+  for (std::size_t r = 0; r < block.span_size; ++r)
+  {
+    double sum = 0.0;
+    for (std::size_t i = 0; i < nd; ++i)
+      sum += ED[r * nd + i] * beta[i];
+    a[velocity_order_[block.span_first + r]] += sum;
+  }
+}
+
+bool IndependentCoordinateMap::inverseDynamics(const DynamicsModel &model, const LoopConstraintModel &loops,
+                                               DynamicsData &data, const double *q, const double *yd,
+                                               const double *ydd, double *tau)
+{
+  model.kinematics().forwardKinematics(q, poses_.data());
+  if (!this->update(loops, poses_.data(), q))
+    return false;
+  this->apply(yd, velocity_.data());
+  this->apply(ydd, acceleration_.data());
+  loops.bias(poses_.data(), velocity_.data(), phi_.data());
+  for (std::size_t c = 0; c < blocks_.size(); ++c)
+  {
+    if (dep_first_[c + 1] > dep_first_[c])
+      this->addLoopBias(c, loops, acceleration_.data());
+  }
+  model.inverseDynamics(data, q, velocity_.data(), acceleration_.data(), force_.data());
+  this->applyTranspose(force_.data(), tau);
+  return true;
+}
+
+void IndependentCoordinateMap::gather(const double *x, double *y) const
+{
+  for (std::size_t i = 0; i < independent_.size(); ++i)
+    y[i] = x[independent_[i]];
+}
+
+void IndependentCoordinateMap::apply(const double *y, double *x) const
+{
+  this->apply(1, y, x);
+}
+
+void IndependentCoordinateMap::applyAffine(const double *y, double *x) const
+{
+  this->apply(1, y, x);
+  for (std::size_t s = 0; s < velocity_order_.size(); ++s)
+    x[velocity_order_[s]] += offset_[s];
+}
+
+void IndependentCoordinateMap::applyTranspose(const double *x, double *y) const
+{
+  this->applyTranspose(1, x, y);
+}
+
+// block by block, so that each block is read once for all the vectors
+void IndependentCoordinateMap::apply(std::size_t count, const double *y, double *x) const
+{
+  const std::size_t nv = velocity_order_.size(), ni = independent_.size();
+  for (std::size_t c = 0; c < blocks_.size(); ++c)
+  {
+    const Block &block = blocks_[c];
+    const double *G = &values_[value_offset_[c]];
+    const std::size_t *rows = &velocity_order_[block.span_first];
+    for (std::size_t n = 0; n < count; ++n)
+    {
+      const double *yc = y + n * ni + block.ind_first;
+      double *xn = x + n * nv;
+      for (std::size_t r = 0; r < block.span_size; ++r)
+      {
+        const double *Gr = G + r * block.ind_size;
+        double sum = 0.0;
+        for (std::size_t j = 0; j < block.ind_size; ++j)
+          sum += Gr[j] * yc[j];
+        xn[rows[r]] = sum;
+      }
+    }
+  }
+}
+
+void IndependentCoordinateMap::applyTranspose(std::size_t count, const double *x, double *y) const
+{
+  const std::size_t nv = velocity_order_.size(), ni = independent_.size();
+  for (std::size_t c = 0; c < blocks_.size(); ++c)
+  {
+    const Block &block = blocks_[c];
+    const double *G = &values_[value_offset_[c]];
+    const std::size_t *rows = &velocity_order_[block.span_first];
+    for (std::size_t n = 0; n < count; ++n)
+    {
+      double *yc = y + n * ni + block.ind_first;
+      const double *xn = x + n * nv;
+      for (std::size_t j = 0; j < block.ind_size; ++j)
+        yc[j] = 0.0;
+      for (std::size_t r = 0; r < block.span_size; ++r)
+      {
+        const double *Gr = G + r * block.ind_size;
+        const double xr = xn[rows[r]];
+        for (std::size_t j = 0; j < block.ind_size; ++j)
+          yc[j] += Gr[j] * xr;
+      }
+    }
+  }
+}
+
+}
@@ -0,0 +1,322 @@
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <thread>
+#include <vector>
+#include <console_bridge/console.h>
+
+#include <urdf_parser/inverse_kinematics.h>
+
+#include "./rigid_transform.hpp"
+
+namespace urdf{
+
+void InverseKinematics::clear()
+{
+  kinematics_.clear();
+  tip_ = 0;
+  joints_.clear();
+  path_.clear();
+  path_joint_.clear();
+  subspace_.clear();
+}
+
+bool InverseKinematics::init(const ModelInterface &model, const KinematicModel &kinematics, const std::string &tip)
+{
+  this->clear();
+  tip_ = kinematics.linkIndex(tip);
+  if (tip_ >= kinematics.bodyCount())
+  {
+    CONSOLE_BRIDGE_logError("Inverse kinematics tip link [%s] not found", tip.c_str());
+    return false;
+  }
+  kinematics_ = kinematics;
+
+  for (int i = static_cast<int>(tip_); i > 0; i = kinematics.body(i).parent)
+    path_.push_back(i);
+  std::reverse(path_.begin(), path_.end());
+  for (std::size_t k = 0; k < path_.size(); ++k)
+  {
+    const KinematicModel::Body &body = kinematics.body(path_[k]);
+    if (body.type != Joint::REVOLUTE && body.type != Joint::CONTINUOUS && body.type != Joint::PRISMATIC)
+    {
+      path_joint_.push_back(-1);
+      continue;
+    }
+    path_joint_.push_back(static_cast<int>(joints_.size()));
+    ChainJoint joint;
+    joint.body = path_[k];
+    joint.q_offset = body.q_offset;
+    joint.v_offset = body.v_offset;
+    joint.limited = false;
+    joint.lower = -INFINITY;
+    joint.upper = INFINITY;
+    JointConstSharedPtr urdf_joint = model.getJoint(kinematics.jointName(path_[k]));
+    if (body.type != Joint::CONTINUOUS && urdf_joint && urdf_joint->limits &&
+        urdf_joint->limits->lower < urdf_joint->limits->upper)
+    {
+      joint.limited = true;
+      joint.lower = urdf_joint->limits->lower;
+      joint.upper = urdf_joint->limits->upper;
+    }
+    joints_.push_back(joint);
+    subspace_.resize(subspace_.size() + 6);
+    jointSubspace(body, &subspace_[subspace_.size() - 6]);
+  }
+  return true;
+}
+
+void InverseKinematics::chainPoses(const double *q, RigidTransform *joint_poses, RigidTransform &pose) const
+{
+  RigidTransform local, next;
+  pose.setIdentity();
+  for (std::size_t k = 0; k < path_.size(); ++k)
+  {
+    kinematics_.jointTransform(path_[k], q, local);
+    compose(pose, local, next);
+    pose = next;
+    if (joint_poses && path_joint_[k] >= 0)
+      joint_poses[path_joint_[k]] = pose;
+  }
+}
+
+void InverseKinematics::tipPose(const double *q, RigidTransform &pose) const
+{
+  this->chainPoses(q, NULL, pose);
+}
+
+// rotation vector of R, angle times unit axis
+static void rotationVector(const double *R, double *out)
+{
+  const double c = std::max(-1.0, std::min(1.0, 0.5 * (R[0] + R[4] + R[8] - 1.0)));
+  const double vee[3] = {R[7] - R[5], R[2] - R[6], R[3] - R[1]};
+  const double angle = std::acos(c), s = std::sin(angle);
+  if (s > 1e-6)
+  {
+    const double scale = angle / (2.0 * s);
+    for (int k = 0; k < 3; ++k)
+      out[k] = scale * vee[k];
+    return;
+  }
+  if (c > 0.0)
+  {
+    for (int k = 0; k < 3; ++k)
+      out[k] = 0.5 * vee[k];
+    return;
+  }
+  // near a half turn R ~ 2 a a^T - 1: the column of the largest diagonal
+  // entry is 2 a_m a
+  int m = 0;
+  if (R[4] > R[3 * m + m])
+    m = 1;
+  if (R[8] > R[3 * m + m])
+    m = 2;
+  double axis[3];
+  for (int k = 0; k < 3; ++k)
+    axis[k] = 0.5 * (R[3 * m + k] + R[3 * k + m]);
+  axis[m] = R[3 * m + m] + 1.0;
+  const double n = std::sqrt(dot(axis, axis));
+  const double sign = dot(axis, vee) < 0.0 ? -1.0 : 1.0;
+  for (int k = 0; k < 3; ++k)
+    out[k] = sign * angle * axis[k] / n;
+}
+
+// dq = J^T (J J^T + lambda^2 1)^-1 e for the first rows rows of the
+// row-major 6 x n Jacobian J, by Cholesky; false if that fails
+static bool dampedStep(const double *J, std::size_t n, std::size_t rows, double damping, const double *e, double *dq)
+{
+  double A[36], y[6];
+  for (std::size_t r = 0; r < rows; ++r)
+    for (std::size_t c = 0; c <= r; ++c)
+    {
+      double sum = r == c ? damping * damping : 0.0;
+      for (std::size_t k = 0; k < n; ++k)
+        sum += J[r * n + k] * J[c * n + k];
+      A[r * rows + c] = sum;
+    }
+  for (std::size_t j = 0; j < rows; ++j)
+  {
+    double d = A[j * rows + j];
+    for (std::size_t k = 0; k < j; ++k)
+      d -= A[j * rows + k] * A[j * rows + k];
+    if (!(d > 0.0))
+      return false;
+    A[j * rows + j] = std::sqrt(d);
+    for (std::size_t i = j + 1; i < rows; ++i)
+    {
+      double s = A[i * rows + j];
+      for (std::size_t k = 0; k < j; ++k)
+        s -= A[i * rows + k] * A[j * rows + k];
+      A[i * rows + j] = s / A[j * rows + j];
+    }
+  }
+  for (std::size_t i = 0; i < rows; ++i)
+  {
+    double s = e[i];
+    for (std::size_t k = 0; k < i; ++k)
+      s -= A[i * rows + k] * y[k];
+    y[i] = s / A[i * rows + i];
+  }
+  for (std::size_t i = rows; i-- > 0;)
+  {
+    double s = y[i];
+    for (std::size_t k = i + 1; k < rows; ++k)
+      s -= A[k * rows + i] * y[k];
+    y[i] = s / A[i * rows + i];
+  }
+  for (std::size_t k = 0; k < n; ++k)
+  {
+    double step = 0.0;
+    for (std::size_t r = 0; r < rows; ++r)
+      step += J[r * n + k] * y[r];
+    dq[k] = step;
+  }
+  return true;
+}
+
+bool InverseKinematics::solve(const RigidTransform &target, double *q, InverseKinematicsStatus &status,
+                              const InverseKinematicsOptions &options, std::vector<RigidTransform> &poses,
+                              std::vector<double> &work) const
+{
+  const std::size_t n = joints_.size(), rows = options.position_only ? 3 : 6;
+  poses.resize(n);
+  work.resize(7 * n);
+  double *J = work.data(), *dq = J + 6 * n;
+  const double w = options.orientation_weight;
+
+  for (std::size_t k = 0; k < n; ++k)
+    if (joints_[k].limited)
+      q[joints_[k].q_offset] = std::max(joints_[k].lower, std::min(joints_[k].upper, q[joints_[k].q_offset]));
+
+  status.iterations = 0;
+  status.converged = false;
+  RigidTransform pose;
+  for (;;)
+  {
+    this->chainPoses(q, n ? &poses[0] : NULL, pose);
+
+    // error: position, then the rotation taking the tip to the target
+    double e[6], Rt[9], rotation[3];
+    for (int c = 0; c < 3; ++c)
+      e[c] = target.p[c] - pose.p[c];
+    for (int r = 0; r < 3; ++r)
+      for (int c = 0; c < 3; ++c)
+        Rt[3 * r + c] = target.R[3 * r] * pose.R[3 * c] + target.R[3 * r + 1] * pose.R[3 * c + 1] +
+                        target.R[3 * r + 2] * pose.R[3 * c + 2];
+    rotationVector(Rt, rotation);
+    status.position_error = std::sqrt(dot(e, e));
+    status.orientation_error = std::sqrt(dot(rotation, rotation));
+    status.converged = status.position_error <= options.position_tolerance &&
+                       (options.position_only || status.orientation_error <= options.orientation_tolerance);
+    if (status.converged || status.iterations >= options.max_iterations)
+      break;
+    for (int c = 0; c < 3; ++c)
+      e[3 + c] = w * rotation[c];
+
+    // Jacobian rows: tip velocity, then weighted angular velocity
+    for (std::size_t k = 0; k < n; ++k)
+    {
+      const RigidTransform &X = poses[k];
+      const double *S = &subspace_[6 * k];
+      double omega[3], v[3], arm[3], moment[3];
+      rotate(X.R, S, omega);
+      rotate(X.R, S + 3, v);
+      for (int c = 0; c < 3; ++c)
+        arm[c] = pose.p[c] - X.p[c];
+      cross(omega, arm, moment);
+      for (int c = 0; c < 3; ++c)
+      {
+        J[c * n + k] = v[c] + moment[c];
+        J[(3 + c) * n + k] = w * omega[c];
+      }
+    }
+
+    // the damping fades with the error, so that the last steps are
+    // Gauss-Newton steps even near singular configurations
+    double norm = 0.0;
+    for (std::size_t r = 0; r < rows; ++r)
+      norm += e[r] * e[r];
+    const double damping = options.damping * std::min(1.0, std::sqrt(std::sqrt(norm)));
+
+    // joints held at a limit the step pushes against leave the Jacobian,
+    // and the step is taken again without them
+    bool blocked = true, solved = true;
+    while (blocked && solved)
+    {
+      solved = dampedStep(J, n, rows, damping, e, dq);
+      blocked = false;
+      for (std::size_t k = 0; k < n; ++k)
+      {
+        const ChainJoint &joint = joints_[k];
+        const double value = q[joint.q_offset];
+        if (joint.limited && ((value == joint.lower && dq[k] < 0.0) || (value == joint.upper && dq[k] > 0.0)))
+        {
+          for (std::size_t r = 0; r < rows; ++r)
+            J[r * n + k] = 0.0;
+          blocked = true;
+        }
+      }
+    }
+    if (!solved)
+      break;
+
+    double largest = 0.0;
+    for (std::size_t k = 0; k < n; ++k)
+      largest = std::max(largest, std::fabs(dq[k]));
+    const double scale = largest > options.max_step ? options.max_step / largest : 1.0;
+    for (std::size_t k = 0; k < n; ++k)
+    {
+      const ChainJoint &joint = joints_[k];
+      double &value = q[joint.q_offset];
+      value += scale * dq[k];
+      if (joint.limited)
+        value = std::max(joint.lower, std::min(joint.upper, value));
+    }
+    ++status.iterations;
+  }
+  return status.converged;
+}
+
+bool InverseKinematics::solve(const RigidTransform &target, double *q, InverseKinematicsStatus *status,
+                              const InverseKinematicsOptions &options) const
+{
+  InverseKinematicsStatus local;
+  std::vector<RigidTransform> poses;
+  std::vector<double> work;
+  return this->solve(target, q, status ? *status : local, options, poses, work);
+}
+
+bool InverseKinematics::solve(std::size_t count, const RigidTransform *targets, const double *q_start, double *q,
+                              InverseKinematicsStatus *status, const InverseKinematicsOptions &options) const
+{
+  const std::size_t nq = kinematics_.positionSize();
+  std::size_t workers = options.threads ? options.threads : std::thread::hardware_concurrency();
+  workers = std::max<std::size_t>(1, std::min<std::size_t>(workers, count));
+
+  // queries are claimed one at a time, so slow ones do not hold up a
+  // whole share of the batch
+  std::atomic<std::size_t> next(0), failed(0);
+  auto run = [&]()
+  {
+    std::vector<RigidTransform> poses;
+    std::vector<double> work;
+    InverseKinematicsStatus local;
+    for (std::size_t n = next++; n < count; n = next++)
+    {
+      double *qn = q + n * nq;
+      if (qn != q_start + n * nq)
+        std::copy(q_start + n * nq, q_start + (n + 1) * nq, qn);
+      if (!this->solve(targets[n], qn, status ? status[n] : local, options, poses, work))
+        ++failed;
+    }
+  };
+  std::vector<std::thread> pool;
+  for (std::size_t w = 1; w < workers; ++w)
+    pool.push_back(std::thread(run));
+  run();
+  for (std::size_t w = 0; w < pool.size(); ++w)
+    pool[w].join();
+  return failed == 0;
+}
+
+}
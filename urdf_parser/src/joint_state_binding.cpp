@@ -0,0 +1,221 @@
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+#include <console_bridge/console.h>
+
+#include <urdf_parser/joint_state_binding.h>
+
+namespace urdf{
+
+JointStateBinding::JointStateBinding()
+  : position_size_(0), velocity_size_(0)
+{
+}
+
+bool JointStateBinding::init(const ModelInterface &model, const std::vector<std::string> &joint_names)
+{
+  model_joints_.clear();
+  model_position_offset_.clear();
+  model_velocity_offset_.clear();
+  position_size_ = 0;
+  velocity_size_ = 0;
+  bound_joints_.clear();
+  bound_position_offset_.clear();
+  bound_position_width_.clear();
+  bound_velocity_offset_.clear();
+  bound_velocity_width_.clear();
+  position_map_.clear();
+  velocity_map_.clear();
+
+  LinkConstSharedPtr root = model.getRoot();
+  if (!root)
+  {
+    CONSOLE_BRIDGE_logError("Cannot bind joint states to model [%s]: it has no root link", model.getName().c_str());
+    return false;
+  }
+
+  // slot layout of every movable joint, depth first from the root
+  struct Slots
+  {
+    std::size_t position_offset, position_width, velocity_offset, velocity_width;
+  };
+  std::map<std::string, Slots> slots;
+  std::vector<LinkConstSharedPtr> stack(1, root);
+  while (!stack.empty())
+  {
+    LinkConstSharedPtr link = stack.back();
+    stack.pop_back();
+    for (std::vector<JointSharedPtr>::const_reverse_iterator joint = link->child_joints.rbegin();
+         joint != link->child_joints.rend(); ++joint)
+    {
+      LinkConstSharedPtr child = model.getLink((*joint)->child_link_name);
+      if (child)
+        stack.push_back(child);
+    }
+    if (!link->parent_joint)
+      continue;
+
+    const Joint &joint = *link->parent_joint;
+    Slots s;
+    switch (joint.type)
+    {
+      case Joint::REVOLUTE:
+      case Joint::CONTINUOUS:
+      case Joint::PRISMATIC:
+        s.position_width = 1;
+        s.velocity_width = 1;
+        break;
+      case Joint::PLANAR:
+        s.position_width = 3;
+        s.velocity_width = 3;
+        break;
+      case Joint::FLOATING:
+        s.position_width = 7;
+        s.velocity_width = 6;
+        break;
+      default:
+        s.position_width = 0;
+        s.velocity_width = 0;
+        break;
+    }
+    s.position_offset = position_size_;
+    s.velocity_offset = velocity_size_;
+    slots[joint.name] = s;
+    if (s.position_width == 0)
+      continue;
+
+    model_joints_.push_back(joint.name);
+    model_position_offset_.push_back(position_size_);
+    model_velocity_offset_.push_back(velocity_size_);
+    position_size_ += s.position_width;
+    velocity_size_ += s.velocity_width;
+  }
+
+  for (const std::string &name : joint_names)
+  {
+    std::map<std::string, Slots>::const_iterator s = slots.find(name);
+    if (s == slots.end())
+    {
+      CONSOLE_BRIDGE_logError("Joint [%s] is not part of model [%s]", name.c_str(), model.getName().c_str());
+      return false;
+    }
+    if (std::find(bound_joints_.begin(), bound_joints_.end(), name) != bound_joints_.end())
+    {
+      CONSOLE_BRIDGE_logError("Joint [%s] is listed more than once", name.c_str());
+      return false;
+    }
+    bound_joints_.push_back(name);
+    bound_position_offset_.push_back(s->second.position_offset);
+    bound_position_width_.push_back(s->second.position_width);
+    bound_velocity_offset_.push_back(s->second.velocity_offset);
+    bound_velocity_width_.push_back(s->second.velocity_width);
+    for (std::size_t k = 0; k < s->second.position_width; ++k)
+      position_map_.push_back(s->second.position_offset + k);
+    for (std::size_t k = 0; k < s->second.velocity_width; ++k)
+      velocity_map_.push_back(s->second.velocity_offset + k);
+  }
+  return true;
+}
+
+bool JointStateBinding::init(const ModelInterface &model, const ModelState &prototype)
+{
+  std::vector<std::string> names;
+  for (const JointStateSharedPtr &js : prototype.joint_states)
+  {
+    if (!js)
+    {
+      CONSOLE_BRIDGE_logError("model_state [%s] holds an empty joint state", prototype.name.c_str());
+      return false;
+    }
+    names.push_back(js->joint);
+  }
+  return init(model, names);
+}
+
+bool JointStateBinding::matches(const ModelState &ms) const
+{
+  if (ms.joint_states.size() != bound_joints_.size())
+    return false;
+  for (std::size_t i = 0; i < bound_joints_.size(); ++i)
+  {
+    const JointStateSharedPtr &js = ms.joint_states[i];
+    if (!js || js->joint != bound_joints_[i])
+      return false;
+    if ((!js->position.empty() && js->position.size() != bound_position_width_[i]) ||
+        (!js->velocity.empty() && js->velocity.size() != bound_velocity_width_[i]) ||
+        (!js->effort.empty() && js->effort.size() != bound_velocity_width_[i]))
+      return false;
+  }
+  return true;
+}
+
+bool JointStateBinding::scatter(const ModelState &ms, double *q, double *v, double *effort) const
+{
+  if (!matches(ms))
+    return false;
+
+  for (std::size_t i = 0; i < bound_joints_.size(); ++i)
+  {
+    const JointState &js = *ms.joint_states[i];
+    if (q && !js.position.empty())
+      std::copy(js.position.begin(), js.position.end(), q + bound_position_offset_[i]);
+    if (v && !js.velocity.empty())
+      std::copy(js.velocity.begin(), js.velocity.end(), v + bound_velocity_offset_[i]);
+    if (effort && !js.effort.empty())
+      std::copy(js.effort.begin(), js.effort.end(), effort + bound_velocity_offset_[i]);
+  }
+  return true;
+}
+
+bool JointStateBinding::gather(const double *q, const double *v, const double *effort, ModelState &ms) const
+{
+  if (!matches(ms))
+    return false;
+
+  for (std::size_t i = 0; i < bound_joints_.size(); ++i)
+  {
+    JointState &js = *ms.joint_states[i];
+    if (q && !js.position.empty())
+      std::copy(q + bound_position_offset_[i], q + bound_position_offset_[i] + js.position.size(), js.position.begin());
+    if (v && !js.velocity.empty())
+      std::copy(v + bound_velocity_offset_[i], v + bound_velocity_offset_[i] + js.velocity.size(), js.velocity.begin());
+    if (effort && !js.effort.empty())
+      std::copy(effort + bound_velocity_offset_[i], effort + bound_velocity_offset_[i] + js.effort.size(), js.effort.begin());
+  }
+  return true;
+}
+
+void JointStateBinding::scatterPositions(const double *bound, double *q) const
+{
+  const std::size_t n = position_map_.size();
+  const std::size_t *map = position_map_.data();
+  for (std::size_t k = 0; k < n; ++k)
+    q[map[k]] = bound[k];
+}
+
+void JointStateBinding::scatterVelocities(const double *bound, double *v) const
+{
+  const std::size_t n = velocity_map_.size();
+  const std::size_t *map = velocity_map_.data();
+  for (std::size_t k = 0; k < n; ++k)
+    v[map[k]] = bound[k];
+}
+
+void JointStateBinding::gatherPositions(const double *q, double *bound) const
+{
+  const std::size_t n = position_map_.size();
+  const std::size_t *map = position_map_.data();
+  for (std::size_t k = 0; k < n; ++k)
+    bound[k] = q[map[k]];
+}
+
+void JointStateBinding::gatherVelocities(const double *v, double *bound) const
+{
+  const std::size_t n = velocity_map_.size();
+  const std::size_t *map = velocity_map_.data();
+  for (std::size_t k = 0; k < n; ++k)
+    bound[k] = v[map[k]];
+}
+
+}
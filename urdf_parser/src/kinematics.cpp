@@ -0,0 +1,346 @@
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <string>
+#include <vector>
+#include <console_bridge/console.h>
+
+#include <urdf_parser/kinematics.h>
+
+#include "./rigid_transform.hpp"
+#include "./sincos.hpp"
+
+namespace urdf{
+
+void KinematicModel::clear()
+{
+  name_.clear();
+  bodies_.clear();
+  link_names_.clear();
+  joint_names_.clear();
+  link_index_.clear();
+  joint_index_.clear();
+  support_begin_.assign(1, 0);
+  support_.clear();
+  position_size_ = 0;
+  velocity_size_ = 0;
+}
+
+static void initBody(KinematicModel::Body &body, const Joint *joint, std::size_t q_offset, std::size_t v_offset)
+{
+  body.type = joint ? joint->type : static_cast<int>(Joint::FIXED);
+  body.q_offset = q_offset;
+  body.v_offset = v_offset;
+  switch (body.type)
+  {
+    case Joint::REVOLUTE:
+    case Joint::CONTINUOUS:
+    case Joint::PRISMATIC:
+      body.q_size = 1;
+      body.v_size = 1;
+      break;
+    case Joint::PLANAR:
+      body.q_size = 3;
+      body.v_size = 3;
+      break;
+    case Joint::FLOATING:
+      body.q_size = 7;
+      body.v_size = 6;
+      break;
+    default:
+      body.q_size = 0;
+      body.v_size = 0;
+      break;
+  }
+
+  body.origin.setIdentity();
+  body.axis[0] = 1.0; body.axis[1] = 0.0; body.axis[2] = 0.0;
+  if (joint)
+  {
+    poseToTransform(joint->parent_to_joint_origin_transform, body.origin);
+    const double n = std::sqrt(joint->axis.x * joint->axis.x + joint->axis.y * joint->axis.y + joint->axis.z * joint->axis.z);
+    if (n > 0.0)
+    {
+      body.axis[0] = joint->axis.x / n;
+      body.axis[1] = joint->axis.y / n;
+      body.axis[2] = joint->axis.z / n;
+    }
+  }
+
+  const double *a = body.axis;
+  planeBasis(a, body.plane_u, body.plane_w);
+
+  // Rot(a, q) = a a^T + cos(q) (I - a a^T) + sin(q) [a]x, premultiplied by
+  // the origin rotation
+  double aat[9], ortho[9], skew[9];
+  for (int r = 0; r < 3; ++r)
+    for (int c = 0; c < 3; ++c)
+    {
+      aat[3 * r + c] = a[r] * a[c];
+      ortho[3 * r + c] = (r == c ? 1.0 : 0.0) - a[r] * a[c];
+    }
+  skew[0] = 0.0;   skew[1] = -a[2]; skew[2] = a[1];
+  skew[3] = a[2];  skew[4] = 0.0;   skew[5] = -a[0];
+  skew[6] = -a[1]; skew[7] = a[0];  skew[8] = 0.0;
+  mul33(body.origin.R, aat, body.rot_const);
+  mul33(body.origin.R, ortho, body.rot_cos);
+  mul33(body.origin.R, skew, body.rot_sin);
+  rotate(body.origin.R, a, body.slide);
+}
+
+bool KinematicModel::init(const ModelInterface &model)
+{
+  this->clear();
+
+  LinkConstSharedPtr root = model.getRoot();
+  if (!root)
+  {
+    CONSOLE_BRIDGE_logError("Cannot compile the kinematics of model [%s]: it has no root link", model.getName().c_str());
+    return false;
+  }
+  name_ = model.getName();
+
+  // depth first, children in child_joints order
+  std::vector<std::pair<LinkConstSharedPtr, int> > stack(1, std::make_pair(root, -1));
+  while (!stack.empty())
+  {
+    LinkConstSharedPtr link = stack.back().first;
+    const int parent = stack.back().second;
+    stack.pop_back();
+
+    const std::size_t index = bodies_.size();
+    const Joint *joint = parent < 0 ? NULL : link->parent_joint.get();
+    Body body;
+    body.parent = parent;
+    body.subtree_end = index + 1;
+    initBody(body, joint, position_size_, velocity_size_);
+    if (body.q_size > 0 && body.type != Joint::FLOATING &&
+        joint->axis.x == 0.0 && joint->axis.y == 0.0 && joint->axis.z == 0.0)
+    {
+      CONSOLE_BRIDGE_logError("Joint [%s] has a zero axis", joint->name.c_str());
+      this->clear();
+      return false;
+    }
+    position_size_ += body.q_size;
+    velocity_size_ += body.v_size;
+    bodies_.push_back(body);
+    link_names_.push_back(link->name);
+    joint_names_.push_back(joint ? joint->name : std::string());
+    link_index_[link->name] = index;
+    if (joint)
+      joint_index_[joint->name] = index;
+
+    for (std::vector<JointSharedPtr>::const_reverse_iterator j = link->child_joints.rbegin(); j != link->child_joints.rend(); ++j)
+    {
+      LinkConstSharedPtr child = model.getLink((*j)->child_link_name);
+      if (child)
+        stack.push_back(std::make_pair(child, static_cast<int>(index)));
+    }
+  }
+
+  // subtree ends, children always follow their parent
+  for (std::size_t i = bodies_.size(); i-- > 1;)
+  {
+    Body &parent = bodies_[bodies_[i].parent];
+    if (bodies_[i].subtree_end > parent.subtree_end)
+      parent.subtree_end = bodies_[i].subtree_end;
+  }
+
+  // supports: the support of the parent, then the body itself if it moves
+  for (std::size_t i = 0; i < bodies_.size(); ++i)
+  {
+    if (bodies_[i].parent >= 0)
+    {
+      const std::size_t parent = bodies_[i].parent;
+      for (std::size_t k = support_begin_[parent]; k < support_begin_[parent + 1]; ++k)
+        support_.push_back(support_[k]);
+    }
+    if (bodies_[i].v_size > 0)
+      support_.push_back(i);
+    support_begin_.push_back(support_.size());
+  }
+  return true;
+}
+
+std::size_t KinematicModel::linkIndex(const std::string &name) const
+{
+  std::map<std::string, std::size_t>::const_iterator l = link_index_.find(name);
+  return l == link_index_.end() ? bodies_.size() : l->second;
+}
+
+std::size_t KinematicModel::jointIndex(const std::string &name) const
+{
+  std::map<std::string, std::size_t>::const_iterator j = joint_index_.find(name);
+  return j == joint_index_.end() ? bodies_.size() : j->second;
+}
+
+void KinematicModel::neutralConfiguration(double *q) const
+{
+  for (std::size_t k = 0; k < position_size_; ++k)
+    q[k] = 0.0;
+  for (std::size_t i = 0; i < bodies_.size(); ++i)
+  {
+    if (bodies_[i].type == Joint::FLOATING)
+      q[bodies_[i].q_offset + 6] = 1.0;
+  }
+}
+
+void KinematicModel::integrate(const double *q, const double *v, double dt, double *out) const
+{
+  for (std::size_t i = 1; i < bodies_.size(); ++i)
+  {
+    const Body &body = bodies_[i];
+    const double *qi = q + body.q_offset;
+    const double *vi = v + body.v_offset;
+    double *oi = out + body.q_offset;
+    switch (body.type)
+    {
+      case Joint::REVOLUTE:
+      case Joint::CONTINUOUS:
+      case Joint::PRISMATIC:
+        oi[0] = qi[0] + dt * vi[0];
+        break;
+      case Joint::PLANAR:
+      {
+        // the in-plane velocity is in the child frame, rotated by the angle
+        const double c = std::cos(qi[2]), s = std::sin(qi[2]);
+        const double x = qi[0] + dt * (c * vi[0] - s * vi[1]);
+        const double y = qi[1] + dt * (s * vi[0] + c * vi[1]);
+        oi[0] = x;
+        oi[1] = y;
+        oi[2] = qi[2] + dt * vi[2];
+        break;
+      }
+      case Joint::FLOATING:
+      {
+        double R[9], dp[3];
+        quaternionToMatrix(qi[3], qi[4], qi[5], qi[6], R);
+        rotate(R, vi + 3, dp);
+
+        // (x, y, z, w) * exp(w dt / 2), renormalized
+        const double *w = vi;
+        const double angle = std::sqrt(dot(w, w)) * dt;
+        const double s = angle != 0.0 ? std::sin(0.5 * angle) / (angle / dt) : 0.0;
+        const double dx = s * w[0], dy = s * w[1], dz = s * w[2], dw = std::cos(0.5 * angle);
+        const double x = qi[3], y = qi[4], z = qi[5], qw = qi[6];
+        double r[4] = {qw * dx + x * dw + y * dz - z * dy,
+                       qw * dy - x * dz + y * dw + z * dx,
+                       qw * dz + x * dy - y * dx + z * dw,
+                       qw * dw - x * dx - y * dy - z * dz};
+        const double n = std::sqrt(r[0] * r[0] + r[1] * r[1] + r[2] * r[2] + r[3] * r[3]);
+        for (int k = 0; k < 3; ++k)
+          oi[k] = qi[k] + dt * dp[k];
+        for (int k = 0; k < 4; ++k)
+          oi[3 + k] = r[k] / n;
+        break;
+      }
+      default:
+        break;
+    }
+  }
+}
+
+void KinematicModel::jointTransform(std::size_t i, const double *q, RigidTransform &transform) const
+{
+  bodyTransform(bodies_[i], q + bodies_[i].q_offset, transform);
+}
+
+void KinematicModel::bodyTransform(const Body &body, const double *qi, RigidTransform &transform)
+{
+  switch (body.type)
+  {
+    case Joint::REVOLUTE:
+    case Joint::CONTINUOUS:
+    {
+      const double c = std::cos(qi[0]), s = std::sin(qi[0]);
+      for (int k = 0; k < 9; ++k)
+        transform.R[k] = body.rot_const[k] + c * body.rot_cos[k] + s * body.rot_sin[k];
+      transform.p[0] = body.origin.p[0];
+      transform.p[1] = body.origin.p[1];
+      transform.p[2] = body.origin.p[2];
+      break;
+    }
+    case Joint::PRISMATIC:
+      for (int k = 0; k < 9; ++k)
+        transform.R[k] = body.origin.R[k];
+      for (int k = 0; k < 3; ++k)
+        transform.p[k] = body.origin.p[k] + qi[0] * body.slide[k];
+      break;
+    case Joint::PLANAR:
+    {
+      const double c = std::cos(qi[2]), s = std::sin(qi[2]);
+      for (int k = 0; k < 9; ++k)
+        transform.R[k] = body.rot_const[k] + c * body.rot_cos[k] + s * body.rot_sin[k];
+      double t[3];
+      for (int k = 0; k < 3; ++k)
+        t[k] = qi[0] * body.plane_u[k] + qi[1] * body.plane_w[k];
+      rotate(body.origin.R, t, transform.p);
+      for (int k = 0; k < 3; ++k)
+        transform.p[k] += body.origin.p[k];
+      break;
+    }
+    case Joint::FLOATING:
+    {
+      double R[9];
+      quaternionToMatrix(qi[3], qi[4], qi[5], qi[6], R);
+      mul33(body.origin.R, R, transform.R);
+      rotate(body.origin.R, qi, transform.p);
+      for (int k = 0; k < 3; ++k)
+        transform.p[k] += body.origin.p[k];
+      break;
+    }
+    default:
+      transform = body.origin;
+      break;
+  }
+}
+
+void KinematicModel::forwardKinematics(const double *q, RigidTransform *poses) const
+{
+  const std::size_t n = bodies_.size();
+  if (n == 0)
+    return;
+  poses[0].setIdentity();
+
+  // sines and cosines of revolute coordinates come from the vectorized
+  // kernel, a window of coordinates at a time
+  static const std::size_t WINDOW = 64;
+  double s[WINDOW], c[WINDOW];
+  std::size_t first = 0, end = 0;
+  RigidTransform local;
+  for (std::size_t i = 1; i < n; ++i)
+  {
+    const Body &body = bodies_[i];
+    const RigidTransform &parent = poses[body.parent];
+    switch (body.type)
+    {
+      case Joint::REVOLUTE:
+      case Joint::CONTINUOUS:
+      {
+        if (body.q_offset < first || body.q_offset >= end)
+        {
+          first = body.q_offset;
+          end = std::min(first + WINDOW, position_size_);
+          sinCosLanes(end - first, q + first, s, c);
+        }
+        const double ci = c[body.q_offset - first], si = s[body.q_offset - first];
+        for (int k = 0; k < 9; ++k)
+          local.R[k] = body.rot_const[k] + ci * body.rot_cos[k] + si * body.rot_sin[k];
+        mul33(parent.R, local.R, poses[i].R);
+        rotate(parent.R, body.origin.p, poses[i].p);
+        for (int k = 0; k < 3; ++k)
+          poses[i].p[k] += parent.p[k];
+        break;
+      }
+      case Joint::FIXED:
+        compose(parent, body.origin, poses[i]);
+        break;
+      default:
+        bodyTransform(body, q + body.q_offset, local);
+        compose(parent, local, poses[i]);
+        break;
+    }
+  }
+}
+
+}
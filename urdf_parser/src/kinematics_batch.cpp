@@ -0,0 +1,136 @@
+#include <algorithm>
+
+#include <urdf_parser/kinematics.h>
+
+#include "./rigid_transform.hpp"
+#include "./sincos.hpp"
+#include "./target_clones.hpp"
+
+namespace urdf{
+
+// configurations processed together; the local transforms of a block stay
+// in L1 while every body of the tree is visited
+static const std::size_t BLOCK = 64;
+
+// out = parent * local for lanes configurations; row r of parent and out
+// starts at r * stride, row r of local at r * BLOCK
+URDFDOM_TARGET_CLONES
+static void composeLanes(std::size_t lanes, const double *parent, const double *local, double *out, std::size_t stride)
+{
+  for (int r = 0; r < 3; ++r)
+  {
+    const double *P0 = parent + (3 * r) * stride;
+    const double *P1 = parent + (3 * r + 1) * stride;
+    const double *P2 = parent + (3 * r + 2) * stride;
+    for (int c = 0; c < 3; ++c)
+    {
+      const double *L0 = local + c * BLOCK;
+      const double *L1 = local + (3 + c) * BLOCK;
+      const double *L2 = local + (6 + c) * BLOCK;
+      double *O = out + (3 * r + c) * stride;
+      for (std::size_t n = 0; n < lanes; ++n)
+        O[n] = P0[n] * L0[n] + P1[n] * L1[n] + P2[n] * L2[n];
+    }
+    const double *L0 = local + 9 * BLOCK;
+    const double *L1 = local + 10 * BLOCK;
+    const double *L2 = local + 11 * BLOCK;
+    const double *Pp = parent + (9 + r) * stride;
+    double *O = out + (9 + r) * stride;
+    for (std::size_t n = 0; n < lanes; ++n)
+      O[n] = P0[n] * L0[n] + P1[n] * L1[n] + P2[n] * L2[n] + Pp[n];
+  }
+}
+
+// local rotation rot_const + cos rot_cos + sin rot_sin and translation
+// p + t1 d1 + t2 d2, for lanes configurations
+URDFDOM_TARGET_CLONES
+static void localLanes(std::size_t lanes, const double *A, const double *B, const double *C,
+                       const double *p, const double *d1, const double *d2,
+                       const double *c, const double *s, const double *t1, const double *t2, double *local)
+{
+  for (int k = 0; k < 9; ++k)
+  {
+    const double a = A[k], b = B[k], cc = C[k];
+    double *L = local + k * BLOCK;
+    for (std::size_t n = 0; n < lanes; ++n)
+      L[n] = a + c[n] * b + s[n] * cc;
+  }
+  for (int k = 0; k < 3; ++k)
+  {
+    const double pk = p[k], e1 = d1[k], e2 = d2[k];
+    double *L = local + (9 + k) * BLOCK;
+    for (std::size_t n = 0; n < lanes; ++n)
+      L[n] = pk + t1[n] * e1 + t2[n] * e2;
+  }
+}
+
+void KinematicModel::forwardKinematicsBatch(std::size_t count, const double *q, double *poses) const
+{
+  const std::size_t bodies = bodies_.size();
+  if (bodies == 0 || count == 0)
+    return;
+
+  static const double zero[9] = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+  double local[12 * BLOCK];
+  double c[BLOCK], s[BLOCK], t1[BLOCK];
+
+  for (std::size_t first = 0; first < count; first += BLOCK)
+  {
+    const std::size_t lanes = std::min(BLOCK, count - first);
+
+    // root
+    for (int k = 0; k < 12; ++k)
+      std::fill(poses + k * count + first, poses + k * count + first + lanes, (k == 0 || k == 4 || k == 8) ? 1.0 : 0.0);
+
+    for (std::size_t i = 1; i < bodies; ++i)
+    {
+      const Body &body = bodies_[i];
+      const double *qi = q + body.q_offset * count + first;
+      switch (body.type)
+      {
+        case Joint::REVOLUTE:
+        case Joint::CONTINUOUS:
+          sinCosLanes(lanes, qi, s, c);
+          std::fill(t1, t1 + lanes, 0.0);
+          localLanes(lanes, body.rot_const, body.rot_cos, body.rot_sin, body.origin.p, zero, zero, c, s, t1, t1, local);
+          break;
+        case Joint::PRISMATIC:
+          std::fill(c, c + lanes, 0.0);
+          localLanes(lanes, body.origin.R, zero, zero, body.origin.p, body.slide, zero, c, c, qi, c, local);
+          break;
+        case Joint::PLANAR:
+        {
+          double du[3], dw[3];
+          rotate(body.origin.R, body.plane_u, du);
+          rotate(body.origin.R, body.plane_w, dw);
+          const double *angle = qi + 2 * count;
+          sinCosLanes(lanes, angle, s, c);
+          localLanes(lanes, body.rot_const, body.rot_cos, body.rot_sin, body.origin.p, du, dw, c, s, qi, qi + count, local);
+          break;
+        }
+        case Joint::FLOATING:
+          // usually a single body at the root: use the scalar code lane by lane
+          for (std::size_t n = 0; n < lanes; ++n)
+          {
+            double qn[7];
+            for (std::size_t k = 0; k < 7; ++k)
+              qn[k] = qi[k * count + n];
+            RigidTransform transform;
+            bodyTransform(body, qn, transform);
+            for (int k = 0; k < 9; ++k)
+              local[k * BLOCK + n] = transform.R[k];
+            for (int k = 0; k < 3; ++k)
+              local[(9 + k) * BLOCK + n] = transform.p[k];
+          }
+          break;
+        default:
+          std::fill(c, c + lanes, 0.0);
+          localLanes(lanes, body.origin.R, zero, zero, body.origin.p, zero, zero, c, c, c, c, local);
+          break;
+      }
+      composeLanes(lanes, poses + 12 * body.parent * count + first, local, poses + 12 * i * count + first, count);
+    }
+  }
+}
+
+}
@@ -0,0 +1,115 @@
+#include <algorithm>
+
+#include <urdf_parser/kinematics.h>
+
+#include "./rigid_transform.hpp"
+
+namespace urdf{
+
+// Writes the motion of each velocity coordinate of body b, as the angular
+// velocity w and the linear velocity u of the point at the root origin, both
+// in the root frame: the velocity of a point p is u + w x p.  w and u hold
+// body.v_size triples.
+static void jointMotion(const KinematicModel::Body &body, const RigidTransform &pose, double *w, double *u)
+{
+  double S[36];
+  jointSubspace(body, S);
+  for (std::size_t k = 0; k < body.v_size; ++k)
+  {
+    double *wk = w + 3 * k, *uk = u + 3 * k, moment[3];
+    rotate(pose.R, S + 6 * k, wk);
+    rotate(pose.R, S + 6 * k + 3, uk);
+    // shift the reference point from the body origin to the root origin
+    cross(pose.p, wk, moment);
+    for (int c = 0; c < 3; ++c)
+      uk[c] += moment[c];
+  }
+}
+
+// Writes the columns of body to J, 6 x nv row-major, for the point p (root
+// frame), given the motion w and u of its velocity coordinates.
+static void fillColumns(const KinematicModel::Body &body, const double *p, const double *w, const double *u,
+                        std::size_t nv, double *J)
+{
+  for (std::size_t k = 0; k < body.v_size; ++k)
+  {
+    const double *wk = w + 3 * k, *uk = u + 3 * k;
+    double linear[3];
+    cross(wk, p, linear);
+    for (int c = 0; c < 3; ++c)
+    {
+      J[c * nv + body.v_offset + k] = wk[c];
+      J[(3 + c) * nv + body.v_offset + k] = uk[c] + linear[c];
+    }
+  }
+}
+
+static void pointInRoot(const RigidTransform &pose, const double *point, double *p)
+{
+  if (point)
+  {
+    rotate(pose.R, point, p);
+    for (int c = 0; c < 3; ++c)
+      p[c] += pose.p[c];
+  }
+  else
+  {
+    p[0] = pose.p[0];
+    p[1] = pose.p[1];
+    p[2] = pose.p[2];
+  }
+}
+
+void KinematicModel::jacobian(const RigidTransform *poses, std::size_t i, const double *point, double *J) const
+{
+  // the columns of one body: at most 6
+  double w[18], u[18], p[3];
+  pointInRoot(poses[i], point, p);
+  std::fill(J, J + 6 * velocity_size_, 0.0);
+  const std::size_t *support = this->support(i);
+  for (std::size_t s = 0; s < this->supportSize(i); ++s)
+  {
+    const Body &body = bodies_[support[s]];
+    jointMotion(body, poses[support[s]], w, u);
+    fillColumns(body, p, w, u, velocity_size_, J);
+  }
+}
+
+void KinematicModel::jacobians(const RigidTransform *poses, std::size_t count, const std::size_t *bodies,
+                               const double *points, double *J, double *work) const
+{
+  // work: the motions w and u of every velocity coordinate, indexed by v
+  // offset, then a flag per coordinate set once the motion of the body
+  // starting there is computed
+  const std::size_t nv = velocity_size_;
+  double *w = work, *u = work + 3 * nv, *done = work + 6 * nv;
+  std::fill(done, done + nv, 0.0);
+  for (std::size_t m = 0; m < count; ++m)
+  {
+    const std::size_t *support = this->support(bodies[m]);
+    for (std::size_t s = 0; s < this->supportSize(bodies[m]); ++s)
+    {
+      const Body &body = bodies_[support[s]];
+      if (body.v_size == 0 || done[body.v_offset] != 0.0)
+        continue;
+      done[body.v_offset] = 1.0;
+      jointMotion(body, poses[support[s]], w + 3 * body.v_offset, u + 3 * body.v_offset);
+    }
+  }
+
+  for (std::size_t m = 0; m < count; ++m)
+  {
+    double p[3];
+    double *Jm = J + 6 * nv * m;
+    pointInRoot(poses[bodies[m]], points ? points + 3 * m : NULL, p);
+    std::fill(Jm, Jm + 6 * nv, 0.0);
+    const std::size_t *support = this->support(bodies[m]);
+    for (std::size_t s = 0; s < this->supportSize(bodies[m]); ++s)
+    {
+      const Body &body = bodies_[support[s]];
+      fillColumns(body, p, w + 3 * body.v_offset, u + 3 * body.v_offset, nv, Jm);
+    }
+  }
+}
+
+}
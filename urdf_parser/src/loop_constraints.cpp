@@ -0,0 +1,443 @@
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <string>
+#include <vector>
+#include <console_bridge/console.h>
+
+#include <urdf_parser/loop_constraints.h>
+
+#include "./rigid_transform.hpp"
+
+namespace urdf{
+
+void LoopConstraintModel::clear()
+{
+  constraints_.clear();
+  path_.clear();
+  path_begin_.assign(1, 0);
+  path_split_.clear();
+  subspace_.clear();
+  columns_.clear();
+  row_count_ = 0;
+  velocity_size_ = 0;
+  value_count_ = 0;
+}
+
+bool LoopConstraintModel::init(const ModelInterface &model, const KinematicModel &kinematics)
+{
+  this->clear();
+  velocity_size_ = kinematics.velocitySize();
+
+  for (std::map<std::string, ConstraintSharedPtr>::const_iterator it = model.constraints_.begin();
+       it != model.constraints_.end(); ++it)
+  {
+    LoopConstraintSharedPtr loop = std::dynamic_pointer_cast<LoopConstraint>(it->second);
+    if (!loop)
+      continue;
+
+    Constraint constraint;
+    constraint.name = loop->name;
+    constraint.type = loop->type;
+    constraint.predecessor = kinematics.linkIndex(loop->predecessor_link_name);
+    constraint.successor = kinematics.linkIndex(loop->successor_link_name);
+    if (constraint.predecessor == kinematics.bodyCount() || constraint.successor == kinematics.bodyCount())
+    {
+      CONSOLE_BRIDGE_logError("Loop constraint [%s] joins unknown links [%s] and [%s]", loop->name.c_str(),
+                              loop->predecessor_link_name.c_str(), loop->successor_link_name.c_str());
+      this->clear();
+      return false;
+    }
+    poseToTransform(loop->predecessor_to_constraint_origin_transform, constraint.predecessor_frame);
+    poseToTransform(loop->successor_to_constraint_origin_transform, constraint.successor_frame);
+
+    switch (constraint.type)
+    {
+      case LoopConstraint::REVOLUTE:
+      case LoopConstraint::CONTINUOUS:
+        constraint.rows = 5;
+        break;
+      case LoopConstraint::PRISMATIC:
+        constraint.rows = 5;
+        break;
+      case LoopConstraint::PLANAR:
+        constraint.rows = 3;
+        break;
+      case LoopConstraint::FIXED:
+        constraint.rows = 6;
+        break;
+      default:
+        CONSOLE_BRIDGE_logError("Loop constraint [%s] has an unknown type", loop->name.c_str());
+        this->clear();
+        return false;
+    }
+
+    const double n = std::sqrt(loop->axis.x * loop->axis.x + loop->axis.y * loop->axis.y + loop->axis.z * loop->axis.z);
+    if (n == 0.0 && constraint.type != LoopConstraint::FIXED)
+    {
+      CONSOLE_BRIDGE_logError("Loop constraint [%s] has a zero axis", loop->name.c_str());
+      this->clear();
+      return false;
+    }
+    constraint.axis[0] = n > 0.0 ? loop->axis.x / n : 1.0;
+    constraint.axis[1] = n > 0.0 ? loop->axis.y / n : 0.0;
+    constraint.axis[2] = n > 0.0 ? loop->axis.z / n : 0.0;
+    planeBasis(constraint.axis, constraint.u, constraint.w);
+
+    constraint.row = row_count_;
+    row_count_ += constraint.rows;
+
+    // the paths: the supports of the successor and the predecessor, less
+    // their common prefix for the predecessor
+    const std::size_t *succ = kinematics.support(constraint.successor);
+    const std::size_t *pred = kinematics.support(constraint.predecessor);
+    const std::size_t succ_size = kinematics.supportSize(constraint.successor);
+    const std::size_t pred_size = kinematics.supportSize(constraint.predecessor);
+    std::size_t common = 0;
+    while (common < succ_size && common < pred_size && succ[common] == pred[common])
+      ++common;
+
+    constraint.column_begin = columns_.size();
+    std::vector<std::size_t> bodies(succ, succ + succ_size);
+    bodies.insert(bodies.end(), pred + common, pred + pred_size);
+    for (std::size_t j = common; j < bodies.size(); ++j)
+    {
+      const KinematicModel::Body &body = kinematics.body(bodies[j]);
+      for (std::size_t k = 0; k < body.v_size; ++k)
+        columns_.push_back(body.v_offset + k);
+    }
+    std::sort(columns_.begin() + constraint.column_begin, columns_.end());
+    constraint.column_end = columns_.size();
+    constraint.value_offset = value_count_;
+    value_count_ += constraint.rows * (constraint.column_end - constraint.column_begin);
+
+    for (std::size_t j = 0; j < bodies.size(); ++j)
+    {
+      const KinematicModel::Body &body = kinematics.body(bodies[j]);
+      PathJoint joint;
+      joint.body = bodies[j];
+      joint.v_offset = body.v_offset;
+      joint.v_size = body.v_size;
+      joint.column = -1;
+      if (j >= common)
+      {
+        joint.column = static_cast<int>(
+          std::lower_bound(columns_.begin() + constraint.column_begin, columns_.end(), body.v_offset) -
+          (columns_.begin() + constraint.column_begin));
+      }
+      joint.subspace = subspace_.size();
+      subspace_.resize(subspace_.size() + 6 * body.v_size);
+      jointSubspace(body, &subspace_[joint.subspace]);
+      path_.push_back(joint);
+      if (j + 1 == succ_size)
+        path_split_.push_back(path_.size());
+    }
+    if (succ_size == 0)
+      path_split_.push_back(path_.size());
+    path_begin_.push_back(path_.size());
+    constraints_.push_back(constraint);
+  }
+  return true;
+}
+
+// adds the motion of a path joint: V += vJ and A += V x vJ, with vJ the
+// joint velocity in the root frame about the root origin
+void LoopConstraintModel::accumulate(const PathJoint &joint, const RigidTransform *poses, const double *v,
+                                     PathMotion &m) const
+{
+  const RigidTransform &X = poses[joint.body];
+  double vJ[6] = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+  for (std::size_t l = 0; l < joint.v_size; ++l)
+  {
+    const double *S = &subspace_[joint.subspace + 6 * l];
+    double omega[3], lin[3], moment[3];
+    rotate(X.R, S, omega);
+    rotate(X.R, S + 3, lin);
+    cross(X.p, omega, moment);
+    const double vl = v[joint.v_offset + l];
+    for (int i = 0; i < 3; ++i)
+    {
+      vJ[i] += omega[i] * vl;
+      vJ[3 + i] += (lin[i] + moment[i]) * vl;
+    }
+  }
+  double t[3], s[3], q[3];
+  cross(m.V, vJ, t);
+  cross(m.V, vJ + 3, s);
+  cross(m.V + 3, vJ, q);
+  for (int i = 0; i < 3; ++i)
+  {
+    m.A[i] += t[i];
+    m.A[3 + i] += s[i] + q[i];
+  }
+  for (int i = 0; i < 6; ++i)
+    m.V[i] += vJ[i];
+}
+
+// velocity and classical acceleration of the point p of a body with
+// spatial velocity V and acceleration A
+static void pointMotion(const double *V, const double *A, const double *p, double *velocity, double *acceleration)
+{
+  double t[3];
+  cross(V, p, t);
+  for (int c = 0; c < 3; ++c)
+    velocity[c] = V[3 + c] + t[c];
+  cross(A, p, t);
+  double s[3];
+  cross(V, velocity, s);
+  for (int c = 0; c < 3; ++c)
+    acceleration[c] = A[3 + c] + t[c] + s[c];
+}
+
+void LoopConstraintModel::compute(std::size_t c, const RigidTransform *poses, double *phi, double *K, bool dense,
+                                  const double *v, double *k) const
+{
+  const Constraint &constraint = constraints_[c];
+  RigidTransform Fp, Fs;
+  compose(poses[constraint.predecessor], constraint.predecessor_frame, Fp);
+  compose(poses[constraint.successor], constraint.successor_frame, Fs);
+
+  // relative rotation and translation of the successor frame in the
+  // predecessor frame
+  double Rr[9], d[3], diff[3];
+  for (int i = 0; i < 3; ++i)
+    for (int j = 0; j < 3; ++j)
+      Rr[3 * i + j] = Fp.R[i] * Fs.R[j] + Fp.R[3 + i] * Fs.R[3 + j] + Fp.R[6 + i] * Fs.R[6 + j];
+  for (int i = 0; i < 3; ++i)
+    diff[i] = Fs.p[i] - Fp.p[i];
+  rotateTransposed(Fp.R, diff, d);
+
+  const double *a = constraint.axis, *u = constraint.u, *w = constraint.w;
+  const bool axis_rotation = constraint.type == LoopConstraint::REVOLUTE ||
+                             constraint.type == LoopConstraint::CONTINUOUS ||
+                             constraint.type == LoopConstraint::PLANAR;
+  const std::size_t rotation_rows = axis_rotation ? 2 : 3;
+
+  // translation directions
+  const double unit[3][3] = {{1.0, 0.0, 0.0}, {0.0, 1.0, 0.0}, {0.0, 0.0, 1.0}};
+  const double *directions[3] = {unit[0], unit[1], unit[2]};
+  std::size_t translation_rows = 3;
+  if (constraint.type == LoopConstraint::PRISMATIC)
+  {
+    directions[0] = u;
+    directions[1] = w;
+    translation_rows = 2;
+  }
+  else if (constraint.type == LoopConstraint::PLANAR)
+  {
+    directions[0] = a;
+    translation_rows = 1;
+  }
+
+  // rotation rows as functions of the relative angular velocity r:
+  // rows of A with phi_rot' = A r
+  double b[3], A[9];
+  rotate(Rr, a, b);
+  if (axis_rotation)
+  {
+    // phi = (u . (a x b), w . (a x b)), b = Rr a
+    const double ab = dot(a, b), ub = dot(u, b), wb = dot(w, b);
+    for (int j = 0; j < 3; ++j)
+    {
+      A[j] = ab * u[j] - ub * a[j];
+      A[3 + j] = ab * w[j] - wb * a[j];
+    }
+  }
+  else
+  {
+    // phi = vee(Rr - Rr^T) / 2
+    const double trace = Rr[0] + Rr[4] + Rr[8];
+    for (int i = 0; i < 3; ++i)
+      for (int j = 0; j < 3; ++j)
+        A[3 * i + j] = 0.5 * ((i == j ? trace : 0.0) - Rr[3 * i + j]);
+  }
+
+  if (phi)
+  {
+    double *out = phi + constraint.row;
+    if (axis_rotation)
+    {
+      double ab[3];
+      cross(a, b, ab);
+      out[0] = dot(u, ab);
+      out[1] = dot(w, ab);
+    }
+    else
+    {
+      out[0] = 0.5 * (Rr[7] - Rr[5]);
+      out[1] = 0.5 * (Rr[2] - Rr[6]);
+      out[2] = 0.5 * (Rr[3] - Rr[1]);
+    }
+    for (std::size_t r = 0; r < translation_rows; ++r)
+      out[rotation_rows + r] = dot(directions[r], d);
+  }
+
+  if (K)
+  {
+    const std::size_t stride = dense ? velocity_size_ : constraint.column_end - constraint.column_begin;
+    for (std::size_t r = 0; r < constraint.rows; ++r)
+      std::fill(K + r * stride, K + (r + 1) * stride, 0.0);
+    for (std::size_t j = path_begin_[c]; j < path_begin_[c + 1]; ++j)
+    {
+      const PathJoint &joint = path_[j];
+      if (joint.column < 0)
+        continue;
+      const double sign = j < path_split_[c] ? 1.0 : -1.0;
+      const RigidTransform &X = poses[joint.body];
+      for (std::size_t l = 0; l < joint.v_size; ++l)
+      {
+        // the column in the root frame, then in the predecessor frame at the
+        // successor frame origin
+        const double *S = &subspace_[joint.subspace + 6 * l];
+        double omega[3], lin[3], moment[3], r[3], nu[3];
+        rotate(X.R, S, omega);
+        rotate(X.R, S + 3, lin);
+        for (int i = 0; i < 3; ++i)
+          diff[i] = Fs.p[i] - X.p[i];
+        cross(omega, diff, moment);
+        for (int i = 0; i < 3; ++i)
+          lin[i] = sign * (lin[i] + moment[i]);
+        for (int i = 0; i < 3; ++i)
+          omega[i] *= sign;
+        rotateTransposed(Fp.R, omega, r);
+        rotateTransposed(Fp.R, lin, nu);
+
+        const std::size_t column = dense ? joint.v_offset + l : joint.column + l;
+        for (std::size_t row = 0; row < rotation_rows; ++row)
+          K[row * stride + column] = dot(A + 3 * row, r);
+        for (std::size_t row = 0; row < translation_rows; ++row)
+          K[(rotation_rows + row) * stride + column] = dot(directions[row], nu);
+      }
+    }
+  }
+
+  if (k)
+  {
+    // velocities and bias accelerations along the successor path, then along
+    // the predecessor path from the state after the common ancestors
+    PathMotion succ, pred;
+    for (int i = 0; i < 6; ++i)
+      succ.V[i] = succ.A[i] = 0.0;
+    pred = succ;
+    bool common = true;
+    for (std::size_t j = path_begin_[c]; j < path_split_[c]; ++j)
+    {
+      if (common && path_[j].column >= 0)
+      {
+        pred = succ;
+        common = false;
+      }
+      this->accumulate(path_[j], poses, v, succ);
+    }
+    if (common)
+      pred = succ;
+    for (std::size_t j = path_split_[c]; j < path_begin_[c + 1]; ++j)
+      this->accumulate(path_[j], poses, v, pred);
+
+    double ps_dot[3], ps_ddot[3], pp_dot[3], pp_ddot[3];
+    pointMotion(succ.V, succ.A, Fs.p, ps_dot, ps_ddot);
+    pointMotion(pred.V, pred.A, Fp.p, pp_dot, pp_ddot);
+
+    // relative angular velocity r and its rate, in the predecessor frame
+    double wp[3], ap[3], r[3], r_dot[3], t[3];
+    rotateTransposed(Fp.R, pred.V, wp);
+    rotateTransposed(Fp.R, pred.A, ap);
+    for (int i = 0; i < 3; ++i)
+      t[i] = succ.V[i] - pred.V[i];
+    rotateTransposed(Fp.R, t, r);
+    for (int i = 0; i < 3; ++i)
+      t[i] = succ.A[i] - pred.A[i];
+    rotateTransposed(Fp.R, t, r_dot);
+    cross(wp, r, t);
+    for (int i = 0; i < 3; ++i)
+      r_dot[i] -= t[i];
+
+    // second derivative of d
+    double dd[3], d_dot[3], d_ddot[3], x[3];
+    for (int i = 0; i < 3; ++i)
+      t[i] = ps_dot[i] - pp_dot[i];
+    rotateTransposed(Fp.R, t, dd);
+    cross(wp, d, t);
+    for (int i = 0; i < 3; ++i)
+      d_dot[i] = dd[i] - t[i];
+    for (int i = 0; i < 3; ++i)
+      t[i] = ps_ddot[i] - pp_ddot[i];
+    rotateTransposed(Fp.R, t, d_ddot);
+    cross(wp, dd, t);
+    cross(ap, d, x);
+    for (int i = 0; i < 3; ++i)
+      d_ddot[i] -= t[i] + x[i];
+    cross(wp, d_dot, t);
+    for (int i = 0; i < 3; ++i)
+      d_ddot[i] -= t[i];
+
+    double *out = k + constraint.row;
+    for (std::size_t row = 0; row < rotation_rows; ++row)
+      out[row] = dot(A + 3 * row, r_dot);
+    if (axis_rotation)
+    {
+      // dA/dt r with b' = r x b
+      double b_dot[3];
+      cross(r, b, b_dot);
+      const double ab = dot(a, b_dot), ar = dot(a, r);
+      out[0] += ab * dot(u, r) - dot(u, b_dot) * ar;
+      out[1] += ab * dot(w, r) - dot(w, b_dot) * ar;
+    }
+    else
+    {
+      // dA/dt r = (tr([r] Rr) r - r x (Rr r)) / 2
+      double column[3], rc[3], Rr_r[3];
+      double trace = 0.0;
+      for (int i = 0; i < 3; ++i)
+      {
+        column[0] = Rr[i];
+        column[1] = Rr[3 + i];
+        column[2] = Rr[6 + i];
+        cross(r, column, rc);
+        trace += rc[i];
+      }
+      rotate(Rr, r, Rr_r);
+      cross(r, Rr_r, rc);
+      for (int i = 0; i < 3; ++i)
+        out[i] += 0.5 * (trace * r[i] - rc[i]);
+    }
+    for (std::size_t row = 0; row < translation_rows; ++row)
+      out[rotation_rows + row] = dot(directions[row], d_ddot);
+  }
+}
+
+void LoopConstraintModel::residual(const RigidTransform *poses, double *phi) const
+{
+  for (std::size_t c = 0; c < constraints_.size(); ++c)
+    this->compute(c, poses, phi, NULL, true, NULL, NULL);
+}
+
+void LoopConstraintModel::jacobian(const RigidTransform *poses, double *K) const
+{
+  for (std::size_t c = 0; c < constraints_.size(); ++c)
+    this->compute(c, poses, NULL, K + constraints_[c].row * velocity_size_, true, NULL, NULL);
+}
+
+void LoopConstraintModel::sparseJacobian(const RigidTransform *poses, double *values) const
+{
+  for (std::size_t c = 0; c < constraints_.size(); ++c)
+    this->compute(c, poses, NULL, values + constraints_[c].value_offset, false, NULL, NULL);
+}
+
+void LoopConstraintModel::residual(std::size_t c, const RigidTransform *poses, double *phi) const
+{
+  this->compute(c, poses, phi, NULL, true, NULL, NULL);
+}
+
+void LoopConstraintModel::sparseJacobian(std::size_t c, const RigidTransform *poses, double *values) const
+{
+  this->compute(c, poses, NULL, values + constraints_[c].value_offset, false, NULL, NULL);
+}
+
+void LoopConstraintModel::bias(const RigidTransform *poses, const double *v, double *k) const
+{
+  for (std::size_t c = 0; c < constraints_.size(); ++c)
+    this->compute(c, poses, NULL, NULL, true, v, k);
+}
+
+}
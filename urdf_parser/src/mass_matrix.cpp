@@ -0,0 +1,165 @@
+#include <algorithm>
+#include <vector>
+
+#include <urdf_parser/dynamics.h>
+
+#include "./spatial.hpp"
+
+namespace urdf{
+
+void ClusterBlockMatrix::resize(const DynamicsModel &model)
+{
+  const std::size_t clusters = model.clusterCount();
+  parent_.resize(clusters);
+  v_first_.resize(clusters);
+  v_size_.resize(clusters);
+  depth_.resize(clusters);
+  velocity_order_ = model.velocityOrder();
+  cluster_.resize(velocity_order_.size());
+  rank_.resize(velocity_order_.size());
+  block_begin_.assign(1, 0);
+  offset_.clear();
+
+  std::size_t values = 0;
+  for (std::size_t c = 0; c < clusters; ++c)
+  {
+    const DynamicsModel::Cluster &cluster = model.cluster(c);
+    parent_[c] = cluster.parent;
+    v_first_[c] = cluster.v_first;
+    v_size_[c] = cluster.v_size;
+    depth_[c] = cluster.depth;
+    for (std::size_t k = 0; k < cluster.v_size; ++k)
+    {
+      cluster_[velocity_order_[cluster.v_first + k]] = c;
+      rank_[velocity_order_[cluster.v_first + k]] = k;
+    }
+    for (int a = static_cast<int>(c); a >= 0; a = model.cluster(a).parent)
+    {
+      offset_.push_back(values);
+      values += cluster.v_size * model.cluster(a).v_size;
+    }
+    block_begin_.push_back(offset_.size());
+  }
+  values_.assign(values, 0.0);
+}
+
+void ClusterBlockMatrix::setZero()
+{
+  std::fill(values_.begin(), values_.end(), 0.0);
+}
+
+std::size_t ClusterBlockMatrix::blockColumn(std::size_t c, std::size_t k) const
+{
+  std::size_t a = c;
+  for (; k > 0; --k)
+    a = parent_[a];
+  return a;
+}
+
+std::size_t ClusterBlockMatrix::entryOffset(std::size_t row, std::size_t col) const
+{
+  const std::size_t c = cluster_[row], a = cluster_[col];
+  return offset_[block_begin_[c] + depth_[c] - depth_[a]] + rank_[row] * v_size_[a] + rank_[col];
+}
+
+void ClusterBlockMatrix::toDense(double *M) const
+{
+  const std::size_t n = velocity_order_.size();
+  std::fill(M, M + n * n, 0.0);
+  for (std::size_t c = 0; c < parent_.size(); ++c)
+  {
+    std::size_t a = c;
+    for (std::size_t k = 0; k < this->blockCount(c); ++k, a = parent_[a])
+    {
+      const double *B = this->block(c, k);
+      for (std::size_t r = 0; r < v_size_[c]; ++r)
+      {
+        const std::size_t row = velocity_order_[v_first_[c] + r];
+        for (std::size_t s = 0; s < v_size_[a]; ++s)
+        {
+          const std::size_t col = velocity_order_[v_first_[a] + s];
+          M[row * n + col] = B[r * v_size_[a] + s];
+          M[col * n + row] = B[r * v_size_[a] + s];
+        }
+      }
+    }
+  }
+}
+
+void ClusterBlockMatrix::multiply(const double *x, double *y) const
+{
+  std::fill(y, y + velocity_order_.size(), 0.0);
+  for (std::size_t c = 0; c < parent_.size(); ++c)
+  {
+    std::size_t a = c;
+    for (std::size_t k = 0; k < this->blockCount(c); ++k, a = parent_[a])
+    {
+      const double *B = this->block(c, k);
+      for (std::size_t r = 0; r < v_size_[c]; ++r)
+      {
+        const std::size_t row = velocity_order_[v_first_[c] + r];
+        double sum = 0.0;
+        for (std::size_t s = 0; s < v_size_[a]; ++s)
+        {
+          const std::size_t col = velocity_order_[v_first_[a] + s];
+          sum += B[r * v_size_[a] + s] * x[col];
+          // the transposed block above the diagonal
+          if (k > 0)
+            y[col] += B[r * v_size_[a] + s] * x[row];
+        }
+        y[row] += sum;
+      }
+    }
+  }
+}
+
+void DynamicsModel::massMatrix(DynamicsData &data, const double *q, ClusterBlockMatrix &M) const
+{
+  const std::size_t bodies = order_.size();
+  M.setZero();
+  if (bodies == 0)
+    return;
+
+  // composite inertias, leaves first
+  for (std::size_t s = 0; s < bodies; ++s)
+  {
+    const std::size_t i = order_[s];
+    data.composite[s] = inertias_[i];
+    if (s > 0)
+      kinematics_.jointTransform(i, q, data.local[s]);
+  }
+  for (std::size_t s = bodies; s-- > 1;)
+    addInertiaToParent(data.local[s], data.composite[s], data.composite[slot_[kinematics_.body(order_[s]).parent]]);
+
+  // the force F = Ic S of each coordinate, carried to the root, gives the
+  // row of M against every coordinate it meets
+  for (std::size_t s = 1; s < bodies; ++s)
+  {
+    const KinematicModel::Body &body = kinematics_.body(order_[s]);
+    for (std::size_t k = body.v_offset; k < body.v_offset + body.v_size; ++k)
+    {
+      double F[6];
+      applyInertia(data.composite[s], &subspace_[6 * k], F);
+      for (std::size_t l = body.v_offset; l < body.v_offset + body.v_size; ++l)
+        M.entry(k, l) = dot6(&subspace_[6 * l], F);
+
+      for (std::size_t j = s; kinematics_.body(order_[j]).parent > 0;)
+      {
+        double Fp[6];
+        forceToParent(data.local[j], F, Fp);
+        std::copy(Fp, Fp + 6, F);
+        j = slot_[kinematics_.body(order_[j]).parent];
+        const KinematicModel::Body &ancestor = kinematics_.body(order_[j]);
+        for (std::size_t l = ancestor.v_offset; l < ancestor.v_offset + ancestor.v_size; ++l)
+        {
+          const double value = dot6(&subspace_[6 * l], F);
+          M.entry(k, l) = value;
+          if (clusterOf(order_[j]) == clusterOf(order_[s]))
+            M.entry(l, k) = value;
+        }
+      }
+    }
+  }
+}
+
+}
@@ -0,0 +1,180 @@
+#include <string>
+#include <vector>
+#include <console_bridge/console.h>
+
+#include <urdf_parser/mimic_map.h>
+
+namespace urdf{
+
+static const std::size_t NONE = static_cast<std::size_t>(-1);
+
+void MimicMap::clear()
+{
+  active_positions_.clear();
+  active_velocities_.clear();
+  position_source_.clear();
+  position_multiplier_.clear();
+  position_offset_.clear();
+  velocity_source_.clear();
+  velocity_multiplier_.clear();
+}
+
+bool MimicMap::init(const ModelInterface &model, const KinematicModel &kinematics)
+{
+  this->clear();
+  const std::size_t bodies = kinematics.bodyCount();
+
+  // the body each mimic body follows directly
+  std::vector<std::size_t> follows(bodies, NONE);
+  std::vector<JointMimicConstSharedPtr> mimics(bodies);
+  for (std::size_t i = 1; i < bodies; ++i)
+  {
+    JointConstSharedPtr joint = model.getJoint(kinematics.jointName(i));
+    if (!joint || !joint->mimic)
+      continue;
+    const std::size_t source = kinematics.jointIndex(joint->mimic->joint_name);
+    if (source == bodies)
+    {
+      CONSOLE_BRIDGE_logError("Joint [%s] mimics unknown joint [%s]", joint->name.c_str(),
+                              joint->mimic->joint_name.c_str());
+      this->clear();
+      return false;
+    }
+    if (kinematics.body(i).v_size != 1 || kinematics.body(source).v_size != 1)
+    {
+      CONSOLE_BRIDGE_logError("Joint [%s] mimics joint [%s], but both must have one degree of freedom",
+                              joint->name.c_str(), joint->mimic->joint_name.c_str());
+      this->clear();
+      return false;
+    }
+    follows[i] = source;
+    mimics[i] = joint->mimic;
+  }
+
+  position_source_.assign(kinematics.positionSize(), NONE);
+  position_multiplier_.assign(kinematics.positionSize(), 1.0);
+  position_offset_.assign(kinematics.positionSize(), 0.0);
+  velocity_source_.assign(kinematics.velocitySize(), NONE);
+  velocity_multiplier_.assign(kinematics.velocitySize(), 1.0);
+
+  // compose each chain: with q[i] = m q[j] + o and q[j] = m_j q[k] + o_j,
+  // q[i] = m m_j q[k] + m o_j + o
+  std::vector<std::size_t> active(bodies);
+  for (std::size_t i = 0; i < bodies; ++i)
+  {
+    std::size_t j = i;
+    double multiplier = 1.0, offset = 0.0;
+    for (std::size_t steps = 0; follows[j] != NONE; ++steps)
+    {
+      if (steps == bodies)
+      {
+        CONSOLE_BRIDGE_logError("Mimic joints form a cycle through joint [%s]", kinematics.jointName(j).c_str());
+        this->clear();
+        return false;
+      }
+      offset += multiplier * mimics[j]->offset;
+      multiplier *= mimics[j]->multiplier;
+      j = follows[j];
+    }
+    active[i] = j;
+    const KinematicModel::Body &body = kinematics.body(i);
+    if (j != i)
+    {
+      position_multiplier_[body.q_offset] = multiplier;
+      position_offset_[body.q_offset] = offset;
+      velocity_multiplier_[body.v_offset] = multiplier;
+    }
+  }
+
+  // number the active coordinates in the order of the full vectors, then
+  // point every coordinate at its active one
+  std::vector<std::size_t> position_index(kinematics.positionSize(), NONE);
+  std::vector<std::size_t> velocity_index(kinematics.velocitySize(), NONE);
+  for (std::size_t i = 0; i < bodies; ++i)
+  {
+    if (active[i] != i)
+      continue;
+    const KinematicModel::Body &body = kinematics.body(i);
+    for (std::size_t k = 0; k < body.q_size; ++k)
+      position_index[body.q_offset + k] = 0;
+    for (std::size_t k = 0; k < body.v_size; ++k)
+      velocity_index[body.v_offset + k] = 0;
+  }
+  for (std::size_t k = 0; k < position_index.size(); ++k)
+  {
+    if (position_index[k] == NONE)
+      continue;
+    position_index[k] = active_positions_.size();
+    active_positions_.push_back(k);
+  }
+  for (std::size_t k = 0; k < velocity_index.size(); ++k)
+  {
+    if (velocity_index[k] == NONE)
+      continue;
+    velocity_index[k] = active_velocities_.size();
+    active_velocities_.push_back(k);
+  }
+  for (std::size_t i = 0; i < bodies; ++i)
+  {
+    const KinematicModel::Body &body = kinematics.body(i), &source = kinematics.body(active[i]);
+    for (std::size_t k = 0; k < body.q_size; ++k)
+      position_source_[body.q_offset + k] = position_index[source.q_offset + k];
+    for (std::size_t k = 0; k < body.v_size; ++k)
+      velocity_source_[body.v_offset + k] = velocity_index[source.v_offset + k];
+  }
+  return true;
+}
+
+void MimicMap::applyPositions(std::size_t count, const double *a, double *q) const
+{
+  const std::size_t n = position_source_.size(), na = active_positions_.size();
+  for (std::size_t c = 0; c < count; ++c, a += na, q += n)
+  {
+    for (std::size_t k = 0; k < n; ++k)
+      q[k] = position_multiplier_[k] * a[position_source_[k]] + position_offset_[k];
+  }
+}
+
+void MimicMap::applyVelocities(std::size_t count, const double *a, double *v) const
+{
+  const std::size_t n = velocity_source_.size(), na = active_velocities_.size();
+  for (std::size_t c = 0; c < count; ++c, a += na, v += n)
+  {
+    for (std::size_t k = 0; k < n; ++k)
+      v[k] = velocity_multiplier_[k] * a[velocity_source_[k]];
+  }
+}
+
+void MimicMap::applyTranspose(std::size_t count, const double *tau, double *a) const
+{
+  const std::size_t n = velocity_source_.size(), na = active_velocities_.size();
+  for (std::size_t c = 0; c < count; ++c, tau += n, a += na)
+  {
+    for (std::size_t i = 0; i < na; ++i)
+      a[i] = 0.0;
+    for (std::size_t k = 0; k < n; ++k)
+      a[velocity_source_[k]] += velocity_multiplier_[k] * tau[k];
+  }
+}
+
+void MimicMap::gatherPositions(std::size_t count, const double *q, double *a) const
+{
+  const std::size_t n = position_source_.size(), na = active_positions_.size();
+  for (std::size_t c = 0; c < count; ++c, q += n, a += na)
+  {
+    for (std::size_t i = 0; i < na; ++i)
+      a[i] = q[active_positions_[i]];
+  }
+}
+
+void MimicMap::gatherVelocities(std::size_t count, const double *v, double *a) const
+{
+  const std::size_t n = velocity_source_.size(), na = active_velocities_.size();
+  for (std::size_t c = 0; c < count; ++c, v += n, a += na)
+  {
+    for (std::size_t i = 0; i < na; ++i)
+      a[i] = v[active_velocities_[i]];
+  }
+}
+
+}
@@ -38,6 +38,7 @@
 #include <map>
 #include <stdexcept>
 #include <string>
+#include <vector>
 #include "urdf_parser/urdf_parser.h"
 #include <console_bridge/console.h>
 #include <tinyxml2.h>
@@ -49,6 +50,7 @@ bool parseLink(Link &link, tinyxml2::XMLElement *config);
 bool parseJoint(Joint &joint, tinyxml2::XMLElement *config);
 bool parseCouplingConstraint(CouplingConstraint &constraint, tinyxml2::XMLElement *config);
 bool parseLoopConstraint(LoopConstraint &constraint, tinyxml2::XMLElement *config);
+bool parseSensorInternal(Sensor &sensor, tinyxml2::XMLElement *config);
 
 ModelInterfaceSharedPtr  parseURDFFile(const std::string &path)
 {
@@ -64,6 +66,21 @@ ModelInterfaceSharedPtr  parseURDFFile(const std::string &path)
     return urdf::parseURDF( xml_str );
 }
 
+ModelInterfaceSharedPtr  parseURDFFile(const std::string &path, SensorTable &sensors)
+{
+    std::ifstream stream( path.c_str() );
+    if (!stream)
+    {
+      CONSOLE_BRIDGE_logError(("File " + path + " does not exist").c_str());
+      sensors.clear();
+      return ModelInterfaceSharedPtr();
+    }
+
+    std::string xml_str((std::istreambuf_iterator<char>(stream)),
+	                     std::istreambuf_iterator<char>());
+    return urdf::parseURDF( xml_str, sensors );
+}
+
 ModelInterfaceSharedPtr  parseURDFFiles(const std::vector<std::string> &paths)
 {
     ModelInterfaceSharedPtr model(new ModelInterface);
@@ -177,7 +194,7 @@ bool assignMaterial(const VisualSharedPtr& visual, ModelInterfaceSharedPtr& mode
   return true;
 }
 
-ModelInterfaceSharedPtr  parseURDF(const std::string &xml_string)
+static ModelInterfaceSharedPtr  parseURDFInternal(const std::string &xml_string, SensorTable *sensors)
 {
   ModelInterfaceSharedPtr model(new ModelInterface);
   model->clear();
@@ -411,9 +428,50 @@ ModelInterfaceSharedPtr  parseURDF(const std::string &xml_string)
     return model;
   }
 
+  if (sensors)
+  {
+    // Get all Sensor elements; types other than camera and ray are skipped
+    std::vector<SensorSharedPtr> sensor_list;
+    for (tinyxml2::XMLElement* sensor_xml = robot_xml->FirstChildElement("sensor"); sensor_xml; sensor_xml = sensor_xml->NextSiblingElement("sensor"))
+    {
+      if (!sensor_xml->FirstChildElement("camera") && !sensor_xml->FirstChildElement("ray"))
+      {
+        const char *sensor_name = sensor_xml->Attribute("name");
+        CONSOLE_BRIDGE_logWarn("Skipping sensor [%s]: no known sensor type [camera|ray]", sensor_name ? sensor_name : "");
+        continue;
+      }
+
+      SensorSharedPtr sensor(new Sensor);
+      if (!parseSensorInternal(*sensor, sensor_xml) || !sensor->sensor)
+      {
+        CONSOLE_BRIDGE_logError("sensor xml is not initialized correctly");
+        model.reset();
+        return model;
+      }
+      sensor_list.push_back(sensor);
+    }
+
+    if (!sensors->init(*model, sensor_list))
+    {
+      model.reset();
+      return model;
+    }
+  }
+
   return model;
 }
 
+ModelInterfaceSharedPtr  parseURDF(const std::string &xml_string)
+{
+  return parseURDFInternal(xml_string, nullptr);
+}
+
+ModelInterfaceSharedPtr  parseURDF(const std::string &xml_string, SensorTable &sensors)
+{
+  sensors.clear();
+  return parseURDFInternal(xml_string, &sensors);
+}
+
 bool exportMaterial(Material &material, tinyxml2::XMLElement *config);
 bool exportLink(Link &link, tinyxml2::XMLElement *config);
 bool exportJoint(Joint &joint, tinyxml2::XMLElement *config);
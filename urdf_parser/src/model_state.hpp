@@ -0,0 +1,16 @@
+#ifndef URDF_PARSER_MODEL_STATE_HPP
+#define URDF_PARSER_MODEL_STATE_HPP
+
+#include <urdf_model_state/model_state.h>
+#include <tinyxml2.h>
+
+namespace urdf {
+
+// Fills ms from a <model_state> element, reusing the JointState objects (and
+// their vectors) that ms already holds.  Throws ParseError on malformed
+// numbers.
+bool parseModelStateInternal(ModelState &ms, tinyxml2::XMLElement* config);
+
+}
+
+#endif
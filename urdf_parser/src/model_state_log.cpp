@@ -0,0 +1,825 @@
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <console_bridge/console.h>
+
+#include <urdf_parser/model_state_log.h>
+
+#ifdef _WIN32
+#include <iterator>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace urdf{
+
+namespace {
+
+// File layout (all integers little endian):
+//   header: "UMSLOG2\0", u32 block capacity, str model name, u32 joint count,
+//           then per joint: str name, u32 position/velocity/effort sizes
+//   blocks: u32 block magic, u32 record count, u64 payload bytes,
+//           i64 first time stamp, i64 last time stamp, payload
+//   payload: one zig-zag varint per record holding the change of the time
+//            stamp delta (delta of delta, zero for a steady rate), then for
+//            every column one xor value per record: the XOR x of the value
+//            bits with those of the previous record (zero before the first),
+//            as a control byte (leading zero bytes of x) << 4 | (trailing
+//            zero bytes of x) followed by the remaining middle bytes of x,
+//            least significant first.  x == 0 is the single byte 0x80.
+// str is a u32 length followed by the bytes.
+const char FILE_MAGIC[8] = {'U', 'M', 'S', 'L', 'O', 'G', '2', '\0'};
+const uint32_t BLOCK_MAGIC = 0x4b4c4253;  // "SBLK"
+const std::size_t BLOCK_HEADER_SIZE = 32;
+const std::size_t MAX_VARINT_SIZE = 10;
+const std::size_t MAX_XOR_SIZE = 9;
+
+void putU32(unsigned char *p, uint32_t v)
+{
+  for (int i = 0; i < 4; ++i)
+    p[i] = static_cast<unsigned char>(v >> (8 * i));
+}
+
+void putU64(unsigned char *p, uint64_t v)
+{
+  for (int i = 0; i < 8; ++i)
+    p[i] = static_cast<unsigned char>(v >> (8 * i));
+}
+
+uint32_t getU32(const unsigned char *p)
+{
+  uint32_t v = 0;
+  for (int i = 0; i < 4; ++i)
+    v |= static_cast<uint32_t>(p[i]) << (8 * i);
+  return v;
+}
+
+uint64_t getU64(const unsigned char *p)
+{
+  uint64_t v = 0;
+  for (int i = 0; i < 8; ++i)
+    v |= static_cast<uint64_t>(p[i]) << (8 * i);
+  return v;
+}
+
+unsigned char *putVarint(unsigned char *p, uint64_t v)
+{
+  while (v >= 0x80)
+  {
+    *p++ = static_cast<unsigned char>(v | 0x80);
+    v >>= 7;
+  }
+  *p++ = static_cast<unsigned char>(v);
+  return p;
+}
+
+const unsigned char *getVarint(const unsigned char *p, const unsigned char *end, uint64_t &v)
+{
+  v = 0;
+  for (int shift = 0; p < end && shift < 64; shift += 7)
+  {
+    unsigned char byte = *p++;
+    v |= static_cast<uint64_t>(byte & 0x7f) << shift;
+    if (!(byte & 0x80))
+      return p;
+  }
+  return nullptr;
+}
+
+unsigned char *putXor(unsigned char *p, uint64_t x)
+{
+  if (x == 0)
+  {
+    *p++ = 0x80;
+    return p;
+  }
+  unsigned lead = 0, trail = 0;
+  while ((x >> (56 - 8 * lead)) == 0)
+    ++lead;
+  while ((x & 0xff) == 0)
+  {
+    x >>= 8;
+    ++trail;
+  }
+  *p++ = static_cast<unsigned char>(lead << 4 | trail);
+  for (unsigned k = lead + trail; k < 8; ++k)
+  {
+    *p++ = static_cast<unsigned char>(x);
+    x >>= 8;
+  }
+  return p;
+}
+
+const unsigned char *getXor(const unsigned char *p, const unsigned char *end, uint64_t &x)
+{
+  if (p >= end)
+    return nullptr;
+  const unsigned lead = *p >> 4, trail = *p & 0x0f;
+  ++p;
+  if (lead + trail > 8 || static_cast<std::size_t>(end - p) < 8 - lead - trail)
+    return nullptr;
+  x = 0;
+  for (unsigned k = 0; k < 8 - lead - trail; ++k)
+    x |= static_cast<uint64_t>(*p++) << (8 * k);
+  if (x != 0)
+    x <<= 8 * trail;
+  return p;
+}
+
+uint64_t zigzag(int64_t v)
+{
+  return (static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63);
+}
+
+int64_t unzigzag(uint64_t v)
+{
+  return static_cast<int64_t>(v >> 1) ^ -static_cast<int64_t>(v & 1);
+}
+
+uint64_t doubleBits(double d)
+{
+  uint64_t bits;
+  std::memcpy(&bits, &d, sizeof(bits));
+  return bits;
+}
+
+double bitsDouble(uint64_t bits)
+{
+  double d;
+  std::memcpy(&d, &bits, sizeof(d));
+  return d;
+}
+
+int64_t toNanoseconds(const Time &t)
+{
+  return static_cast<int64_t>(t.sec) * 1000000000 + t.nsec;
+}
+
+void fromNanoseconds(int64_t ns, Time &t)
+{
+  int64_t sec = ns / 1000000000;
+  int64_t nsec = ns % 1000000000;
+  if (nsec < 0)
+  {
+    nsec += 1000000000;
+    --sec;
+  }
+  t.sec = static_cast<int32_t>(sec);
+  t.nsec = static_cast<int32_t>(nsec);
+}
+
+void putString(std::string &out, const std::string &s)
+{
+  unsigned char len[4];
+  putU32(len, static_cast<uint32_t>(s.size()));
+  out.append(reinterpret_cast<const char *>(len), 4);
+  out.append(s);
+}
+
+bool getString(const unsigned char *&p, const unsigned char *end, std::string &s)
+{
+  if (end - p < 4)
+    return false;
+  uint32_t len = getU32(p);
+  p += 4;
+  if (static_cast<std::size_t>(end - p) < len)
+    return false;
+  s.assign(reinterpret_cast<const char *>(p), len);
+  p += len;
+  return true;
+}
+
+}
+
+void ModelStateLogLayout::clear()
+{
+  model_name.clear();
+  joints.clear();
+  position_size.clear();
+  velocity_size.clear();
+  effort_size.clear();
+  position_offset.clear();
+  velocity_offset.clear();
+  effort_offset.clear();
+  column_count = 0;
+}
+
+void ModelStateLogLayout::init(const ModelState &prototype)
+{
+  clear();
+  model_name = prototype.name;
+  for (const JointStateSharedPtr &js : prototype.joint_states)
+  {
+    joints.push_back(js ? js->joint : std::string());
+    position_size.push_back(js ? static_cast<uint32_t>(js->position.size()) : 0);
+    velocity_size.push_back(js ? static_cast<uint32_t>(js->velocity.size()) : 0);
+    effort_size.push_back(js ? static_cast<uint32_t>(js->effort.size()) : 0);
+  }
+
+  uint32_t column = 0;
+  for (uint32_t size : position_size)
+  {
+    position_offset.push_back(column);
+    column += size;
+  }
+  for (uint32_t size : velocity_size)
+  {
+    velocity_offset.push_back(column);
+    column += size;
+  }
+  for (uint32_t size : effort_size)
+  {
+    effort_offset.push_back(column);
+    column += size;
+  }
+  column_count = column;
+}
+
+struct ModelStateLogWriter::Impl
+{
+  std::ofstream file;
+  ModelStateLogLayout layout;
+  std::size_t block_records = 0;
+  std::size_t pending = 0;
+  std::size_t records = 0;
+  int64_t last_time = 0;
+  // raw samples of the pending block, column major
+  std::vector<int64_t> times;
+  std::vector<double> values;
+  std::vector<unsigned char> encoded;
+
+  // seek() and the block index rely on strictly increasing time stamps
+  bool checkTime(int64_t time_stamp_ns) const
+  {
+    if (records > 0 && time_stamp_ns <= last_time)
+    {
+      CONSOLE_BRIDGE_logError("Model state log time stamp %lld ns does not follow the previous record at %lld ns",
+                              static_cast<long long>(time_stamp_ns), static_cast<long long>(last_time));
+      return false;
+    }
+    return true;
+  }
+
+  bool writeBlock()
+  {
+    if (pending == 0)
+      return true;
+
+    const std::size_t columns = layout.columnCount();
+    unsigned char *p = encoded.data() + BLOCK_HEADER_SIZE;
+
+    int64_t previous_time = times[0], previous_delta = 0;
+    for (std::size_t i = 0; i < pending; ++i)
+    {
+      const int64_t delta = times[i] - previous_time;
+      p = putVarint(p, zigzag(delta - previous_delta));
+      previous_time = times[i];
+      previous_delta = delta;
+    }
+    for (std::size_t c = 0; c < columns; ++c)
+    {
+      const double *column = values.data() + c * block_records;
+      uint64_t previous = 0;
+      for (std::size_t i = 0; i < pending; ++i)
+      {
+        uint64_t bits = doubleBits(column[i]);
+        p = putXor(p, bits ^ previous);
+        previous = bits;
+      }
+    }
+
+    std::size_t payload = static_cast<std::size_t>(p - encoded.data()) - BLOCK_HEADER_SIZE;
+    putU32(encoded.data(), BLOCK_MAGIC);
+    putU32(encoded.data() + 4, static_cast<uint32_t>(pending));
+    putU64(encoded.data() + 8, payload);
+    putU64(encoded.data() + 16, static_cast<uint64_t>(times[0]));
+    putU64(encoded.data() + 24, static_cast<uint64_t>(times[pending - 1]));
+
+    file.write(reinterpret_cast<const char *>(encoded.data()), BLOCK_HEADER_SIZE + payload);
+    pending = 0;
+    return static_cast<bool>(file);
+  }
+};
+
+ModelStateLogWriter::ModelStateLogWriter()
+  : impl_(new Impl)
+{
+}
+
+ModelStateLogWriter::~ModelStateLogWriter()
+{
+  close();
+}
+
+bool ModelStateLogWriter::open(const std::string &path, const ModelState &prototype, std::size_t block_records)
+{
+  close();
+  if (block_records == 0)
+  {
+    CONSOLE_BRIDGE_logError("Model state log blocks must hold at least one record");
+    return false;
+  }
+
+  impl_->file.open(path.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+  if (!impl_->file)
+  {
+    CONSOLE_BRIDGE_logError(("Could not create model state log " + path).c_str());
+    return false;
+  }
+
+  ModelStateLogLayout &layout = impl_->layout;
+  layout.init(prototype);
+  impl_->block_records = block_records;
+  impl_->times.assign(block_records, 0);
+  impl_->values.assign(block_records * layout.columnCount(), 0.0);
+  impl_->encoded.assign(BLOCK_HEADER_SIZE + block_records * (MAX_VARINT_SIZE + layout.columnCount() * MAX_XOR_SIZE), 0);
+
+  std::string header(FILE_MAGIC, sizeof(FILE_MAGIC));
+  unsigned char u32[4];
+  putU32(u32, static_cast<uint32_t>(block_records));
+  header.append(reinterpret_cast<const char *>(u32), 4);
+  putString(header, layout.model_name);
+  putU32(u32, static_cast<uint32_t>(layout.joints.size()));
+  header.append(reinterpret_cast<const char *>(u32), 4);
+  for (std::size_t j = 0; j < layout.joints.size(); ++j)
+  {
+    putString(header, layout.joints[j]);
+    for (uint32_t size : {layout.position_size[j], layout.velocity_size[j], layout.effort_size[j]})
+    {
+      putU32(u32, size);
+      header.append(reinterpret_cast<const char *>(u32), 4);
+    }
+  }
+  impl_->file.write(header.data(), header.size());
+  return static_cast<bool>(impl_->file);
+}
+
+bool ModelStateLogWriter::append(const ModelState &ms)
+{
+  if (!impl_->file.is_open())
+    return false;
+
+  const ModelStateLogLayout &layout = impl_->layout;
+  if (ms.joint_states.size() != layout.joints.size())
+  {
+    CONSOLE_BRIDGE_logError("model_state [%s] has %zu joint states, the log expects %zu",
+                            ms.name.c_str(), ms.joint_states.size(), layout.joints.size());
+    return false;
+  }
+  for (std::size_t j = 0; j < layout.joints.size(); ++j)
+  {
+    const JointStateSharedPtr &js = ms.joint_states[j];
+    if (!js || js->joint != layout.joints[j] ||
+        js->position.size() != layout.position_size[j] ||
+        js->velocity.size() != layout.velocity_size[j] ||
+        js->effort.size() != layout.effort_size[j])
+    {
+      CONSOLE_BRIDGE_logError("joint state %zu of model_state [%s] does not match the log layout",
+                              j, ms.name.c_str());
+      return false;
+    }
+  }
+
+  const int64_t time_stamp_ns = toNanoseconds(ms.time_stamp);
+  if (!impl_->checkTime(time_stamp_ns))
+    return false;
+
+  const std::size_t row = impl_->pending;
+  const std::size_t stride = impl_->block_records;
+  double *values = impl_->values.data();
+  for (std::size_t j = 0; j < layout.joints.size(); ++j)
+  {
+    const JointState &js = *ms.joint_states[j];
+    for (std::size_t k = 0; k < js.position.size(); ++k)
+      values[(layout.position_offset[j] + k) * stride + row] = js.position[k];
+    for (std::size_t k = 0; k < js.velocity.size(); ++k)
+      values[(layout.velocity_offset[j] + k) * stride + row] = js.velocity[k];
+    for (std::size_t k = 0; k < js.effort.size(); ++k)
+      values[(layout.effort_offset[j] + k) * stride + row] = js.effort[k];
+  }
+  impl_->times[row] = time_stamp_ns;
+  impl_->last_time = time_stamp_ns;
+
+  ++impl_->records;
+  if (++impl_->pending == impl_->block_records)
+    return impl_->writeBlock();
+  return true;
+}
+
+bool ModelStateLogWriter::append(int64_t time_stamp_ns, const double *values)
+{
+  if (!impl_->file.is_open() || !impl_->checkTime(time_stamp_ns))
+    return false;
+
+  const std::size_t row = impl_->pending;
+  const std::size_t stride = impl_->block_records;
+  for (std::size_t c = 0; c < impl_->layout.columnCount(); ++c)
+    impl_->values[c * stride + row] = values[c];
+  impl_->times[row] = time_stamp_ns;
+  impl_->last_time = time_stamp_ns;
+
+  ++impl_->records;
+  if (++impl_->pending == impl_->block_records)
+    return impl_->writeBlock();
+  return true;
+}
+
+bool ModelStateLogWriter::flush()
+{
+  if (!impl_->file.is_open())
+    return false;
+  if (!impl_->writeBlock())
+    return false;
+  impl_->file.flush();
+  return static_cast<bool>(impl_->file);
+}
+
+void ModelStateLogWriter::close()
+{
+  if (impl_->file.is_open())
+  {
+    flush();
+    impl_->file.close();
+  }
+  impl_->file.clear();
+  impl_->pending = 0;
+  impl_->records = 0;
+}
+
+const ModelStateLogLayout &ModelStateLogWriter::layout() const
+{
+  return impl_->layout;
+}
+
+std::size_t ModelStateLogWriter::recordCount() const
+{
+  return impl_->records;
+}
+
+struct ModelStateLogReader::Impl
+{
+  struct Block
+  {
+    const unsigned char *payload;
+    const unsigned char *end;
+    std::size_t first_record;
+    std::size_t count;
+    int64_t first_time;
+    int64_t last_time;
+  };
+
+  const unsigned char *data = nullptr;
+  std::size_t size = 0;
+#ifdef _WIN32
+  std::vector<unsigned char> contents;
+#endif
+
+  ModelStateLogLayout layout;
+  std::vector<Block> blocks;
+  std::size_t records = 0;
+
+  // decoded copy of the most recently touched block, column major
+  std::size_t cached_block = static_cast<std::size_t>(-1);
+  std::vector<int64_t> times;
+  std::vector<double> values;
+  std::size_t block_capacity = 0;
+
+  bool map(const std::string &path)
+  {
+#ifdef _WIN32
+    std::ifstream file(path.c_str(), std::ios::in | std::ios::binary);
+    if (!file)
+      return false;
+    contents.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    data = contents.data();
+    size = contents.size();
+    return true;
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+      return false;
+    struct stat st;
+    if (::fstat(fd, &st) != 0)
+    {
+      ::close(fd);
+      return false;
+    }
+    size = static_cast<std::size_t>(st.st_size);
+    if (size > 0)
+    {
+      void *addr = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (addr == MAP_FAILED)
+      {
+        ::close(fd);
+        size = 0;
+        return false;
+      }
+      data = static_cast<const unsigned char *>(addr);
+    }
+    ::close(fd);
+    return true;
+#endif
+  }
+
+  void unmap()
+  {
+#ifdef _WIN32
+    contents.clear();
+#else
+    if (data)
+      ::munmap(const_cast<unsigned char *>(data), size);
+#endif
+    data = nullptr;
+    size = 0;
+  }
+
+  bool decode(std::size_t b)
+  {
+    if (cached_block == b)
+      return true;
+    // the buffers are overwritten as the block is decoded, so they hold no
+    // valid block until it succeeds
+    cached_block = static_cast<std::size_t>(-1);
+
+    const Block &block = blocks[b];
+    const std::size_t columns = layout.columnCount();
+    const unsigned char *p = block.payload;
+    uint64_t v;
+
+    int64_t time = block.first_time, delta = 0;
+    for (std::size_t i = 0; i < block.count; ++i)
+    {
+      if (!(p = getVarint(p, block.end, v)))
+        return false;
+      delta += unzigzag(v);
+      time += delta;
+      times[i] = time;
+    }
+    for (std::size_t c = 0; c < columns; ++c)
+    {
+      double *column = values.data() + c * block_capacity;
+      uint64_t previous = 0;
+      for (std::size_t i = 0; i < block.count; ++i)
+      {
+        if (!(p = getXor(p, block.end, v)))
+          return false;
+        previous ^= v;
+        column[i] = bitsDouble(previous);
+      }
+    }
+    cached_block = b;
+    return true;
+  }
+
+  std::size_t findBlock(std::size_t record) const
+  {
+    std::size_t lo = 0, hi = blocks.size();
+    while (hi - lo > 1)
+    {
+      std::size_t mid = lo + (hi - lo) / 2;
+      if (blocks[mid].first_record <= record)
+        lo = mid;
+      else
+        hi = mid;
+    }
+    return lo;
+  }
+};
+
+ModelStateLogReader::ModelStateLogReader()
+  : impl_(new Impl)
+{
+}
+
+ModelStateLogReader::~ModelStateLogReader()
+{
+  close();
+}
+
+bool ModelStateLogReader::open(const std::string &path)
+{
+  close();
+  if (!impl_->map(path))
+  {
+    CONSOLE_BRIDGE_logError(("Could not open model state log " + path).c_str());
+    return false;
+  }
+
+  const unsigned char *p = impl_->data;
+  const unsigned char *end = impl_->data + impl_->size;
+  ModelStateLogLayout &layout = impl_->layout;
+
+  bool ok = impl_->size >= sizeof(FILE_MAGIC) + 4 &&
+            std::memcmp(p, FILE_MAGIC, sizeof(FILE_MAGIC)) == 0;
+  if (ok)
+  {
+    p += sizeof(FILE_MAGIC);
+    impl_->block_capacity = getU32(p);
+    p += 4;
+    ok = impl_->block_capacity > 0 && getString(p, end, layout.model_name) && end - p >= 4;
+  }
+  if (ok)
+  {
+    uint32_t joint_count = getU32(p);
+    p += 4;
+    ModelState prototype;
+    prototype.name = layout.model_name;
+    // every column takes at least a byte per record, a header with more
+    // columns than the file has bytes is damaged (and would not fit in memory)
+    uint64_t columns = 0;
+    for (uint32_t j = 0; ok && j < joint_count; ++j)
+    {
+      JointStateSharedPtr js(new JointState());
+      ok = getString(p, end, js->joint) && end - p >= 12;
+      if (ok)
+      {
+        columns += static_cast<uint64_t>(getU32(p)) + getU32(p + 4) + getU32(p + 8);
+        ok = columns <= impl_->size;
+      }
+      if (ok)
+      {
+        js->position.resize(getU32(p));
+        js->velocity.resize(getU32(p + 4));
+        js->effort.resize(getU32(p + 8));
+        p += 12;
+        prototype.joint_states.push_back(js);
+      }
+    }
+    if (ok)
+      layout.init(prototype);
+  }
+  if (!ok)
+  {
+    CONSOLE_BRIDGE_logError(("File " + path + " is not a model state log").c_str());
+    close();
+    return false;
+  }
+
+  // index the blocks; a truncated trailing block is dropped.  A record takes
+  // at least one byte per time stamp and column, which bounds the record
+  // count of a block by its payload, and the buffers are sized for the
+  // largest block in the file rather than the capacity the header claims.
+  const uint64_t record_size = 1 + static_cast<uint64_t>(layout.columnCount());
+  std::size_t largest = 0;
+  while (static_cast<std::size_t>(end - p) >= BLOCK_HEADER_SIZE)
+  {
+    Impl::Block block;
+    uint64_t payload = getU64(p + 8);
+    block.count = getU32(p + 4);
+    if (getU32(p) != BLOCK_MAGIC || block.count == 0 || block.count > impl_->block_capacity ||
+        payload > static_cast<uint64_t>(end - p) - BLOCK_HEADER_SIZE ||
+        payload / record_size < block.count)
+    {
+      CONSOLE_BRIDGE_logWarn("Model state log %s has a damaged block after record %zu, ignoring the rest",
+                             path.c_str(), impl_->records);
+      break;
+    }
+    block.first_time = static_cast<int64_t>(getU64(p + 16));
+    block.last_time = static_cast<int64_t>(getU64(p + 24));
+    block.payload = p + BLOCK_HEADER_SIZE;
+    block.end = block.payload + payload;
+    block.first_record = impl_->records;
+    impl_->blocks.push_back(block);
+    impl_->records += block.count;
+    largest = std::max<std::size_t>(largest, block.count);
+    p = block.end;
+  }
+
+  impl_->block_capacity = largest;
+  impl_->times.assign(impl_->block_capacity, 0);
+  impl_->values.assign(impl_->block_capacity * layout.columnCount(), 0.0);
+  return true;
+}
+
+void ModelStateLogReader::close()
+{
+  impl_->unmap();
+  impl_->layout.clear();
+  impl_->blocks.clear();
+  impl_->records = 0;
+  impl_->cached_block = static_cast<std::size_t>(-1);
+}
+
+const ModelStateLogLayout &ModelStateLogReader::layout() const
+{
+  return impl_->layout;
+}
+
+std::size_t ModelStateLogReader::recordCount() const
+{
+  return impl_->records;
+}
+
+int64_t ModelStateLogReader::startTime() const
+{
+  return impl_->blocks.empty() ? 0 : impl_->blocks.front().first_time;
+}
+
+int64_t ModelStateLogReader::endTime() const
+{
+  return impl_->blocks.empty() ? 0 : impl_->blocks.back().last_time;
+}
+
+std::size_t ModelStateLogReader::seek(int64_t time_stamp_ns) const
+{
+  const std::vector<Impl::Block> &blocks = impl_->blocks;
+  std::vector<Impl::Block>::const_iterator block = std::lower_bound(
+    blocks.begin(), blocks.end(), time_stamp_ns,
+    [](const Impl::Block &b, int64_t t) { return b.last_time < t; });
+  if (block == blocks.end())
+    return impl_->records;
+
+  // time stamps are the only thing decoded, so this stays cheap
+  const unsigned char *p = block->payload;
+  int64_t time = block->first_time, delta = 0;
+  uint64_t v;
+  for (std::size_t i = 0; i < block->count; ++i)
+  {
+    if (!(p = getVarint(p, block->end, v)))
+      break;
+    delta += unzigzag(v);
+    time += delta;
+    if (time >= time_stamp_ns)
+      return block->first_record + i;
+  }
+  return block->first_record + block->count;
+}
+
+std::size_t ModelStateLogReader::read(std::size_t first, std::size_t count, int64_t *time_stamps_ns, double *values)
+{
+  if (first >= impl_->records)
+    return 0;
+  count = std::min(count, impl_->records - first);
+
+  const std::size_t columns = impl_->layout.columnCount();
+  std::size_t done = 0;
+  std::size_t b = impl_->findBlock(first);
+  while (done < count)
+  {
+    if (!impl_->decode(b))
+    {
+      CONSOLE_BRIDGE_logError("Model state log block %zu is corrupt", b);
+      break;
+    }
+    const Impl::Block &block = impl_->blocks[b];
+    std::size_t offset = first + done - block.first_record;
+    std::size_t n = std::min(block.count - offset, count - done);
+    if (time_stamps_ns)
+      std::copy(impl_->times.begin() + offset, impl_->times.begin() + offset + n, time_stamps_ns + done);
+    if (values)
+    {
+      for (std::size_t c = 0; c < columns; ++c)
+      {
+        const double *column = impl_->values.data() + c * impl_->block_capacity + offset;
+        std::copy(column, column + n, values + c * count + done);
+      }
+    }
+    done += n;
+    ++b;
+  }
+  return done;
+}
+
+bool ModelStateLogReader::read(std::size_t index, ModelState &ms)
+{
+  if (index >= impl_->records)
+    return false;
+  std::size_t b = impl_->findBlock(index);
+  if (!impl_->decode(b))
+  {
+    CONSOLE_BRIDGE_logError("Model state log block %zu is corrupt", b);
+    return false;
+  }
+  const std::size_t row = index - impl_->blocks[b].first_record;
+  const std::size_t stride = impl_->block_capacity;
+  const ModelStateLogLayout &layout = impl_->layout;
+  const double *values = impl_->values.data();
+
+  ms.name = layout.model_name;
+  fromNanoseconds(impl_->times[row], ms.time_stamp);
+  ms.joint_states.resize(layout.joints.size());
+  for (std::size_t j = 0; j < layout.joints.size(); ++j)
+  {
+    if (!ms.joint_states[j])
+      ms.joint_states[j].reset(new JointState());
+    JointState &js = *ms.joint_states[j];
+    js.joint = layout.joints[j];
+    js.position.resize(layout.position_size[j]);
+    js.velocity.resize(layout.velocity_size[j]);
+    js.effort.resize(layout.effort_size[j]);
+    for (std::size_t k = 0; k < js.position.size(); ++k)
+      js.position[k] = values[(layout.position_offset[j] + k) * stride + row];
+    for (std::size_t k = 0; k < js.velocity.size(); ++k)
+      js.velocity[k] = values[(layout.velocity_offset[j] + k) * stride + row];
+    for (std::size_t k = 0; k < js.effort.size(); ++k)
+      js.effort[k] = values[(layout.effort_offset[j] + k) * stride + row];
+  }
+  return true;
+}
+
+}
@@ -0,0 +1,255 @@
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <urdf_exception/exception.h>
+#include <tinyxml2.h>
+#include <console_bridge/console.h>
+
+#include <urdf_parser/model_state_reader.h>
+
+#include "./model_state.hpp"
+
+namespace urdf{
+
+namespace {
+
+const std::size_t CHUNK_SIZE = 1 << 20;
+const char START_TAG[] = "<model_state";
+const char END_TAG[] = "</model_state>";
+
+}
+
+struct ModelStateReader::Impl
+{
+  std::ifstream file;
+  std::istream *stream = nullptr;
+  std::string buffer;
+  // start of the unconsumed part of buffer
+  std::size_t cursor = 0;
+  std::size_t records = 0;
+  bool failed = false;
+  tinyxml2::XMLDocument doc;
+
+  void reset(std::istream *s)
+  {
+    stream = s;
+    buffer.clear();
+    cursor = 0;
+    records = 0;
+    failed = false;
+  }
+
+  // Drops the consumed prefix of the buffer and appends the next chunk of
+  // input.  Returns false once the input is exhausted.
+  bool refill()
+  {
+    if (!stream || !*stream)
+      return false;
+
+    buffer.erase(0, cursor);
+    cursor = 0;
+
+    std::size_t old_size = buffer.size();
+    buffer.resize(old_size + CHUNK_SIZE);
+    stream->read(&buffer[old_size], CHUNK_SIZE);
+    std::size_t got = static_cast<std::size_t>(stream->gcount());
+    buffer.resize(old_size + got);
+    return got > 0;
+  }
+
+  // Finds the bounds [begin, end) of the next <model_state> element, pulling
+  // in more input as needed.  Offsets are relative to buffer.
+  bool findRecord(std::size_t &begin, std::size_t &end)
+  {
+    const std::size_t start_len = sizeof(START_TAG) - 1;
+    const std::size_t end_len = sizeof(END_TAG) - 1;
+
+    std::size_t pos = cursor;
+    while (true)
+    {
+      pos = buffer.find('<', pos);
+      if (pos == std::string::npos)
+      {
+        cursor = buffer.size();
+        if (!refill())
+          return false;
+        pos = cursor;
+        continue;
+      }
+      // make sure the whole tag name (or comment opener) is in the buffer
+      if (buffer.size() - pos < start_len + 1)
+      {
+        cursor = pos;
+        if (!refill())
+          return false;
+        pos = cursor;
+        continue;
+      }
+      if (buffer.compare(pos, 4, "<!--") == 0)
+      {
+        std::size_t close = buffer.find("-->", pos + 4);
+        while (close == std::string::npos)
+        {
+          cursor = pos;
+          std::size_t scanned = buffer.size() - pos;
+          if (!refill())
+            return false;
+          pos = cursor;
+          close = buffer.find("-->", pos + (scanned > 2 ? scanned - 2 : 0));
+        }
+        pos = close + 3;
+        continue;
+      }
+      char after = buffer[pos + start_len];
+      if (buffer.compare(pos, start_len, START_TAG) == 0 &&
+          (after == ' ' || after == '\t' || after == '\n' || after == '\r' || after == '>' || after == '/'))
+      {
+        break;
+      }
+      ++pos;
+    }
+
+    begin = pos;
+    cursor = pos;
+
+    // find the end of the start tag, skipping quoted attribute values
+    std::size_t p = begin + start_len;
+    char quote = 0;
+    while (true)
+    {
+      if (p >= buffer.size())
+      {
+        if (!refill())
+          return false;
+        // refill() moved the record to the front of the buffer
+        p -= begin;
+        begin = 0;
+        continue;
+      }
+      char c = buffer[p];
+      if (quote)
+      {
+        if (c == quote)
+          quote = 0;
+      }
+      else if (c == '"' || c == '\'')
+        quote = c;
+      else if (c == '>')
+        break;
+      ++p;
+    }
+    if (buffer[p - 1] == '/')
+    {
+      end = p + 1;
+      return true;
+    }
+
+    std::size_t close = buffer.find(END_TAG, p);
+    while (close == std::string::npos)
+    {
+      std::size_t scanned = buffer.size() - begin;
+      if (!refill())
+        return false;
+      begin = 0;
+      close = buffer.find(END_TAG, scanned > end_len ? scanned - end_len : 0);
+    }
+    end = close + end_len;
+    return true;
+  }
+};
+
+ModelStateReader::ModelStateReader()
+  : impl_(new Impl)
+{
+}
+
+ModelStateReader::~ModelStateReader()
+{
+}
+
+bool ModelStateReader::open(const std::string &path)
+{
+  close();
+  impl_->file.open(path.c_str(), std::ios::in | std::ios::binary);
+  if (!impl_->file)
+  {
+    CONSOLE_BRIDGE_logError(("File " + path + " does not exist").c_str());
+    impl_->failed = true;
+    return false;
+  }
+  impl_->reset(&impl_->file);
+  return true;
+}
+
+void ModelStateReader::open(std::istream &stream)
+{
+  close();
+  impl_->reset(&stream);
+}
+
+void ModelStateReader::close()
+{
+  if (impl_->file.is_open())
+    impl_->file.close();
+  impl_->file.clear();
+  impl_->reset(nullptr);
+}
+
+bool ModelStateReader::next(ModelState &ms)
+{
+  if (impl_->failed || !impl_->stream)
+    return false;
+
+  std::size_t begin = 0, end = 0;
+  if (!impl_->findRecord(begin, end))
+  {
+    if (impl_->cursor < impl_->buffer.size() &&
+        impl_->buffer.compare(impl_->cursor, sizeof(START_TAG) - 1, START_TAG) == 0)
+    {
+      CONSOLE_BRIDGE_logError("Truncated model_state record at end of input");
+      impl_->failed = true;
+    }
+    return false;
+  }
+  impl_->cursor = end;
+
+  impl_->doc.Parse(impl_->buffer.data() + begin, end - begin);
+  if (impl_->doc.Error())
+  {
+    CONSOLE_BRIDGE_logError(impl_->doc.ErrorStr());
+    impl_->doc.ClearError();
+    impl_->failed = true;
+    return false;
+  }
+
+  try
+  {
+    if (!parseModelStateInternal(ms, impl_->doc.FirstChildElement("model_state")))
+    {
+      impl_->failed = true;
+      return false;
+    }
+  }
+  catch (ParseError &e)
+  {
+    CONSOLE_BRIDGE_logError("Failed to parse model_state record %zu: %s", impl_->records, e.what());
+    impl_->failed = true;
+    return false;
+  }
+
+  ++impl_->records;
+  return true;
+}
+
+bool ModelStateReader::failed() const
+{
+  return impl_->failed;
+}
+
+std::size_t ModelStateReader::recordCount() const
+{
+  return impl_->records;
+}
+
+}
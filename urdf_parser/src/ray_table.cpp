@@ -0,0 +1,136 @@
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include <console_bridge/console.h>
+
+#include <urdf_parser/ray_table.h>
+
+namespace urdf{
+
+// stride_ is rounded up to whole 64 byte lines
+static const std::size_t DOUBLES_PER_LINE = 8;
+
+static bool sampleAngles(unsigned int samples, double resolution, double min_angle, double max_angle,
+                         const char *direction, std::vector<double> &cosines, std::vector<double> &sines)
+{
+  if (samples == 0)
+  {
+    CONSOLE_BRIDGE_logError("Ray %s samples must be at least 1", direction);
+    return false;
+  }
+  if (!(resolution > 0.0) || !std::isfinite(resolution))
+  {
+    CONSOLE_BRIDGE_logError("Ray %s resolution [%f] must be positive", direction, resolution);
+    return false;
+  }
+  if (!(min_angle <= max_angle))
+  {
+    CONSOLE_BRIDGE_logError("Ray %s min_angle [%f] is larger than max_angle [%f]", direction, min_angle, max_angle);
+    return false;
+  }
+
+  // as in SDF, the sensor returns samples * resolution ranges
+  const std::size_t count = std::max<std::size_t>(1, static_cast<std::size_t>(std::lround(samples * resolution)));
+  cosines.resize(count);
+  sines.resize(count);
+  const double step = count > 1 ? (max_angle - min_angle) / (count - 1) : 0.0;
+  for (std::size_t i = 0; i < count; ++i)
+  {
+    const double angle = min_angle + i * step;
+    cosines[i] = std::cos(angle);
+    sines[i] = std::sin(angle);
+  }
+  return true;
+}
+
+void RayTable::clear()
+{
+  horizontal_count_ = 0;
+  vertical_count_ = 0;
+  stride_ = 0;
+  directions_.clear();
+  origin_.clear();
+}
+
+bool RayTable::init(const Ray &ray, const Pose &origin)
+{
+  this->clear();
+
+  std::vector<double> cos_yaw, sin_yaw, cos_pitch, sin_pitch;
+  if (!sampleAngles(ray.horizontal_samples, ray.horizontal_resolution, ray.horizontal_min_angle,
+                    ray.horizontal_max_angle, "horizontal", cos_yaw, sin_yaw) ||
+      !sampleAngles(ray.vertical_samples, ray.vertical_resolution, ray.vertical_min_angle,
+                    ray.vertical_max_angle, "vertical", cos_pitch, sin_pitch))
+    return false;
+
+  horizontal_count_ = cos_yaw.size();
+  vertical_count_ = cos_pitch.size();
+  const std::size_t n = this->size();
+  stride_ = (n + DOUBLES_PER_LINE - 1) / DOUBLES_PER_LINE * DOUBLES_PER_LINE;
+  directions_.assign(6 * stride_, 0.0);
+  origin_ = origin.position;
+
+  double *sx = directions_.data();
+  double *sy = sx + stride_;
+  double *sz = sy + stride_;
+  for (std::size_t v = 0; v < vertical_count_; ++v)
+  {
+    for (std::size_t h = 0; h < horizontal_count_; ++h)
+    {
+      const std::size_t i = v * horizontal_count_ + h;
+      sx[i] = cos_pitch[v] * cos_yaw[h];
+      sy[i] = cos_pitch[v] * sin_yaw[h];
+      sz[i] = sin_pitch[v];
+    }
+  }
+
+  double *lx = sz + stride_;
+  double *ly = lx + stride_;
+  double *lz = ly + stride_;
+  for (std::size_t i = 0; i < n; ++i)
+  {
+    const Vector3 d = origin.rotation * Vector3(sx[i], sy[i], sz[i]);
+    lx[i] = d.x;
+    ly[i] = d.y;
+    lz[i] = d.z;
+  }
+  return true;
+}
+
+bool RayTable::init(const Sensor &sensor)
+{
+  const Ray *ray = dynamic_cast<const Ray *>(sensor.sensor.get());
+  if (!ray)
+  {
+    CONSOLE_BRIDGE_logError("Sensor [%s] is not a ray sensor", sensor.name.c_str());
+    this->clear();
+    return false;
+  }
+  return this->init(*ray, sensor.origin);
+}
+
+void RayTable::toPoints(const double *ranges, double *x, double *y, double *z, Frame frame) const
+{
+  this->toPoints(0, this->size(), ranges, x, y, z, frame);
+}
+
+void RayTable::toPoints(std::size_t first, std::size_t count, const double *ranges,
+                        double *x, double *y, double *z, Frame frame) const
+{
+  const double *dx = this->directionX(frame) + first;
+  const double *dy = this->directionY(frame) + first;
+  const double *dz = this->directionZ(frame) + first;
+  const double ox = frame == LINK_FRAME ? origin_.x : 0.0;
+  const double oy = frame == LINK_FRAME ? origin_.y : 0.0;
+  const double oz = frame == LINK_FRAME ? origin_.z : 0.0;
+
+  // three independent streams keep the loops simple enough to vectorize
+  for (std::size_t i = 0; i < count; ++i)
+    x[i] = ox + ranges[i] * dx[i];
+  for (std::size_t i = 0; i < count; ++i)
+    y[i] = oy + ranges[i] * dy[i];
+  for (std::size_t i = 0; i < count; ++i)
+    z[i] = oz + ranges[i] * dz[i];
+}
+
+}
@@ -0,0 +1,162 @@
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <console_bridge/console.h>
+
+#include <urdf_parser/dynamics.h>
+
+#include "./spatial.hpp"
+
+namespace urdf{
+
+static void toParameters(const SpatialInertia &I, double *pi)
+{
+  pi[0] = I.mass;
+  for (int k = 0; k < 3; ++k)
+    pi[1 + k] = I.h[k];
+  for (int k = 0; k < 6; ++k)
+    pi[4 + k] = I.I[k];
+}
+
+static void fromParameters(const double *pi, SpatialInertia &I)
+{
+  I.mass = pi[0];
+  for (int k = 0; k < 3; ++k)
+    I.h[k] = pi[1 + k];
+  for (int k = 0; k < 6; ++k)
+    I.I[k] = pi[4 + k];
+}
+
+void DynamicsModel::inertialParameters(double *pi) const
+{
+  for (std::size_t i = 0; i < inertias_.size(); ++i)
+    toParameters(inertias_[i], pi + 10 * i);
+}
+
+void DynamicsModel::setInertialParameters(const double *pi)
+{
+  const std::size_t bodies = inertias_.size();
+  for (std::size_t i = 0; i < bodies; ++i)
+  {
+    fromParameters(pi + 10 * i, inertias_[i]);
+    subtree_mass_[i] = inertias_[i].mass;
+  }
+  for (std::size_t i = bodies; i-- > 1;)
+    subtree_mass_[kinematics_.body(i).parent] += subtree_mass_[i];
+}
+
+bool DynamicsModel::writeInertialParameters(const double *pi, ModelInterface &model) const
+{
+  const std::size_t bodies = inertias_.size();
+  for (std::size_t i = 0; i < bodies; ++i)
+  {
+    const double *p = pi + 10 * i;
+    bool zero = true;
+    for (int k = 0; k < 10; ++k)
+      zero = zero && p[k] == 0.0;
+    if (!zero && !(p[0] > 0.0))
+    {
+      CONSOLE_BRIDGE_logError("Link [%s] has inertial parameters but no positive mass",
+                              kinematics_.linkName(i).c_str());
+      return false;
+    }
+  }
+
+  for (std::size_t i = 0; i < bodies; ++i)
+  {
+    LinkSharedPtr link;
+    model.getLink(kinematics_.linkName(i), link);
+    if (!link)
+      continue;
+    const double *p = pi + 10 * i;
+    if (p[0] == 0.0)
+    {
+      link->inertial.reset();
+      continue;
+    }
+    if (!link->inertial)
+      link->inertial.reset(new Inertial());
+    SpatialInertia I;
+    fromParameters(p, I);
+    spatialToInertial(I, *link->inertial);
+  }
+  return true;
+}
+
+void DynamicsModel::regressor(DynamicsData &data, const double *q, const double *v, const double *a,
+                              double *Y) const
+{
+  const std::size_t bodies = order_.size(), nv = kinematics_.velocitySize(), columns = 10 * bodies;
+  std::fill(Y, Y + nv * columns, 0.0);
+  if (bodies == 0)
+    return;
+
+  this->motionPass(data, q, v, a);
+
+  // the force of each parameter of body i, f = I a + v x* I v for a unit
+  // parameter, carried to the root and projected on the joints it meets
+  for (std::size_t s = 1; s < bodies; ++s)
+  {
+    const std::size_t i = order_[s];
+    const double *vi = &data.velocity[6 * s], *ai = &data.acceleration[6 * s];
+    double F[60];
+    for (int p = 0; p < 10; ++p)
+    {
+      double unit[10] = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+      unit[p] = 1.0;
+      SpatialInertia I;
+      fromParameters(unit, I);
+      double Iv[6], bias[6];
+      applyInertia(I, ai, F + 6 * p);
+      applyInertia(I, vi, Iv);
+      crossForce(vi, Iv, bias);
+      for (int c = 0; c < 6; ++c)
+        F[6 * p + c] += bias[c];
+    }
+    for (std::size_t j = s; j > 0;)
+    {
+      const KinematicModel::Body &body = kinematics_.body(order_[j]);
+      for (std::size_t k = 0; k < body.v_size; ++k)
+      {
+        const double *S = &subspace_[6 * (body.v_offset + k)];
+        double *row = Y + (body.v_offset + k) * columns + 10 * i;
+        for (int p = 0; p < 10; ++p)
+          row[p] = dot6(S, F + 6 * p);
+      }
+      for (int p = 0; p < 10; ++p)
+      {
+        double f[6];
+        forceToParent(data.local[j], F + 6 * p, f);
+        std::copy(f, f + 6, F + 6 * p);
+      }
+      j = slot_[body.parent];
+    }
+  }
+}
+
+void DynamicsModel::regressors(std::size_t count, const double *q, const double *v, const double *a, double *Y,
+                               unsigned int threads) const
+{
+  const std::size_t nq = kinematics_.positionSize(), nv = kinematics_.velocitySize();
+  const std::size_t size = nv * 10 * order_.size();
+  std::size_t workers = threads ? threads : std::thread::hardware_concurrency();
+  workers = std::max<std::size_t>(1, std::min<std::size_t>(workers, count));
+
+  // every worker owns its work space and writes only the samples it claims
+  std::atomic<std::size_t> next(0);
+  auto run = [&]()
+  {
+    DynamicsData data(*this);
+    for (std::size_t n = next++; n < count; n = next++)
+      this->regressor(data, q + n * nq, v + n * nv, a + n * nv, Y + n * size);
+  };
+  std::vector<std::thread> pool;
+  for (std::size_t w = 1; w < workers; ++w)
+    pool.push_back(std::thread(run));
+  run();
+  for (std::size_t w = 0; w < pool.size(); ++w)
+    pool[w].join();
+}
+
+}
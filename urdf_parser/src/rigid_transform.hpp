@@ -0,0 +1,154 @@
+#ifndef URDF_PARSER_RIGID_TRANSFORM_HPP
+#define URDF_PARSER_RIGID_TRANSFORM_HPP
+
+#include <cmath>
+
+#include <urdf_parser/kinematics.h>
+
+namespace urdf {
+
+// out = a * b for row-major 3x3 matrices; out may not alias a or b
+inline void mul33(const double *a, const double *b, double *out)
+{
+  for (int r = 0; r < 3; ++r)
+  {
+    out[3 * r + 0] = a[3 * r] * b[0] + a[3 * r + 1] * b[3] + a[3 * r + 2] * b[6];
+    out[3 * r + 1] = a[3 * r] * b[1] + a[3 * r + 1] * b[4] + a[3 * r + 2] * b[7];
+    out[3 * r + 2] = a[3 * r] * b[2] + a[3 * r + 1] * b[5] + a[3 * r + 2] * b[8];
+  }
+}
+
+// out = R v
+inline void rotate(const double *R, const double *v, double *out)
+{
+  const double x = v[0], y = v[1], z = v[2];
+  out[0] = R[0] * x + R[1] * y + R[2] * z;
+  out[1] = R[3] * x + R[4] * y + R[5] * z;
+  out[2] = R[6] * x + R[7] * y + R[8] * z;
+}
+
+// out = R^T v
+inline void rotateTransposed(const double *R, const double *v, double *out)
+{
+  const double x = v[0], y = v[1], z = v[2];
+  out[0] = R[0] * x + R[3] * y + R[6] * z;
+  out[1] = R[1] * x + R[4] * y + R[7] * z;
+  out[2] = R[2] * x + R[5] * y + R[8] * z;
+}
+
+inline void cross(const double *a, const double *b, double *out)
+{
+  const double x = a[1] * b[2] - a[2] * b[1];
+  const double y = a[2] * b[0] - a[0] * b[2];
+  const double z = a[0] * b[1] - a[1] * b[0];
+  out[0] = x;
+  out[1] = y;
+  out[2] = z;
+}
+
+inline double dot(const double *a, const double *b)
+{
+  return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+// out = a * b; out may not alias a or b
+inline void compose(const RigidTransform &a, const RigidTransform &b, RigidTransform &out)
+{
+  mul33(a.R, b.R, out.R);
+  rotate(a.R, b.p, out.p);
+  out.p[0] += a.p[0];
+  out.p[1] += a.p[1];
+  out.p[2] += a.p[2];
+}
+
+inline void invert(const RigidTransform &a, RigidTransform &out)
+{
+  out.R[0] = a.R[0]; out.R[1] = a.R[3]; out.R[2] = a.R[6];
+  out.R[3] = a.R[1]; out.R[4] = a.R[4]; out.R[5] = a.R[7];
+  out.R[6] = a.R[2]; out.R[7] = a.R[5]; out.R[8] = a.R[8];
+  rotate(out.R, a.p, out.p);
+  out.p[0] = -out.p[0];
+  out.p[1] = -out.p[1];
+  out.p[2] = -out.p[2];
+}
+
+// rotation matrix of the quaternion (x, y, z, w), which is normalized first
+inline void quaternionToMatrix(double x, double y, double z, double w, double *R)
+{
+  const double n = x * x + y * y + z * z + w * w;
+  const double s = n > 0.0 ? 2.0 / n : 0.0;
+  const double xx = s * x * x, yy = s * y * y, zz = s * z * z;
+  const double xy = s * x * y, xz = s * x * z, yz = s * y * z;
+  const double wx = s * w * x, wy = s * w * y, wz = s * w * z;
+  R[0] = 1.0 - yy - zz; R[1] = xy - wz;       R[2] = xz + wy;
+  R[3] = xy + wz;       R[4] = 1.0 - xx - zz; R[5] = yz - wx;
+  R[6] = xz - wy;       R[7] = yz + wx;       R[8] = 1.0 - xx - yy;
+}
+
+inline void poseToTransform(const Pose &pose, RigidTransform &transform)
+{
+  const Rotation &r = pose.rotation;
+  quaternionToMatrix(r.x, r.y, r.z, r.w, transform.R);
+  transform.p[0] = pose.position.x;
+  transform.p[1] = pose.position.y;
+  transform.p[2] = pose.position.z;
+}
+
+// unit vectors u and w spanning the plane normal to the unit axis a, with
+// (u, w, a) right handed: u is the coordinate axis with the smallest
+// component along a, made orthogonal to it
+inline void planeBasis(const double *a, double *u, double *w)
+{
+  int k = std::fabs(a[1]) < std::fabs(a[0]) ? 1 : 0;
+  if (std::fabs(a[2]) < std::fabs(a[k]))
+    k = 2;
+  for (int j = 0; j < 3; ++j)
+    u[j] = (j == k ? 1.0 : 0.0) - a[k] * a[j];
+  const double n = std::sqrt(dot(u, u));
+  for (int j = 0; j < 3; ++j)
+    u[j] /= n;
+  cross(a, u, w);
+}
+
+// rotation by angle about the unit axis a
+inline void axisAngleToMatrix(const double *a, double angle, double *R)
+{
+  const double c = std::cos(angle), s = std::sin(angle), t = 1.0 - c;
+  R[0] = c + t * a[0] * a[0];        R[1] = t * a[0] * a[1] - s * a[2]; R[2] = t * a[0] * a[2] + s * a[1];
+  R[3] = t * a[0] * a[1] + s * a[2]; R[4] = c + t * a[1] * a[1];        R[5] = t * a[1] * a[2] - s * a[0];
+  R[6] = t * a[0] * a[2] - s * a[1]; R[7] = t * a[1] * a[2] + s * a[0]; R[8] = c + t * a[2] * a[2];
+}
+
+// Motion subspace of the joint of body: for each of its body.v_size
+// velocity coordinates the spatial velocity (angular, linear) of the child
+// frame it produces, in the child frame, written to S[6 k .. 6 k + 5].
+inline void jointSubspace(const KinematicModel::Body &body, double *S)
+{
+  for (std::size_t k = 0; k < 6 * body.v_size; ++k)
+    S[k] = 0.0;
+  switch (body.type)
+  {
+    case Joint::REVOLUTE:
+    case Joint::CONTINUOUS:
+      S[0] = body.axis[0]; S[1] = body.axis[1]; S[2] = body.axis[2];
+      break;
+    case Joint::PRISMATIC:
+      S[3] = body.axis[0]; S[4] = body.axis[1]; S[5] = body.axis[2];
+      break;
+    case Joint::PLANAR:
+      S[3] = body.plane_u[0]; S[4] = body.plane_u[1]; S[5] = body.plane_u[2];
+      S[9] = body.plane_w[0]; S[10] = body.plane_w[1]; S[11] = body.plane_w[2];
+      S[12] = body.axis[0]; S[13] = body.axis[1]; S[14] = body.axis[2];
+      break;
+    case Joint::FLOATING:
+      for (int k = 0; k < 6; ++k)
+        S[7 * k] = 1.0;
+      break;
+    default:
+      break;
+  }
+}
+
+}
+
+#endif
@@ -0,0 +1,91 @@
+#include <string>
+#include <vector>
+#include <console_bridge/console.h>
+
+#include <urdf_parser/sensor_table.h>
+
+namespace urdf{
+
+void SensorTable::clear()
+{
+  sensors_.clear();
+  sensor_link_.clear();
+  links_.clear();
+  link_offset_.assign(1, 0);
+  link_index_.clear();
+  sensor_index_.clear();
+}
+
+bool SensorTable::init(const ModelInterface &model, const std::vector<SensorSharedPtr> &sensors)
+{
+  this->clear();
+
+  links_.reserve(model.links_.size());
+  for (std::map<std::string, LinkSharedPtr>::const_iterator l = model.links_.begin(); l != model.links_.end(); ++l)
+  {
+    link_index_[l->first] = links_.size();
+    links_.push_back(l->first);
+  }
+
+  // counting sort of the sensors by parent link, stable in document order
+  std::vector<std::size_t> sensor_link(sensors.size());
+  link_offset_.assign(links_.size() + 1, 0);
+  for (std::size_t i = 0; i < sensors.size(); ++i)
+  {
+    const Sensor &s = *sensors[i];
+    if (!s.sensor)
+    {
+      CONSOLE_BRIDGE_logError("Sensor [%s] has no camera or ray description", s.name.c_str());
+      this->clear();
+      return false;
+    }
+    std::unordered_map<std::string, std::size_t>::const_iterator l = link_index_.find(s.parent_link_name);
+    if (l == link_index_.end())
+    {
+      CONSOLE_BRIDGE_logError("Sensor [%s] is mounted on link [%s], which is not part of model [%s]",
+                              s.name.c_str(), s.parent_link_name.c_str(), model.getName().c_str());
+      this->clear();
+      return false;
+    }
+    if (!sensor_index_.insert(std::make_pair(s.name, i)).second)
+    {
+      CONSOLE_BRIDGE_logError("Sensor [%s] is not unique", s.name.c_str());
+      this->clear();
+      return false;
+    }
+    sensor_link[i] = l->second;
+    ++link_offset_[l->second + 1];
+  }
+  for (std::size_t l = 0; l < links_.size(); ++l)
+    link_offset_[l + 1] += link_offset_[l];
+
+  std::vector<std::size_t> slot(link_offset_.begin(), link_offset_.end() - 1);
+  sensors_.resize(sensors.size());
+  sensor_link_.resize(sensors.size());
+  for (std::size_t i = 0; i < sensors.size(); ++i)
+  {
+    const std::size_t k = slot[sensor_link[i]]++;
+    sensors_[k] = *sensors[i];
+    sensor_link_[k] = sensor_link[i];
+    sensor_index_[sensors[i]->name] = k;
+  }
+  return true;
+}
+
+const Sensor *SensorTable::findSensor(const std::string &name) const
+{
+  std::unordered_map<std::string, std::size_t>::const_iterator s = sensor_index_.find(name);
+  if (s == sensor_index_.end())
+    return nullptr;
+  return &sensors_[s->second];
+}
+
+std::size_t SensorTable::linkIndex(const std::string &name) const
+{
+  std::unordered_map<std::string, std::size_t>::const_iterator l = link_index_.find(name);
+  if (l == link_index_.end())
+    return links_.size();
+  return l->second;
+}
+
+}
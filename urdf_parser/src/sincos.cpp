@@ -0,0 +1,93 @@
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#include "./sincos.hpp"
+#include "./target_clones.hpp"
+
+namespace urdf {
+
+// Sine and cosine of joint angles without a libm call.
+//
+// The argument is reduced to [-pi/4, pi/4] with a three part Cody-Waite
+// split of pi/4 and the Cephes minimax polynomials are evaluated on the
+// remainder, which is accurate to about one ulp.  The reduction is exact
+// only for moderate arguments; beyond REDUCTION_LIMIT the libm functions
+// are used.
+
+static const double REDUCTION_LIMIT = 8192.0;
+
+static inline std::uint64_t toBits(double x)
+{
+  std::uint64_t bits;
+  std::memcpy(&bits, &x, sizeof(bits));
+  return bits;
+}
+
+static inline double fromBits(std::uint64_t bits)
+{
+  double x;
+  std::memcpy(&x, &bits, sizeof(x));
+  return x;
+}
+
+// Straight-line code only, so that the loop calling it vectorizes: the
+// quadrant selects and sign flips are integer masks, not branches.
+static inline void sinCosReduced(double x, double &s, double &c)
+{
+  static const double FOUR_OVER_PI = 1.27323954473516268615;
+  static const double DP1 = 7.85398125648498535156E-1;
+  static const double DP2 = 3.77489470793079817668E-8;
+  static const double DP3 = 2.69515142907905952645E-15;
+  static const std::uint64_t SIGN = 0x8000000000000000ULL;
+
+  // octant rounded up to an even number, and the quadrant it starts; the
+  // truncation is a floor since ax >= 0.  Large and NaN arguments are
+  // masked to zero so the conversion stays in range; the caller redoes them
+  const std::uint64_t xbits = toBits(x);
+  const double abs_x = fromBits(xbits & ~SIGN);
+  const std::uint64_t in_range = -static_cast<std::uint64_t>(abs_x <= REDUCTION_LIMIT);
+  const double ax = fromBits(toBits(abs_x) & in_range);
+  int j = static_cast<int>(ax * FOUR_OVER_PI);
+  j += j & 1;
+  const std::int64_t quadrant = (j >> 1) & 3;
+  const double y = j;
+
+  const double z = ((ax - y * DP1) - y * DP2) - y * DP3;
+  const double zz = z * z;
+  const double ps = z + z * zz * (((((1.58962301576546568060E-10 * zz - 2.50507477628578072866E-8) * zz +
+                                     2.75573136213857245213E-6) * zz - 1.98412698295895385996E-4) * zz +
+                                   8.33333333332211858878E-3) * zz - 1.66666666666666307295E-1);
+  const double pc = 1.0 - 0.5 * zz + zz * zz * (((((-1.13585365213876817300E-11 * zz + 2.08757008419747316778E-9) * zz -
+                                                   2.75573141792967388112E-7) * zz + 2.48015872888517045348E-5) * zz -
+                                                 1.38888888888730564116E-3) * zz + 4.16666666666665929218E-2);
+
+  // sin and cos of quadrant * pi / 2 + z: odd quadrants swap the series,
+  // quadrants 2 and 3 negate the sine (and so does a negative x), quadrants
+  // 1 and 2 negate the cosine
+  const std::uint64_t swap = -static_cast<std::uint64_t>(quadrant & 1);
+  const std::uint64_t bs = toBits(ps), bc = toBits(pc);
+  const std::uint64_t sa = (bc & swap) | (bs & ~swap), ca = (bs & swap) | (bc & ~swap);
+  const std::uint64_t sin_sign = (static_cast<std::uint64_t>(quadrant >> 1) << 63) ^ (xbits & SIGN);
+  const std::uint64_t cos_sign = static_cast<std::uint64_t>((quadrant ^ (quadrant >> 1)) & 1) << 63;
+  s = fromBits(sa ^ sin_sign);
+  c = fromBits(ca ^ cos_sign);
+}
+
+URDFDOM_TARGET_CLONES
+void sinCosLanes(std::size_t n, const double *__restrict x, double *__restrict s, double *__restrict c)
+{
+  for (std::size_t i = 0; i < n; ++i)
+    sinCosReduced(x[i], s[i], c[i]);
+  // arguments beyond the reduction limit are rare: redo them with libm
+  for (std::size_t i = 0; i < n; ++i)
+  {
+    if (!(std::fabs(x[i]) <= REDUCTION_LIMIT))
+    {
+      s[i] = std::sin(x[i]);
+      c[i] = std::cos(x[i]);
+    }
+  }
+}
+
+}
@@ -0,0 +1,13 @@
+#ifndef URDF_PARSER_SINCOS_HPP
+#define URDF_PARSER_SINCOS_HPP
+
+#include <cstddef>
+
+namespace urdf {
+
+// s[i] = sin(x[i]) and c[i] = cos(x[i]) for i < n, vectorized over i
+void sinCosLanes(std::size_t n, const double *x, double *s, double *c);
+
+}
+
+#endif
@@ -0,0 +1,163 @@
+#ifndef URDF_PARSER_SPATIAL_HPP
+#define URDF_PARSER_SPATIAL_HPP
+
+#include <urdf_parser/dynamics.h>
+
+#include "./rigid_transform.hpp"
+
+namespace urdf {
+
+// Spatial vectors are double[6], angular part first.  X is the pose of a
+// child frame in its parent.
+
+// motion vector m of the parent expressed in the child frame
+inline void motionToChild(const RigidTransform &X, const double *m, double *out)
+{
+  double v[3];
+  cross(m, X.p, v);
+  v[0] += m[3];
+  v[1] += m[4];
+  v[2] += m[5];
+  rotateTransposed(X.R, m, out);
+  rotateTransposed(X.R, v, out + 3);
+}
+
+// force vector f of the child expressed in the parent frame
+inline void forceToParent(const RigidTransform &X, const double *f, double *out)
+{
+  double n[3], moment[3];
+  rotate(X.R, f, n);
+  rotate(X.R, f + 3, out + 3);
+  cross(X.p, out + 3, moment);
+  out[0] = n[0] + moment[0];
+  out[1] = n[1] + moment[1];
+  out[2] = n[2] + moment[2];
+}
+
+// out = v x m for motion vectors v and m
+inline void crossMotion(const double *v, const double *m, double *out)
+{
+  double a[3], b[3];
+  cross(v, m, out);
+  cross(v, m + 3, a);
+  cross(v + 3, m, b);
+  out[3] = a[0] + b[0];
+  out[4] = a[1] + b[1];
+  out[5] = a[2] + b[2];
+}
+
+// out = v x* f for a motion vector v and a force vector f
+inline void crossForce(const double *v, const double *f, double *out)
+{
+  double a[3], b[3];
+  cross(v, f, a);
+  cross(v + 3, f + 3, b);
+  cross(v, f + 3, out + 3);
+  out[0] = a[0] + b[0];
+  out[1] = a[1] + b[1];
+  out[2] = a[2] + b[2];
+}
+
+// out = I m: n = I w + h x v, f = m v + w x h
+inline void applyInertia(const SpatialInertia &I, const double *m, double *out)
+{
+  const double *w = m, *v = m + 3;
+  double hv[3], wh[3];
+  cross(I.h, v, hv);
+  cross(w, I.h, wh);
+  out[0] = I.I[0] * w[0] + I.I[1] * w[1] + I.I[2] * w[2] + hv[0];
+  out[1] = I.I[1] * w[0] + I.I[3] * w[1] + I.I[4] * w[2] + hv[1];
+  out[2] = I.I[2] * w[0] + I.I[4] * w[1] + I.I[5] * w[2] + hv[2];
+  out[3] = I.mass * v[0] + wh[0];
+  out[4] = I.mass * v[1] + wh[1];
+  out[5] = I.mass * v[2] + wh[2];
+}
+
+// inertia I of the child expressed about the parent origin in the parent
+// frame, added to out
+inline void addInertiaToParent(const RigidTransform &X, const SpatialInertia &I, SpatialInertia &out)
+{
+  // rotate: h' = R h, I' = R I R^T, still about the child origin
+  const double full[9] = {I.I[0], I.I[1], I.I[2], I.I[1], I.I[3], I.I[4], I.I[2], I.I[4], I.I[5]};
+  double RI[9], Ir[9], h[3];
+  mul33(X.R, full, RI);
+  for (int i = 0; i < 3; ++i)
+    for (int j = i; j < 3; ++j)
+      Ir[3 * i + j] = RI[3 * i] * X.R[3 * j] + RI[3 * i + 1] * X.R[3 * j + 1] + RI[3 * i + 2] * X.R[3 * j + 2];
+  rotate(X.R, I.h, h);
+
+  // move the origin by -p: I += m (|p|^2 1 - p p^T) + 2 (p.h) 1 - (p h^T + h p^T)
+  const double *p = X.p, m = I.mass;
+  const double diagonal = m * dot(p, p) + 2.0 * dot(p, h);
+  out.mass += m;
+  out.h[0] += h[0] + m * p[0];
+  out.h[1] += h[1] + m * p[1];
+  out.h[2] += h[2] + m * p[2];
+  out.I[0] += Ir[0] + diagonal - m * p[0] * p[0] - 2.0 * p[0] * h[0];
+  out.I[1] += Ir[1] - m * p[0] * p[1] - p[0] * h[1] - h[0] * p[1];
+  out.I[2] += Ir[2] - m * p[0] * p[2] - p[0] * h[2] - h[0] * p[2];
+  out.I[3] += Ir[4] + diagonal - m * p[1] * p[1] - 2.0 * p[1] * h[1];
+  out.I[4] += Ir[5] - m * p[1] * p[2] - p[1] * h[2] - h[1] * p[2];
+  out.I[5] += Ir[8] + diagonal - m * p[2] * p[2] - 2.0 * p[2] * h[2];
+}
+
+// inertia about the link origin of the URDF inertial, which is given about
+// the center of mass in the inertial frame
+inline void inertialToSpatial(const Inertial &inertial, SpatialInertia &out)
+{
+  const Rotation &r = inertial.origin.rotation;
+  double R[9], RI[9], Ic[9];
+  quaternionToMatrix(r.x, r.y, r.z, r.w, R);
+  const double I[9] = {inertial.ixx, inertial.ixy, inertial.ixz,
+                       inertial.ixy, inertial.iyy, inertial.iyz,
+                       inertial.ixz, inertial.iyz, inertial.izz};
+  mul33(R, I, RI);
+  for (int i = 0; i < 3; ++i)
+    for (int j = 0; j < 3; ++j)
+      Ic[3 * i + j] = RI[3 * i] * R[3 * j] + RI[3 * i + 1] * R[3 * j + 1] + RI[3 * i + 2] * R[3 * j + 2];
+
+  // parallel axis theorem: I = Ic + m (|c|^2 1 - c c^T)
+  const double m = inertial.mass;
+  const double c[3] = {inertial.origin.position.x, inertial.origin.position.y, inertial.origin.position.z};
+  const double cc = dot(c, c);
+  out.mass = m;
+  out.h[0] = m * c[0];
+  out.h[1] = m * c[1];
+  out.h[2] = m * c[2];
+  out.I[0] = Ic[0] + m * (cc - c[0] * c[0]);
+  out.I[1] = Ic[1] - m * c[0] * c[1];
+  out.I[2] = Ic[2] - m * c[0] * c[2];
+  out.I[3] = Ic[4] + m * (cc - c[1] * c[1]);
+  out.I[4] = Ic[5] - m * c[1] * c[2];
+  out.I[5] = Ic[8] + m * (cc - c[2] * c[2]);
+}
+
+// the inverse: the URDF inertial of I, about the center of mass h / mass in
+// an unrotated frame; I.mass must be positive
+inline void spatialToInertial(const SpatialInertia &I, Inertial &inertial)
+{
+  // the inverse of the parallel axis theorem: Ic = I - m (|c|^2 1 - c c^T)
+  const double m = I.mass;
+  const double c[3] = {I.h[0] / m, I.h[1] / m, I.h[2] / m};
+  const double cc = dot(c, c);
+  inertial.clear();
+  inertial.mass = m;
+  inertial.origin.position.x = c[0];
+  inertial.origin.position.y = c[1];
+  inertial.origin.position.z = c[2];
+  inertial.ixx = I.I[0] - m * (cc - c[0] * c[0]);
+  inertial.ixy = I.I[1] + m * c[0] * c[1];
+  inertial.ixz = I.I[2] + m * c[0] * c[2];
+  inertial.iyy = I.I[3] - m * (cc - c[1] * c[1]);
+  inertial.iyz = I.I[4] + m * c[1] * c[2];
+  inertial.izz = I.I[5] - m * (cc - c[2] * c[2]);
+}
+
+inline double dot6(const double *a, const double *b)
+{
+  return a[0] * b[0] + a[1] * b[1] + a[2] * b[2] + a[3] * b[3] + a[4] * b[4] + a[5] * b[5];
+}
+
+}
+
+#endif
@@ -0,0 +1,15 @@
+#ifndef URDF_PARSER_TARGET_CLONES_HPP
+#define URDF_PARSER_TARGET_CLONES_HPP
+
+// Compiles a function for several instruction sets and picks one at load
+// time.  Used on the loops over independent lanes, which the compiler
+// vectorizes to the full register width of each clone.  Only GCC on x86-64
+// ELF targets supports this; elsewhere the baseline build is used.
+#if defined(__GNUC__) && !defined(__clang__) && defined(__x86_64__) && defined(__ELF__) && \
+    !defined(URDFDOM_NO_TARGET_CLONES)
+#define URDFDOM_TARGET_CLONES __attribute__((target_clones("avx512f", "avx2", "default")))
+#else
+#define URDFDOM_TARGET_CLONES
+#endif
+
+#endif
@@ -0,0 +1,186 @@
+#include <cmath>
+#include <vector>
+
+#include <urdf_parser/tree_factorization.h>
+
+namespace urdf{
+
+void TreeFactorization::clear()
+{
+  parent_.clear();
+  row_begin_.assign(1, 0);
+  source_.clear();
+  values_.clear();
+  unit_ = false;
+}
+
+void TreeFactorization::resize(const DynamicsModel &model)
+{
+  this->clear();
+  const KinematicModel &kin = model.kinematics();
+  const std::size_t n = kin.velocitySize();
+  parent_.assign(n, -1);
+  for (std::size_t i = 0; i < kin.bodyCount(); ++i)
+  {
+    const KinematicModel::Body &body = kin.body(i);
+    if (body.v_size == 0)
+      continue;
+    // the last coordinate of the nearest movable ancestor
+    const std::size_t support = kin.supportSize(i);
+    if (support > 1)
+    {
+      const KinematicModel::Body &ancestor = kin.body(kin.support(i)[support - 2]);
+      parent_[body.v_offset] = static_cast<int>(ancestor.v_offset + ancestor.v_size - 1);
+    }
+    for (std::size_t k = 1; k < body.v_size; ++k)
+      parent_[body.v_offset + k] = static_cast<int>(body.v_offset + k - 1);
+  }
+
+  const ClusterBlockMatrix layout(model);
+  for (std::size_t k = 0; k < n; ++k)
+  {
+    for (int a = static_cast<int>(k); a >= 0; a = parent_[a])
+      source_.push_back(layout.entryOffset(k, a));
+    row_begin_.push_back(source_.size());
+  }
+  values_.assign(source_.size(), 0.0);
+}
+
+void TreeFactorization::load(const ClusterBlockMatrix &M)
+{
+  const double *data = M.data();
+  for (std::size_t e = 0; e < source_.size(); ++e)
+    values_[e] = data[source_[e]];
+}
+
+void TreeFactorization::load(const double *M)
+{
+  const std::size_t n = parent_.size();
+  for (std::size_t k = 0; k < n; ++k)
+  {
+    double *Lk = &values_[row_begin_[k]];
+    for (int a = static_cast<int>(k); a >= 0; a = parent_[a])
+      *Lk++ = M[k * n + a];
+  }
+}
+
+// Row k scales the rows of its ancestors i: L(i, j) -= L(k, i) L(k, j) for
+// j = i and the ancestors of i, which are the entries of row k after i.
+bool TreeFactorization::factorLTL()
+{
+  unit_ = false;
+  for (std::size_t k = parent_.size(); k-- > 0;)
+  {
+    double *Lk = &values_[row_begin_[k]];
+    const std::size_t depth = row_begin_[k + 1] - row_begin_[k] - 1;
+    if (!(Lk[0] > 0.0))
+      return false;
+    const double d = std::sqrt(Lk[0]);
+    Lk[0] = d;
+    for (std::size_t e = 1; e <= depth; ++e)
+      Lk[e] /= d;
+    int i = parent_[k];
+    for (std::size_t e = 1; e <= depth; ++e, i = parent_[i])
+    {
+      double *Li = &values_[row_begin_[i]];
+      const double a = Lk[e];
+      for (std::size_t f = e; f <= depth; ++f)
+        Li[f - e] -= a * Lk[f];
+    }
+  }
+  return true;
+}
+
+bool TreeFactorization::factorLTDL()
+{
+  unit_ = true;
+  for (std::size_t k = parent_.size(); k-- > 0;)
+  {
+    double *Lk = &values_[row_begin_[k]];
+    const std::size_t depth = row_begin_[k + 1] - row_begin_[k] - 1;
+    if (!(Lk[0] > 0.0))
+      return false;
+    int i = parent_[k];
+    for (std::size_t e = 1; e <= depth; ++e, i = parent_[i])
+    {
+      double *Li = &values_[row_begin_[i]];
+      const double a = Lk[e] / Lk[0];
+      for (std::size_t f = e; f <= depth; ++f)
+        Li[f - e] -= a * Lk[f];
+      Lk[e] = a;
+    }
+  }
+  return true;
+}
+
+bool TreeFactorization::factorLTL(const ClusterBlockMatrix &M)
+{
+  this->load(M);
+  return this->factorLTL();
+}
+
+bool TreeFactorization::factorLTL(const double *M)
+{
+  this->load(M);
+  return this->factorLTL();
+}
+
+bool TreeFactorization::factorLTDL(const ClusterBlockMatrix &M)
+{
+  this->load(M);
+  return this->factorLTDL();
+}
+
+bool TreeFactorization::factorLTDL(const double *M)
+{
+  this->load(M);
+  return this->factorLTDL();
+}
+
+void TreeFactorization::solveLT(double *x) const
+{
+  for (std::size_t k = parent_.size(); k-- > 0;)
+  {
+    const double *Lk = &values_[row_begin_[k]];
+    const std::size_t depth = row_begin_[k + 1] - row_begin_[k] - 1;
+    if (!unit_)
+      x[k] /= Lk[0];
+    const double xk = x[k];
+    int a = parent_[k];
+    for (std::size_t e = 1; e <= depth; ++e, a = parent_[a])
+      x[a] -= Lk[e] * xk;
+  }
+}
+
+void TreeFactorization::solveL(double *x) const
+{
+  for (std::size_t k = 0; k < parent_.size(); ++k)
+  {
+    const double *Lk = &values_[row_begin_[k]];
+    const std::size_t depth = row_begin_[k + 1] - row_begin_[k] - 1;
+    double sum = x[k];
+    int a = parent_[k];
+    for (std::size_t e = 1; e <= depth; ++e, a = parent_[a])
+      sum -= Lk[e] * x[a];
+    x[k] = unit_ ? sum : sum / Lk[0];
+  }
+}
+
+void TreeFactorization::solve(double *x) const
+{
+  this->solveLT(x);
+  if (unit_)
+  {
+    for (std::size_t k = 0; k < parent_.size(); ++k)
+      x[k] /= values_[row_begin_[k]];
+  }
+  this->solveL(x);
+}
+
+void TreeFactorization::solve(std::size_t count, double *x) const
+{
+  for (std::size_t c = 0; c < count; ++c)
+    this->solve(x + c * parent_.size());
+}
+
+}
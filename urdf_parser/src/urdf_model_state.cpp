@@ -47,104 +47,96 @@
 #include <console_bridge/console.h>
 
 #include <urdf_parser/urdf_parser.h>
+
+#include "./double_list.hpp"
+#include "./model_state.hpp"
+
 namespace urdf{
 
-bool parseModelState(ModelState &ms, tinyxml2::XMLElement* config)
+bool parseModelStateInternal(ModelState &ms, tinyxml2::XMLElement* config)
 {
-  ms.clear();
-
   const char *name_char = config->Attribute("name");
   if (!name_char)
   {
     CONSOLE_BRIDGE_logError("No name given for the model_state.");
     return false;
   }
-  ms.name = std::string(name_char);
+  ms.name = name_char;
 
+  ms.time_stamp.set(0);
   const char *time_stamp_char = config->Attribute("time_stamp");
   if (time_stamp_char)
   {
+    // a single number, optionally surrounded by white space
+    const char *p = time_stamp_char;
+    while (isListSeparator(*p))
+      ++p;
+    const char *end = p;
     try {
-      ms.time_stamp.set(strToDouble(time_stamp_char));
+      ms.time_stamp.set(parseDoubleToken(p, end));
     } catch(std::runtime_error &) {
+      end = p;
+    }
+    while (end != p && isListSeparator(*end))
+      ++end;
+    if (end == p || *end != '\0')
+    {
       CONSOLE_BRIDGE_logError("Parsing time stamp [%s] failed", time_stamp_char);
       return false;
     }
   }
 
-  tinyxml2::XMLElement *joint_state_elem = config->FirstChildElement("joint_state");
-  if (joint_state_elem)
+  // joint states already held by ms are overwritten in place, so that a
+  // caller reading a stream of records stops allocating once the buffers
+  // have grown to the size of a record
+  std::size_t count = 0;
+  for (tinyxml2::XMLElement* joint_state_elem = config->FirstChildElement("joint_state"); joint_state_elem; joint_state_elem = joint_state_elem->NextSiblingElement("joint_state"))
   {
-    JointStateSharedPtr joint_state;
-    joint_state.reset(new JointState());
+    if (count == ms.joint_states.size())
+      ms.joint_states.push_back(JointStateSharedPtr(new JointState()));
+    else if (!ms.joint_states[count])
+      ms.joint_states[count].reset(new JointState());
+    JointState &joint_state = *ms.joint_states[count];
+    ++count;
 
     const char *joint_char = joint_state_elem->Attribute("joint");
     if (joint_char)
-      joint_state->joint = std::string(joint_char);
+      joint_state.joint = joint_char;
     else
     {
       CONSOLE_BRIDGE_logError("No joint name given for the model_state.");
+      ms.joint_states.resize(count - 1);
       return false;
     }
 
+    joint_state.position.clear();
+    joint_state.velocity.clear();
+    joint_state.effort.clear();
+
     // parse position
     const char *position_char = joint_state_elem->Attribute("position");
     if (position_char)
-    {
-
-      std::vector<std::string> pieces;
-      urdf::split_string( pieces, position_char, " ");
-      for (unsigned int i = 0; i < pieces.size(); ++i){
-        if (pieces[i] != ""){
-          try {
-            joint_state->position.push_back(strToDouble(pieces[i].c_str()));
-          } catch(std::runtime_error &) {
-            throw ParseError("position element ("+ pieces[i] +") is not a valid float");
-          }
-        }
-      }
-    }
+      parseDoubleList(position_char, joint_state.position, "position");
 
     // parse velocity
     const char *velocity_char = joint_state_elem->Attribute("velocity");
     if (velocity_char)
-    {
-
-      std::vector<std::string> pieces;
-      urdf::split_string( pieces, velocity_char, " ");
-      for (unsigned int i = 0; i < pieces.size(); ++i){
-        if (pieces[i] != ""){
-          try {
-            joint_state->velocity.push_back(strToDouble(pieces[i].c_str()));
-          } catch(std::runtime_error &) {
-            throw ParseError("velocity element ("+ pieces[i] +") is not a valid float");
-          }
-        }
-      }
-    }
+      parseDoubleList(velocity_char, joint_state.velocity, "velocity");
 
     // parse effort
     const char *effort_char = joint_state_elem->Attribute("effort");
     if (effort_char)
-    {
+      parseDoubleList(effort_char, joint_state.effort, "effort");
+  }
+  ms.joint_states.resize(count);
 
-      std::vector<std::string> pieces;
-      urdf::split_string( pieces, effort_char, " ");
-      for (unsigned int i = 0; i < pieces.size(); ++i){
-        if (pieces[i] != ""){
-          try {
-            joint_state->effort.push_back(strToDouble(pieces[i].c_str()));
-          } catch(std::runtime_error &) {
-            throw ParseError("effort element ("+ pieces[i] +") is not a valid float");
-          }
-        }
-      }
-    }
+  return true;
+}
 
-    // add to vector
-    ms.joint_states.push_back(joint_state);
-  }
-  return false;
+bool parseModelState(ModelState &ms, tinyxml2::XMLElement* config)
+{
+  ms.clear();
+  return parseModelStateInternal(ms, config);
 }
 
 
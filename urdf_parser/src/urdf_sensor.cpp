@@ -294,7 +294,7 @@ bool parseRayInternal(Ray &ray, tinyxml2::XMLElement* config)
       }
     }
   }
-  return false;
+  return true;
 }
 
 bool parseRay(Ray &ray, tinyxml2::XMLElement* config)
@@ -332,7 +332,7 @@ VisualSensorSharedPtr parseVisualSensor(tinyxml2::XMLElement *g)
 }
 
 
-bool parseSensor(Sensor &sensor, tinyxml2::XMLElement* config)
+bool parseSensorInternal(Sensor &sensor, tinyxml2::XMLElement* config)
 {
   sensor.clear();
 
@@ -344,9 +344,15 @@ bool parseSensor(Sensor &sensor, tinyxml2::XMLElement* config)
   }
   sensor.name = std::string(name_char);
 
-  // parse parent_link_name
+  // parse parent_link_name, or the <parent link=""/> element used in robot descriptions
   const char *parent_link_name_char = config->Attribute("parent_link_name");
   if (!parent_link_name_char)
+  {
+    tinyxml2::XMLElement *parent = config->FirstChildElement("parent");
+    if (parent)
+      parent_link_name_char = parent->Attribute("link");
+  }
+  if (!parent_link_name_char)
   {
     CONSOLE_BRIDGE_logError("No parent_link_name given for the sensor.");
     return false;
@@ -366,5 +372,10 @@ bool parseSensor(Sensor &sensor, tinyxml2::XMLElement* config)
   return true;
 }
 
+bool parseSensor(Sensor &sensor, tinyxml2::XMLElement* config)
+{
+  return parseSensorInternal(sensor, config);
+}
+
 
 }
@@ -38,22 +38,238 @@
 #include <urdf_world/world.h>
 #include <urdf_model/model.h>
 #include <urdf_parser/urdf_parser.h>
+#include <urdf_parser/world_parser.h>
+#include <atomic>
+#include <chrono>
 #include <fstream>
+#include <map>
+#include <thread>
 #include <sstream>
 #include <algorithm>
 #include <tinyxml2.h>
 #include <console_bridge/console.h>
 
+#include "./pose.hpp"
+
 namespace urdf{
 
-bool parseWorld(World &/*world*/, tinyxml2::XMLElement* /*config*/)
+bool parseTwist(Twist &twist, tinyxml2::XMLElement* xml);
+
+void WorldDescription::clear()
 {
+  world.clear();
+  world.models.clear();
+  models.clear();
+  instances.clear();
+  load_seconds = 0.0;
+}
 
-  // to be implemented
+std::size_t WorldDescription::findInstance(const std::string &name) const
+{
+  for (std::size_t i = 0; i < instances.size(); ++i)
+  {
+    if (instances[i].name == name)
+      return i;
+  }
+  return instances.size();
+}
+
+static std::string resolvePath(const std::string &filename, const std::string &base_directory)
+{
+  if (base_directory.empty() || filename.empty() || filename[0] == '/' || filename[0] == '\\' ||
+      (filename.size() > 1 && filename[1] == ':'))
+    return filename;
+  return base_directory + "/" + filename;
+}
+
+static bool parseWorldInternal(WorldDescription &world, tinyxml2::XMLElement* config, const std::string &base_directory,
+                               unsigned int threads)
+{
+  world.clear();
+
+  const char *name = config->Attribute("name");
+  if (!name)
+  {
+    CONSOLE_BRIDGE_logError("No name given for the world.");
+    return false;
+  }
+  world.world.name = std::string(name);
+
+  // Get all include elements; includes of the same file share one model
+  std::map<std::string, std::size_t> model_index;
+  std::map<std::string, std::size_t> file_index;
+  for (tinyxml2::XMLElement* include_xml = config->FirstChildElement("include"); include_xml; include_xml = include_xml->NextSiblingElement("include"))
+  {
+    const char *filename = include_xml->Attribute("filename");
+    const char *model_name = include_xml->Attribute("model_name");
+    if (!filename || !model_name)
+    {
+      CONSOLE_BRIDGE_logError("World include needs a filename and a model_name attribute");
+      world.clear();
+      return false;
+    }
+    if (model_index.find(model_name) != model_index.end())
+    {
+      CONSOLE_BRIDGE_logError("World model [%s] is not unique", model_name);
+      world.clear();
+      return false;
+    }
+
+    const std::string path = resolvePath(filename, base_directory);
+    std::map<std::string, std::size_t>::const_iterator f = file_index.find(path);
+    if (f != file_index.end())
+    {
+      model_index[model_name] = f->second;
+      continue;
+    }
+
+    WorldModel model;
+    model.name = model_name;
+    model.filename = path;
+    file_index[path] = world.models.size();
+    model_index[model_name] = world.models.size();
+    world.models.push_back(model);
+  }
+
+  // Parse the distinct models on a pool; every worker writes only to the
+  // models it claims, so the result does not depend on the scheduling
+  std::size_t workers = threads ? threads : std::thread::hardware_concurrency();
+  workers = std::max<std::size_t>(1, std::min(workers, world.models.size()));
+  std::atomic<std::size_t> next_model(0);
+  auto load = [&world, &next_model]()
+  {
+    for (std::size_t i = next_model++; i < world.models.size(); i = next_model++)
+    {
+      WorldModel &model = world.models[i];
+      const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+      model.model = parseURDFFile(model.filename);
+      model.load_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+  };
+  const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  std::vector<std::thread> pool;
+  for (std::size_t w = 1; w < workers; ++w)
+    pool.push_back(std::thread(load));
+  load();
+  for (std::size_t w = 0; w < pool.size(); ++w)
+    pool[w].join();
+  world.load_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
 
+  for (std::size_t i = 0; i < world.models.size(); ++i)
+  {
+    const WorldModel &model = world.models[i];
+    if (!model.model)
+    {
+      CONSOLE_BRIDGE_logError("Failed to load model [%s] from [%s]", model.name.c_str(), model.filename.c_str());
+      world.clear();
+      return false;
+    }
+    CONSOLE_BRIDGE_logDebug("urdfdom: loaded model [%s] from [%s] in %.3f ms",
+                            model.name.c_str(), model.filename.c_str(), 1e3 * model.load_seconds);
+  }
+  CONSOLE_BRIDGE_logDebug("urdfdom: loaded %zu models of world [%s] in %.3f ms on %zu threads",
+                          world.models.size(), world.world.name.c_str(), 1e3 * world.load_seconds, workers);
+
+  // Get all entity elements
+  for (tinyxml2::XMLElement* entity_xml = config->FirstChildElement("entity"); entity_xml; entity_xml = entity_xml->NextSiblingElement("entity"))
+  {
+    const char *entity_name = entity_xml->Attribute("name");
+    const char *model_name = entity_xml->Attribute("model");
+    if (!entity_name || !model_name)
+    {
+      CONSOLE_BRIDGE_logError("World entity needs a name and a model attribute");
+      world.clear();
+      return false;
+    }
+    std::map<std::string, std::size_t>::const_iterator m = model_index.find(model_name);
+    if (m == model_index.end())
+    {
+      CONSOLE_BRIDGE_logError("World entity [%s] refers to model [%s], which is not included", entity_name, model_name);
+      world.clear();
+      return false;
+    }
+    if (world.findInstance(entity_name) != world.instances.size())
+    {
+      CONSOLE_BRIDGE_logError("World entity [%s] is not unique", entity_name);
+      world.clear();
+      return false;
+    }
+
+    Entity entity;
+    entity.model = world.models[m->second].model;
+    tinyxml2::XMLElement *o = entity_xml->FirstChildElement("origin");
+    if (o && !parsePoseInternal(entity.origin, o))
+    {
+      CONSOLE_BRIDGE_logError("World entity [%s] has a malformed origin", entity_name);
+      world.clear();
+      return false;
+    }
+    tinyxml2::XMLElement *t = entity_xml->FirstChildElement("twist");
+    if (t && !parseTwist(entity.twist, t))
+    {
+      CONSOLE_BRIDGE_logError("World entity [%s] has a malformed twist", entity_name);
+      world.clear();
+      return false;
+    }
+
+    WorldInstance instance;
+    instance.name = entity_name;
+    instance.model = m->second;
+    world.instances.push_back(instance);
+    world.world.models.push_back(entity);
+  }
+
+  return true;
+}
+
+bool parseWorld(World &world, tinyxml2::XMLElement* config)
+{
+  WorldDescription description;
+  if (!parseWorldInternal(description, config, std::string(), 0))
+    return false;
+  world = description.world;
   return true;
 }
 
+bool parseWorld(const std::string &xml_string, WorldDescription &world, const std::string &base_directory,
+                unsigned int threads)
+{
+  tinyxml2::XMLDocument xml_doc;
+  xml_doc.Parse(xml_string.c_str());
+  if (xml_doc.Error())
+  {
+    CONSOLE_BRIDGE_logError(xml_doc.ErrorStr());
+    xml_doc.ClearError();
+    world.clear();
+    return false;
+  }
+
+  tinyxml2::XMLElement *world_xml = xml_doc.FirstChildElement("world");
+  if (!world_xml)
+  {
+    CONSOLE_BRIDGE_logError("Could not find the 'world' element in the xml file");
+    world.clear();
+    return false;
+  }
+  return parseWorldInternal(world, world_xml, base_directory, threads);
+}
+
+bool parseWorldFile(const std::string &path, WorldDescription &world, unsigned int threads)
+{
+  std::ifstream stream(path.c_str());
+  if (!stream)
+  {
+    CONSOLE_BRIDGE_logError(("File " + path + " does not exist").c_str());
+    world.clear();
+    return false;
+  }
+
+  std::string xml_str((std::istreambuf_iterator<char>(stream)),
+                      std::istreambuf_iterator<char>());
+  const std::string::size_type slash = path.find_last_of("/\\");
+  return parseWorld(xml_str, world, slash == std::string::npos ? std::string(".") : path.substr(0, slash), threads);
+}
+
 bool exportWorld(World &world, tinyxml2::XMLElement* xml)
 {
   tinyxml2::XMLElement * world_xml = xml->GetDocument()->NewElement("world");
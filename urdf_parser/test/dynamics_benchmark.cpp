@@ -0,0 +1,309 @@
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "urdf_parser/dynamics.h"
+#include "urdf_parser/tree_factorization.h"
+#include "urdf_parser/urdf_parser.h"
+
+// Writes URDF for the benchmark robots: every link has a small box inertia.
+class RobotWriter
+{
+public:
+  explicit RobotWriter(const std::string &name) { xml_ << "<robot name=\"" << name << "\">"; }
+
+  void link(const std::string &name, double mass)
+  {
+    xml_ << "<link name=\"" << name << "\"><inertial><mass value=\"" << mass << "\"/>"
+         << "<origin xyz=\"0.01 0.005 -0.05\"/>"
+         << "<inertia ixx=\"" << 0.01 * mass << "\" ixy=\"0\" ixz=\"0\" iyy=\"" << 0.012 * mass
+         << "\" iyz=\"0\" izz=\"" << 0.005 * mass << "\"/></inertial></link>";
+  }
+
+  void joint(const std::string &name, const std::string &type, const std::string &parent, const std::string &child,
+             const std::string &xyz, const std::string &axis, bool independent = true)
+  {
+    xml_ << "<joint name=\"" << name << "\" type=\"" << type << "\""
+         << (independent ? "" : " independent=\"false\"") << ">"
+         << "<parent link=\"" << parent << "\"/><child link=\"" << child << "\"/>"
+         << "<origin xyz=\"" << xyz << "\"/><axis xyz=\"" << axis << "\"/>"
+         << "<limit effort=\"1\" velocity=\"1\" lower=\"-3\" upper=\"3\"/></joint>";
+  }
+
+  void loop(const std::string &name, const std::string &predecessor, const std::string &successor,
+            const std::string &successor_xyz)
+  {
+    xml_ << "<loop name=\"" << name << "\" type=\"revolute\">"
+         << "<predecessor link=\"" << predecessor << "\"><origin xyz=\"0.04 0 0\"/></predecessor>"
+         << "<successor link=\"" << successor << "\"><origin xyz=\"" << successor_xyz << "\"/></successor>"
+         << "<axis xyz=\"0 1 0\"/></loop>";
+  }
+
+  void coupling(const std::string &name, const std::string &predecessor, const std::string &successor, double ratio)
+  {
+    xml_ << "<coupling name=\"" << name << "\"><predecessor link=\"" << predecessor << "\"/>"
+         << "<successor link=\"" << successor << "\"/><ratio value=\"" << ratio << "\"/></coupling>";
+  }
+
+  // A pitch joint driven from the parent through a geared rotor and a four
+  // bar linkage (crank and rod) closing on the child.
+  void linkageJoint(const std::string &name, const std::string &parent, const std::string &child,
+                    const std::string &xyz)
+  {
+    this->link(name + "_rotor", 0.1);
+    this->link(name + "_crank", 0.05);
+    this->link(name + "_rod", 0.05);
+    this->joint(name, "revolute", parent, child, xyz, "0 1 0", false);
+    this->joint(name + "_motor", "continuous", parent, name + "_rotor", "0 0.03 0", "0 1 0", false);
+    this->joint(name + "_crank", "revolute", parent, name + "_crank", "0.04 0 0", "0 1 0");
+    this->joint(name + "_rod", "revolute", name + "_crank", name + "_rod", "0.04 0 0", "0 1 0", false);
+    this->coupling(name + "_gear", name + "_crank", name + "_rotor", 6.0);
+    this->loop(name + "_loop", child, name + "_rod", "0 0 -0.2");
+  }
+
+  std::string str() { return xml_.str() + "</robot>"; }
+
+private:
+  std::ostringstream xml_;
+};
+
+// fixed base arm with six revolute joints
+static std::string arm()
+{
+  RobotWriter robot("arm");
+  robot.link("base", 0.0);
+  const char *axes[6] = {"0 0 1", "0 1 0", "0 1 0", "1 0 0", "0 1 0", "1 0 0"};
+  std::string parent = "base";
+  for (int j = 0; j < 6; ++j)
+  {
+    const std::string link = "link" + std::to_string(j + 1);
+    robot.link(link, 2.0 - 0.3 * j);
+    robot.joint("joint" + std::to_string(j + 1), "revolute", parent, link, "0 0 0.2", axes[j]);
+    parent = link;
+  }
+  return robot.str();
+}
+
+// floating head with a spine of ten segments, two four joint legs on each
+// and a four joint tail: 100 dof
+static std::string centipede()
+{
+  RobotWriter robot("centipede");
+  robot.link("world", 0.0);
+  robot.link("head", 1.0);
+  robot.joint("base", "floating", "world", "head", "0 0 0.3", "1 0 0");
+  std::string parent = "head";
+  for (int s = 0; s < 10; ++s)
+  {
+    const std::string segment = "segment" + std::to_string(s);
+    robot.link(segment, 0.5);
+    robot.joint(segment, "revolute", parent, segment, "-0.1 0 0", "0 0 1");
+    for (int l = 0; l < 2; ++l)
+    {
+      const char *axes[4] = {"0 0 1", "1 0 0", "1 0 0", "1 0 0"};
+      std::string limb = segment;
+      for (int j = 0; j < 4; ++j)
+      {
+        const std::string link = segment + (l == 0 ? "_left" : "_right") + std::to_string(j);
+        robot.link(link, 0.05);
+        robot.joint(link, "revolute", limb, link, j == 0 ? (l == 0 ? "0 0.05 0" : "0 -0.05 0") : "0 0 -0.05",
+                    axes[j]);
+        limb = link;
+      }
+    }
+    parent = segment;
+  }
+  for (int j = 0; j < 4; ++j)
+  {
+    const std::string link = "tail" + std::to_string(j);
+    robot.link(link, 0.1);
+    robot.joint(link, "revolute", parent, link, "-0.1 0 0", j % 2 == 0 ? "0 0 1" : "0 1 0");
+    parent = link;
+  }
+  return robot.str();
+}
+
+// dense Cholesky M = L L^T in the lower triangle, for comparison
+static bool denseCholesky(double *M, std::size_t n)
+{
+  for (std::size_t j = 0; j < n; ++j)
+  {
+    double d = M[j * n + j];
+    for (std::size_t k = 0; k < j; ++k)
+      d -= M[j * n + k] * M[j * n + k];
+    if (!(d > 0.0))
+      return false;
+    d = std::sqrt(d);
+    M[j * n + j] = d;
+    for (std::size_t i = j + 1; i < n; ++i)
+    {
+      double sum = M[i * n + j];
+      for (std::size_t k = 0; k < j; ++k)
+        sum -= M[i * n + k] * M[j * n + k];
+      M[i * n + j] = sum / d;
+    }
+  }
+  return true;
+}
+
+// floating trunk with four legs: hip abduction, hip pitch, and a knee driven
+// through a linkage
+static std::string quadruped()
+{
+  RobotWriter robot("quadruped");
+  robot.link("world", 0.0);
+  robot.link("trunk", 10.0);
+  robot.joint("base", "floating", "world", "trunk", "0 0 0.5", "1 0 0");
+  const char *legs[4] = {"fl", "fr", "hl", "hr"};
+  for (int l = 0; l < 4; ++l)
+  {
+    const std::string leg = legs[l];
+    const std::string x = l < 2 ? "0.2" : "-0.2", y = l % 2 == 0 ? "0.1" : "-0.1";
+    robot.link(leg + "_hip", 0.8);
+    robot.link(leg + "_thigh", 1.0);
+    robot.link(leg + "_shank", 0.3);
+    robot.joint(leg + "_abad", "revolute", "trunk", leg + "_hip", x + " " + y + " 0", "1 0 0");
+    robot.joint(leg + "_pitch", "revolute", leg + "_hip", leg + "_thigh", "0 0.08 0", "0 1 0");
+    robot.linkageJoint(leg + "_knee", leg + "_thigh", leg + "_shank", "0 0 -0.2");
+  }
+  return robot.str();
+}
+
+// floating pelvis with a torso, arms and head, and legs whose knees and
+// ankles are driven through linkages
+static std::string humanoid()
+{
+  RobotWriter robot("humanoid");
+  robot.link("world", 0.0);
+  robot.link("pelvis", 8.0);
+  robot.joint("base", "floating", "world", "pelvis", "0 0 1", "1 0 0");
+  robot.link("torso", 12.0);
+  robot.joint("waist", "revolute", "pelvis", "torso", "0 0 0.1", "0 0 1");
+  robot.link("head", 2.0);
+  robot.joint("neck", "revolute", "torso", "head", "0 0 0.4", "0 0 1");
+  const char *sides[2] = {"left", "right"};
+  for (int s = 0; s < 2; ++s)
+  {
+    const std::string side = sides[s];
+    const std::string y = s == 0 ? "0.1" : "-0.1";
+    const char *leg[5] = {"hip_yaw", "hip_roll", "hip_pitch", "thigh", "shank"};
+    const char *leg_axes[3] = {"0 0 1", "1 0 0", "0 1 0"};
+    std::string parent = "pelvis";
+    for (int j = 0; j < 3; ++j)
+    {
+      robot.link(side + "_" + leg[j] + "_link", 1.0);
+      robot.joint(side + "_" + leg[j], "revolute", parent, side + "_" + leg[j] + "_link",
+                  j == 0 ? "0 " + y + " -0.1" : "0 0 -0.05", leg_axes[j]);
+      parent = side + "_" + leg[j] + "_link";
+    }
+    robot.link(side + "_shank", 2.0);
+    robot.linkageJoint(side + "_knee", parent, side + "_shank", "0 0 -0.4");
+    robot.link(side + "_ankle", 0.2);
+    robot.linkageJoint(side + "_ankle_pitch", side + "_shank", side + "_ankle", "0 0 -0.4");
+    robot.link(side + "_foot", 0.8);
+    robot.joint(side + "_ankle_roll", "revolute", side + "_ankle", side + "_foot", "0 0 -0.02", "1 0 0");
+
+    const char *arm[7] = {"shoulder_pitch", "shoulder_roll", "shoulder_yaw", "elbow", "wrist_yaw", "wrist_pitch",
+                          "wrist_roll"};
+    const char *arm_axes[7] = {"0 1 0", "1 0 0", "0 0 1", "0 1 0", "0 0 1", "0 1 0", "1 0 0"};
+    parent = "torso";
+    for (int j = 0; j < 7; ++j)
+    {
+      robot.link(side + "_" + arm[j], j < 4 ? 1.0 : 0.3);
+      robot.joint(side + "_" + arm[j] + "_joint", "revolute", parent, side + "_" + arm[j],
+                  j == 0 ? "0 " + y + "5 0.35" : "0 0 -0.1", arm_axes[j]);
+      parent = side + "_" + arm[j];
+    }
+  }
+  return robot.str();
+}
+
+template <typename F>
+static double nanoseconds(F f, int repeats)
+{
+  typedef std::chrono::steady_clock clock;
+  const clock::time_point start = clock::now();
+  for (int r = 0; r < repeats; ++r)
+    f();
+  return std::chrono::duration<double, std::nano>(clock::now() - start).count() / repeats;
+}
+
+static int run(const std::string &name, const std::string &xml)
+{
+  urdf::ModelInterfaceSharedPtr model = urdf::parseURDF(xml);
+  urdf::DynamicsModel dyn;
+  if (!model || !dyn.init(*model))
+  {
+    fprintf(stderr, "Failed to build the %s model\n", name.c_str());
+    return 1;
+  }
+  const urdf::KinematicModel &kin = dyn.kinematics();
+  const std::size_t nv = kin.velocitySize();
+
+  std::mt19937 rng(1);
+  std::uniform_real_distribution<double> uniform(-1.0, 1.0);
+  std::vector<double> q(kin.positionSize()), v(nv), a(nv), tau(nv);
+  kin.neutralConfiguration(q.data());
+  for (std::size_t i = 0; i < kin.bodyCount(); ++i)
+  {
+    if (kin.body(i).type != urdf::Joint::FLOATING)
+      for (std::size_t k = 0; k < kin.body(i).q_size; ++k)
+        q[kin.body(i).q_offset + k] = uniform(rng);
+  }
+  for (std::size_t k = 0; k < nv; ++k)
+  {
+    v[k] = uniform(rng);
+    a[k] = uniform(rng);
+  }
+
+  urdf::DynamicsData data(dyn);
+  urdf::ClusterBlockMatrix M(dyn);
+  const int repeats = 20000;
+  const double rnea = nanoseconds([&]() { dyn.inverseDynamics(data, q.data(), v.data(), a.data(), tau.data()); },
+                                  repeats);
+  const double gravity = nanoseconds([&]() { dyn.gravityTorques(data, q.data(), tau.data()); }, repeats);
+  std::vector<double> com(3), Jcom(3 * nv);
+  const double center = nanoseconds([&]() { dyn.centerOfMass(data, q.data(), com.data(), Jcom.data()); },
+                                    repeats);
+  std::vector<double> qdd(nv);
+  const double aba = nanoseconds([&]() { dyn.forwardDynamics(data, q.data(), v.data(), tau.data(), qdd.data()); },
+                                 repeats);
+  const double crba = nanoseconds([&]() { dyn.massMatrix(data, q.data(), M); }, repeats);
+  std::vector<double> Y(nv * 10 * kin.bodyCount());
+  const double regressor = nanoseconds([&]() { dyn.regressor(data, q.data(), v.data(), a.data(), Y.data()); },
+                                       repeats / 10);
+
+  urdf::TreeFactorization L(dyn);
+  std::vector<double> dense(nv * nv), work(nv * nv), x(nv);
+  M.toDense(dense.data());
+  const double ltl = nanoseconds([&]() { L.factorLTL(M); }, repeats);
+  const double ltdl = nanoseconds([&]() { L.factorLTDL(M); }, repeats);
+  const double solve = nanoseconds([&]() { x = a; L.solve(x.data()); }, repeats);
+  const double cholesky = nanoseconds([&]() { work = dense; denseCholesky(work.data(), nv); }, repeats);
+
+  printf("%s: %zu bodies, %zu dof, %zu clusters, %zu of %zu mass matrix entries stored\n", name.c_str(),
+         kin.bodyCount(), nv, dyn.clusterCount(), M.valueCount(), nv * nv);
+  printf("  inverseDynamics (RNEA):  %8.1f ns\n", rnea);
+  printf("  gravityTorques:          %8.1f ns\n", gravity);
+  printf("  forwardDynamics (ABA):   %8.1f ns (%.0f per second)\n", aba, 1e9 / aba);
+  printf("  centerOfMass with J:     %8.1f ns\n", center);
+  printf("  massMatrix (CRBA):       %8.1f ns\n", crba);
+  printf("  regressor:               %8.1f ns\n", regressor);
+  printf("  factorLTL:               %8.1f ns (%zu of %zu lower triangle entries)\n", ltl, L.valueCount(),
+         nv * (nv + 1) / 2);
+  printf("  factorLTDL:              %8.1f ns\n", ltdl);
+  printf("  solve:                   %8.1f ns\n", solve);
+  printf("  dense Cholesky:          %8.1f ns\n", cholesky);
+  return 0;
+}
+
+int main()
+{
+  if (run("arm", arm()) != 0 || run("quadruped", quadruped()) != 0 || run("humanoid", humanoid()) != 0)
+    return 1;
+  return run("centipede", centipede());
+}
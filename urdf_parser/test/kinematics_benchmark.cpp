@@ -0,0 +1,109 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "urdf_parser/forward_kinematics_cache.h"
+#include "urdf_parser/kinematics.h"
+#include "urdf_parser/urdf_parser.h"
+
+// A serial chain of revolute joints with alternating axes.
+static std::string makeChain(int dofs)
+{
+  std::ostringstream xml;
+  xml << "<robot name=\"chain\"><link name=\"l0\"/>";
+  for (int i = 1; i <= dofs; ++i)
+  {
+    xml << "<link name=\"l" << i << "\"/>"
+        << "<joint name=\"j" << i << "\" type=\"revolute\">"
+        << "<parent link=\"l" << i - 1 << "\"/><child link=\"l" << i << "\"/>"
+        << "<origin xyz=\"0 0.05 0.2\" rpy=\"0.1 0 0\"/>"
+        << "<axis xyz=\"" << (i % 3 == 0) << " " << (i % 3 == 1) << " " << (i % 3 == 2) << "\"/>"
+        << "<limit effort=\"1\" velocity=\"1\" lower=\"-3\" upper=\"3\"/></joint>";
+  }
+  xml << "</robot>";
+  return xml.str();
+}
+
+int main(int argc, char** argv)
+{
+  const int dofs = argc > 1 ? std::atoi(argv[1]) : 30;
+  const std::size_t count = argc > 2 ? std::strtoul(argv[2], NULL, 10) : 4096;
+
+  urdf::ModelInterfaceSharedPtr model = urdf::parseURDF(makeChain(dofs));
+  urdf::KinematicModel kin;
+  if (!model || !kin.init(*model))
+  {
+    fprintf(stderr, "Failed to build the benchmark model\n");
+    return 1;
+  }
+
+  std::mt19937 rng(1);
+  std::uniform_real_distribution<double> uniform(-3.0, 3.0);
+  std::vector<double> q(kin.positionSize() * count);
+  for (double &value : q)
+    value = uniform(rng);
+
+  typedef std::chrono::steady_clock clock;
+  const int repeats = 20;
+
+  // scalar path: configuration n is column n of the structure-of-arrays q
+  std::vector<double> qn(kin.positionSize());
+  std::vector<urdf::RigidTransform> poses(kin.bodyCount());
+  double checksum = 0.0;
+  clock::time_point start = clock::now();
+  for (int r = 0; r < repeats; ++r)
+  {
+    for (std::size_t n = 0; n < count; ++n)
+    {
+      for (std::size_t k = 0; k < kin.positionSize(); ++k)
+        qn[k] = q[k * count + n];
+      kin.forwardKinematics(qn.data(), poses.data());
+      checksum += poses.back().p[0];
+    }
+  }
+  const double scalar_ns = std::chrono::duration<double, std::nano>(clock::now() - start).count() / (repeats * count);
+
+  std::vector<double> batch(12 * kin.bodyCount() * count);
+  start = clock::now();
+  for (int r = 0; r < repeats; ++r)
+  {
+    kin.forwardKinematicsBatch(count, q.data(), batch.data());
+    checksum += batch[12 * kin.bodyCount() * count - 1];
+  }
+  const double batch_ns = std::chrono::duration<double, std::nano>(clock::now() - start).count() / (repeats * count);
+
+  // incremental updates: one wrist joint, then one joint in the middle,
+  // changes before each query of the tip
+  urdf::ForwardKinematicsCache cache(kin);
+  cache.setConfiguration(q.data());
+  const std::size_t tip = kin.bodyCount() - 1;
+  const std::size_t wrist = kin.body(tip).q_offset, middle = kin.body(tip / 2).q_offset;
+  double incremental_ns[2];
+  for (int m = 0; m < 2; ++m)
+  {
+    const std::size_t k = m == 0 ? wrist : middle;
+    start = clock::now();
+    for (int r = 0; r < repeats; ++r)
+    {
+      for (std::size_t n = 0; n < count; ++n)
+      {
+        cache.setPosition(k, q[k * count + n]);
+        checksum += cache.pose(tip).p[0];
+      }
+    }
+    incremental_ns[m] = std::chrono::duration<double, std::nano>(clock::now() - start).count() / (repeats * count);
+  }
+
+  printf("%d dof, %zu configurations (checksum %g)\n", dofs, count, checksum);
+  printf("  scalar forwardKinematics:      %8.1f ns per configuration\n", scalar_ns);
+  printf("  forwardKinematicsBatch:        %8.1f ns per configuration (%.2fx)\n", batch_ns, scalar_ns / batch_ns);
+  printf("  cache, last joint changed:     %8.1f ns per query (%.2fx)\n", incremental_ns[0],
+         scalar_ns / incremental_ns[0]);
+  printf("  cache, middle joint changed:   %8.1f ns per query (%.2fx)\n", incremental_ns[1],
+         scalar_ns / incremental_ns[1]);
+  return 0;
+}
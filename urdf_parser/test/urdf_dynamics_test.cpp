@@ -0,0 +1,1007 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <clocale>
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "urdf_parser/dynamics.h"
+#include "urdf_parser/fixed_joint_lumping.h"
+#include "urdf_parser/independent_coordinates.h"
+#include "urdf_parser/loop_constraints.h"
+#include "urdf_parser/tree_factorization.h"
+#include "urdf_parser/urdf_parser.h"
+
+#define INERTIAL(m, xyz, rpy, ixx, ixy, ixz, iyy, iyz, izz) \
+  "<inertial><mass value=\"" #m "\"/><origin xyz=\"" xyz "\" rpy=\"" rpy "\"/>" \
+  "<inertia ixx=\"" #ixx "\" ixy=\"" #ixy "\" ixz=\"" #ixz "\" iyy=\"" #iyy "\" iyz=\"" #iyz "\" izz=\"" #izz "\"/></inertial>"
+
+// A floating torso with a leg whose knee is driven through a four bar
+// linkage (rocker, rod) and a geared hip (the motor is coupled to the
+// thigh), a prismatic slider on the torso and a planar cart on the world.
+//
+// world -> base (floating) -> torso -> hip (revolute) -> thigh -> knee (revolute) -> shank
+//                                  \-> motor (revolute) -> rotor
+//                                  \-> rocker (revolute) -> crank -> rod (revolute) -> link
+//                                  \-> slide (prismatic) -> slider
+//       -> cart (planar) -> carriage
+static const char *ROBOT =
+  "<robot name=\"leg\">"
+  "  <link name=\"world\"/>"
+  "  <link name=\"torso\">" INERTIAL(12.0, "0.01 0.02 0.1", "0.1 0.2 0.3", 0.4, 0.01, 0.02, 0.3, 0.03, 0.2) "</link>"
+  "  <link name=\"thigh\">" INERTIAL(2.0, "0 0 -0.15", "0 0 0", 0.03, 0, 0, 0.03, 0, 0.004) "</link>"
+  "  <link name=\"shank\">" INERTIAL(1.0, "0.01 0 -0.12", "0.2 0 0", 0.02, 0.001, 0, 0.02, 0, 0.002) "</link>"
+  "  <link name=\"rotor\">" INERTIAL(0.3, "0 0 0", "0 0 0", 0.001, 0, 0, 0.001, 0, 0.002) "</link>"
+  "  <link name=\"crank\">" INERTIAL(0.2, "0 0 -0.02", "0 0 0", 0.0002, 0, 0, 0.0002, 0, 0.0001) "</link>"
+  "  <link name=\"link\">" INERTIAL(0.3, "0 0 -0.15", "0 0.1 0", 0.002, 0, 0, 0.002, 0, 0.0002) "</link>"
+  "  <link name=\"slider\">" INERTIAL(0.5, "0.1 0 0", "0 0 0", 0.001, 0, 0, 0.002, 0, 0.002) "</link>"
+  "  <link name=\"carriage\">" INERTIAL(3.0, "0.2 0.1 0.05", "0 0 0.4", 0.05, 0, 0, 0.06, 0, 0.07) "</link>"
+  "  <joint name=\"base\" type=\"floating\"><parent link=\"world\"/><child link=\"torso\"/>"
+  "    <origin xyz=\"0 0 1\"/></joint>"
+  "  <joint name=\"hip\" type=\"revolute\"><parent link=\"torso\"/><child link=\"thigh\"/>"
+  "    <origin xyz=\"0 0.1 -0.1\" rpy=\"0.1 0 0\"/><axis xyz=\"0 1 0\"/>"
+  "    <limit effort=\"1\" velocity=\"1\" lower=\"-3\" upper=\"3\"/></joint>"
+  "  <joint name=\"knee\" type=\"revolute\" independent=\"false\"><parent link=\"thigh\"/><child link=\"shank\"/>"
+  "    <origin xyz=\"0 0 -0.3\"/><axis xyz=\"0 1 0\"/>"
+  "    <limit effort=\"1\" velocity=\"1\" lower=\"-3\" upper=\"3\"/></joint>"
+  "  <joint name=\"motor\" type=\"continuous\" independent=\"false\"><parent link=\"torso\"/><child link=\"rotor\"/>"
+  "    <origin xyz=\"0 0.05 -0.1\"/><axis xyz=\"0 1 0\"/></joint>"
+  "  <joint name=\"rocker\" type=\"revolute\"><parent link=\"torso\"/><child link=\"crank\"/>"
+  "    <origin xyz=\"0.05 0.1 -0.1\"/><axis xyz=\"0 1 0\"/>"
+  "    <limit effort=\"1\" velocity=\"1\" lower=\"-3\" upper=\"3\"/></joint>"
+  "  <joint name=\"rod\" type=\"revolute\" independent=\"false\"><parent link=\"crank\"/><child link=\"link\"/>"
+  "    <origin xyz=\"0.05 0 0\"/><axis xyz=\"0 1 0\"/>"
+  "    <limit effort=\"1\" velocity=\"1\" lower=\"-3\" upper=\"3\"/></joint>"
+  "  <joint name=\"slide\" type=\"prismatic\"><parent link=\"torso\"/><child link=\"slider\"/>"
+  "    <origin xyz=\"0 -0.1 0.2\" rpy=\"0 0.3 0\"/><axis xyz=\"1 0 1\"/>"
+  "    <limit effort=\"1\" velocity=\"1\" lower=\"-3\" upper=\"3\"/></joint>"
+  "  <joint name=\"cart\" type=\"planar\"><parent link=\"world\"/><child link=\"carriage\"/>"
+  "    <origin xyz=\"2 0 0\" rpy=\"0.2 0 0\"/><axis xyz=\"0 0 1\"/></joint>"
+  "  <loop name=\"four_bar\" type=\"revolute\">"
+  "    <predecessor link=\"shank\"><origin xyz=\"0.05 0 0\"/></predecessor>"
+  "    <successor link=\"link\"><origin xyz=\"0 0 -0.3\"/></successor>"
+  "    <axis xyz=\"0 1 0\"/>"
+  "  </loop>"
+  "  <coupling name=\"gear\">"
+  "    <predecessor link=\"thigh\"/>"
+  "    <successor link=\"rotor\"/>"
+  "    <ratio value=\"6\"/>"
+  "  </coupling>"
+  "</robot>";
+
+static std::vector<double> randomVector(std::size_t size, std::mt19937 &rng, double range)
+{
+  std::uniform_real_distribution<double> uniform(-range, range);
+  std::vector<double> x(size);
+  for (double &value : x)
+    value = uniform(rng);
+  return x;
+}
+
+// a random configuration with unit floating base quaternions
+static std::vector<double> randomConfiguration(const urdf::KinematicModel &kin, std::mt19937 &rng)
+{
+  std::vector<double> q = randomVector(kin.positionSize(), rng, 1.5);
+  for (std::size_t i = 0; i < kin.bodyCount(); ++i)
+  {
+    if (kin.body(i).type != urdf::Joint::FLOATING)
+      continue;
+    double *quaternion = &q[kin.body(i).q_offset + 3];
+    const double n = std::sqrt(quaternion[0] * quaternion[0] + quaternion[1] * quaternion[1] +
+                               quaternion[2] * quaternion[2] + quaternion[3] * quaternion[3]);
+    for (int k = 0; k < 4; ++k)
+      quaternion[k] /= n;
+  }
+  return q;
+}
+
+// Spatial momentum of every body about the root origin, in the root frame,
+// concatenated.
+static std::vector<double> momenta(const urdf::DynamicsModel &dyn, const std::vector<double> &q,
+                                   const std::vector<double> &v)
+{
+  const urdf::KinematicModel &kin = dyn.kinematics();
+  const std::size_t nv = kin.velocitySize();
+  std::vector<urdf::RigidTransform> poses(kin.bodyCount());
+  kin.forwardKinematics(q.data(), poses.data());
+  std::vector<double> h(6 * kin.bodyCount(), 0.0), J(6 * nv);
+  for (std::size_t i = 0; i < kin.bodyCount(); ++i)
+  {
+    const urdf::RigidTransform &X = poses[i];
+    const urdf::SpatialInertia &I = dyn.inertia(i);
+    if (I.mass == 0.0)
+      continue;
+    kin.jacobian(poses.data(), i, NULL, J.data());
+    double twist[6] = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+    for (int r = 0; r < 6; ++r)
+      for (std::size_t k = 0; k < nv; ++k)
+        twist[r] += J[r * nv + k] * v[k];
+
+    // body frame momentum, then moved to the root
+    double w[3], u[3];
+    for (int r = 0; r < 3; ++r)
+    {
+      w[r] = X.R[r] * twist[0] + X.R[3 + r] * twist[1] + X.R[6 + r] * twist[2];
+      u[r] = X.R[r] * twist[3] + X.R[3 + r] * twist[4] + X.R[6 + r] * twist[5];
+    }
+    const double Iw[3] = {I.I[0] * w[0] + I.I[1] * w[1] + I.I[2] * w[2],
+                          I.I[1] * w[0] + I.I[3] * w[1] + I.I[4] * w[2],
+                          I.I[2] * w[0] + I.I[4] * w[1] + I.I[5] * w[2]};
+    const double n[3] = {Iw[0] + I.h[1] * u[2] - I.h[2] * u[1],
+                         Iw[1] + I.h[2] * u[0] - I.h[0] * u[2],
+                         Iw[2] + I.h[0] * u[1] - I.h[1] * u[0]};
+    const double f[3] = {I.mass * u[0] + w[1] * I.h[2] - w[2] * I.h[1],
+                         I.mass * u[1] + w[2] * I.h[0] - w[0] * I.h[2],
+                         I.mass * u[2] + w[0] * I.h[1] - w[1] * I.h[0]};
+    double *hi = &h[6 * i];
+    for (int r = 0; r < 3; ++r)
+    {
+      hi[3 + r] = X.R[3 * r] * f[0] + X.R[3 * r + 1] * f[1] + X.R[3 * r + 2] * f[2];
+      hi[r] = X.R[3 * r] * n[0] + X.R[3 * r + 1] * n[1] + X.R[3 * r + 2] * n[2];
+    }
+    hi[0] += X.p[1] * hi[5] - X.p[2] * hi[4];
+    hi[1] += X.p[2] * hi[3] - X.p[0] * hi[5];
+    hi[2] += X.p[0] * hi[4] - X.p[1] * hi[3];
+  }
+  return h;
+}
+
+// Inverse dynamics from first principles: the force on each body is the
+// rate of change of its momentum minus gravity, and tau is the power of
+// these forces, J^T f, with the momentum rate by central differences from
+// the momenta hm and hp at -dt and dt.
+static std::vector<double> momentumRateForces(const urdf::DynamicsModel &dyn, const std::vector<double> &q,
+                                              const std::vector<double> &hm, const std::vector<double> &hp,
+                                              double dt)
+{
+  const urdf::KinematicModel &kin = dyn.kinematics();
+  const std::size_t nv = kin.velocitySize();
+  std::vector<urdf::RigidTransform> poses(kin.bodyCount());
+  kin.forwardKinematics(q.data(), poses.data());
+  std::vector<double> tau(nv, 0.0), J(6 * nv);
+  const double *g = dyn.gravity();
+  for (std::size_t i = 0; i < kin.bodyCount(); ++i)
+  {
+    const urdf::RigidTransform &X = poses[i];
+    const urdf::SpatialInertia &I = dyn.inertia(i);
+    double f[6];
+    for (int r = 0; r < 6; ++r)
+      f[r] = (hp[6 * i + r] - hm[6 * i + r]) / (2 * dt);
+    // gravity m g acts at the center of mass X.p + X.R h / m
+    double c[3];
+    for (int r = 0; r < 3; ++r)
+      c[r] = I.mass * X.p[r] + X.R[3 * r] * I.h[0] + X.R[3 * r + 1] * I.h[1] + X.R[3 * r + 2] * I.h[2];
+    f[0] -= c[1] * g[2] - c[2] * g[1];
+    f[1] -= c[2] * g[0] - c[0] * g[2];
+    f[2] -= c[0] * g[1] - c[1] * g[0];
+    for (int r = 0; r < 3; ++r)
+      f[3 + r] -= I.mass * g[r];
+
+    // Jacobian at the root origin
+    double origin[3];
+    for (int r = 0; r < 3; ++r)
+      origin[r] = -(X.R[r] * X.p[0] + X.R[3 + r] * X.p[1] + X.R[6 + r] * X.p[2]);
+    kin.jacobian(poses.data(), i, origin, J.data());
+    for (std::size_t k = 0; k < nv; ++k)
+      for (int r = 0; r < 6; ++r)
+        tau[k] += J[r * nv + k] * f[r];
+  }
+  return tau;
+}
+
+// The same along the trajectory of constant acceleration a.
+static std::vector<double> referenceInverseDynamics(const urdf::DynamicsModel &dyn, const std::vector<double> &q,
+                                                    const std::vector<double> &v, const std::vector<double> &a)
+{
+  const urdf::KinematicModel &kin = dyn.kinematics();
+  const std::size_t nv = kin.velocitySize();
+  const double dt = 1e-5;
+  std::vector<double> qp(q.size()), qm(q.size()), vp(nv), vm(nv), mid(nv);
+  for (std::size_t k = 0; k < nv; ++k)
+  {
+    vp[k] = v[k] + dt * a[k];
+    vm[k] = v[k] - dt * a[k];
+    mid[k] = v[k] + 0.5 * dt * a[k];
+  }
+  kin.integrate(q.data(), mid.data(), dt, qp.data());
+  for (std::size_t k = 0; k < nv; ++k)
+    mid[k] = v[k] - 0.5 * dt * a[k];
+  kin.integrate(q.data(), mid.data(), -dt, qm.data());
+  return momentumRateForces(dyn, q, momenta(dyn, qm, vm), momenta(dyn, qp, vp), dt);
+}
+
+TEST(URDF_DYNAMICS, clusters_and_inertias)
+{
+  urdf::ModelInterfaceSharedPtr model = urdf::parseURDF(ROBOT);
+  ASSERT_TRUE(model != nullptr);
+  urdf::DynamicsModel dyn;
+  ASSERT_TRUE(dyn.init(*model));
+  const urdf::KinematicModel &kin = dyn.kinematics();
+
+  // thigh, rotor, shank, crank and link form one cluster through the
+  // coupling and the loop
+  const std::size_t leg = dyn.clusterOf(kin.linkIndex("thigh"));
+  EXPECT_EQ(leg, dyn.clusterOf(kin.linkIndex("rotor")));
+  EXPECT_EQ(leg, dyn.clusterOf(kin.linkIndex("shank")));
+  EXPECT_EQ(leg, dyn.clusterOf(kin.linkIndex("link")));
+  EXPECT_EQ(leg, dyn.clusterOf(kin.linkIndex("crank")));
+  EXPECT_NE(leg, dyn.clusterOf(kin.linkIndex("slider")));
+  EXPECT_EQ(static_cast<int>(dyn.clusterOf(kin.linkIndex("torso"))), dyn.cluster(leg).parent);
+  EXPECT_EQ(5u, dyn.cluster(leg).end - dyn.cluster(leg).first);
+  EXPECT_EQ(5u, dyn.cluster(leg).v_size);
+  EXPECT_EQ(-1, dyn.cluster(0).parent);
+
+  // bodies are contiguous per cluster, parents first
+  for (std::size_t c = 0; c < dyn.clusterCount(); ++c)
+  {
+    if (c > 0)
+    {
+      EXPECT_LT(dyn.cluster(c).parent, static_cast<int>(c));
+    }
+    for (std::size_t s = dyn.cluster(c).first; s < dyn.cluster(c).end; ++s)
+    {
+      const std::size_t i = dyn.order()[s];
+      EXPECT_EQ(c, dyn.clusterOf(i));
+      EXPECT_EQ(s, dyn.slot(i));
+      if (i > 0)
+      {
+        EXPECT_LT(dyn.slot(kin.body(i).parent), s);
+      }
+    }
+  }
+
+  // parallel axis theorem with a rotated inertial frame
+  const urdf::SpatialInertia &shank = dyn.inertia(kin.linkIndex("shank"));
+  EXPECT_DOUBLE_EQ(1.0, shank.mass);
+  EXPECT_DOUBLE_EQ(0.01, shank.h[0]);
+  EXPECT_DOUBLE_EQ(-0.12, shank.h[2]);
+  EXPECT_NEAR(0.02 + 0.12 * 0.12, shank.I[0], 1e-12);
+  EXPECT_NEAR(0.001 * std::cos(0.2), shank.I[1], 1e-12);
+  EXPECT_NEAR(0.001 * std::sin(0.2) + 0.01 * 0.12, shank.I[2], 1e-12);
+  EXPECT_EQ(0.0, dyn.inertia(0).mass);
+}
+
+TEST(URDF_DYNAMICS, cluster_with_two_parent_clusters)
+{
+  urdf::ModelInterfaceSharedPtr model = urdf::parseURDF(ROBOT);
+  ASSERT_TRUE(model != nullptr);
+  // the carriage hangs off the world while the rest of the leg cluster
+  // hangs off the torso
+  model->containing_cluster_["carriage"] = model->containing_cluster_["thigh"];
+  urdf::DynamicsModel dyn;
+  EXPECT_FALSE(dyn.init(*model));
+  EXPECT_EQ(0u, dyn.clusterCount());
+
+  // a link of the root cluster below a child cluster
+  model->containing_cluster_["carriage"] = model->containing_cluster_["world"];
+  EXPECT_TRUE(dyn.init(*model));
+  model->containing_cluster_["slider"] = model->containing_cluster_["world"];
+  EXPECT_FALSE(dyn.init(*model));
+}
+
+TEST(URDF_DYNAMICS, inverse_dynamics_matches_momentum_rate)
+{
+  urdf::ModelInterfaceSharedPtr model = urdf::parseURDF(ROBOT);
+  ASSERT_TRUE(model != nullptr);
+  urdf::DynamicsModel dyn;
+  ASSERT_TRUE(dyn.init(*model));
+  const urdf::KinematicModel &kin = dyn.kinematics();
+  urdf::DynamicsData data(dyn);
+
+  std::mt19937 rng(11);
+  std::vector<double> tau(kin.velocitySize());
+  for (int trial = 0; trial < 10; ++trial)
+  {
+    const std::vector<double> q = randomConfiguration(kin, rng);
+    const std::vector<double> v = randomVector(kin.velocitySize(), rng, 2.0);
+    const std::vector<double> a = randomVector(kin.velocitySize(), rng, 5.0);
+    dyn.inverseDynamics(data, q.data(), v.data(), a.data(), tau.data());
+    const std::vector<double> expected = referenceInverseDynamics(dyn, q, v, a);
+    for (std::size_t k = 0; k < tau.size(); ++k)
+      EXPECT_NEAR(expected[k], tau[k], 1e-5 * (1.0 + std::fabs(expected[k]))) << k;
+  }
+
+  // static equilibrium: the floating base carries the full weight
+  std::vector<double> q(kin.positionSize()), zero(kin.velocitySize(), 0.0);
+  kin.neutralConfiguration(q.data());
+  dyn.inverseDynamics(data, q.data(), zero.data(), zero.data(), tau.data());
+  double mass = 0.0;
+  for (std::size_t i = 0; i < kin.bodyCount(); ++i)
+  {
+    if (dyn.clusterOf(i) != dyn.clusterOf(kin.linkIndex("carriage")))
+      mass += dyn.inertia(i).mass;
+  }
+  const std::size_t base = kin.body(kin.jointIndex("base")).v_offset;
+  EXPECT_NEAR(mass * 9.81, tau[base + 5], 1e-9);
+}
+
+TEST(URDF_DYNAMICS, gravity_torques_match_inverse_dynamics)
+{
+  urdf::ModelInterfaceSharedPtr model = urdf::parseURDF(ROBOT);
+  ASSERT_TRUE(model != nullptr);
+  urdf::DynamicsModel dyn;
+  ASSERT_TRUE(dyn.init(*model));
+  const urdf::KinematicModel &kin = dyn.kinematics();
+  urdf::DynamicsData data(dyn);
+  EXPECT_NEAR(12.0 + 2.0 + 1.0 + 0.3 + 0.2 + 0.3 + 0.5, dyn.subtreeMass(kin.linkIndex("torso")), 1e-12);
+  EXPECT_NEAR(1.0, dyn.subtreeMass(kin.linkIndex("shank")), 1e-12);
+
+  const double tilted[3] = {1.0, -2.0, -9.0};
+  dyn.setGravity(tilted);
+  std::mt19937 rng(17);
+  const std::size_t nv = kin.velocitySize();
+  std::vector<double> tau(nv), expected(nv), zero(nv, 0.0);
+  for (int trial = 0; trial < 5; ++trial)
+  {
+    const std::vector<double> q = randomConfiguration(kin, rng);
+    dyn.inverseDynamics(data, q.data(), zero.data(), zero.data(), expected.data());
+    dyn.gravityTorques(data, q.data(), tau.data());
+    for (std::size_t k = 0; k < nv; ++k)
+      EXPECT_NEAR(expected[k], tau[k], 1e-12) << k;
+  }
+}
+
+TEST(URDF_DYNAMICS, forward_dynamics_inverts_inverse_dynamics)
+{
+  urdf::ModelInterfaceSharedPtr model = urdf::parseURDF(ROBOT);
+  ASSERT_TRUE(model != nullptr);
+  urdf::DynamicsModel dyn;
+  ASSERT_TRUE(dyn.init(*model));
+  const urdf::KinematicModel &kin = dyn.kinematics();
+  urdf::DynamicsData data(dyn);
+
+  // the floating torso and the planar carriage included; the loop and the
+  // coupling are ignored by both
+  std::mt19937 rng(31);
+  const std::size_t nv = kin.velocitySize();
+  std::vector<double> a(nv), tau_back(nv);
+  for (int trial = 0; trial < 5; ++trial)
+  {
+    const std::vector<double> q = randomConfiguration(kin, rng);
+    const std::vector<double> v = randomVector(nv, rng, 2.0), tau = randomVector(nv, rng, 5.0);
+    ASSERT_TRUE(dyn.forwardDynamics(data, q.data(), v.data(), tau.data(), a.data()));
+    dyn.inverseDynamics(data, q.data(), v.data(), a.data(), tau_back.data());
+    for (std::size_t k = 0; k < nv; ++k)
+      EXPECT_NEAR(tau[k], tau_back[k], 1e-9) << k;
+  }
+
+  // a joint moving nothing has no acceleration to solve for
+  urdf::ModelInterfaceSharedPtr massless = urdf::parseURDF(
+    "<robot name=\"r\"><link name=\"a\"/><link name=\"b\"/>"
+    "<joint name=\"j\" type=\"continuous\"><parent link=\"a\"/><child link=\"b\"/></joint></robot>");
+  ASSERT_TRUE(massless != nullptr);
+  urdf::DynamicsModel empty;
+  ASSERT_TRUE(empty.init(*massless));
+  urdf::DynamicsData empty_data(empty);
+  double zero = 0.0, acceleration;
+  EXPECT_FALSE(empty.forwardDynamics(empty_data, &zero, &zero, &zero, &acceleration));
+}
+
+TEST(URDF_DYNAMICS, center_of_mass_and_jacobian)
+{
+  urdf::ModelInterfaceSharedPtr model = urdf::parseURDF(ROBOT);
+  ASSERT_TRUE(model != nullptr);
+  urdf::DynamicsModel dyn;
+  ASSERT_TRUE(dyn.init(*model));
+  const urdf::KinematicModel &kin = dyn.kinematics();
+  urdf::DynamicsData data(dyn);
+  EXPECT_NEAR(12.0 + 2.0 + 1.0 + 0.3 + 0.2 + 0.3 + 0.5 + 3.0, dyn.totalMass(), 1e-12);
+
+  // the mass weighted average of the link centers of mass and of their
+  // point Jacobians
+  std::mt19937 rng(29);
+  const std::size_t nv = kin.velocitySize();
+  std::vector<urdf::RigidTransform> poses(kin.bodyCount());
+  std::vector<double> J(3 * nv), Ji(6 * nv);
+  for (int trial = 0; trial < 5; ++trial)
+  {
+    const std::vector<double> q = randomConfiguration(kin, rng);
+    kin.forwardKinematics(q.data(), poses.data());
+    double expected[3] = {0.0, 0.0, 0.0};
+    std::vector<double> expected_J(3 * nv, 0.0);
+    for (std::size_t i = 0; i < kin.bodyCount(); ++i)
+    {
+      const urdf::SpatialInertia &I = dyn.inertia(i);
+      if (I.mass == 0.0)
+        continue;
+      const urdf::RigidTransform &X = poses[i];
+      const double c[3] = {I.h[0] / I.mass, I.h[1] / I.mass, I.h[2] / I.mass};
+      for (int r = 0; r < 3; ++r)
+        expected[r] += I.mass * (X.p[r] + X.R[3 * r] * c[0] + X.R[3 * r + 1] * c[1] + X.R[3 * r + 2] * c[2]);
+      kin.jacobian(poses.data(), i, c, Ji.data());
+      for (int r = 0; r < 3; ++r)
+        for (std::size_t k = 0; k < nv; ++k)
+          expected_J[r * nv + k] += I.mass * Ji[(3 + r) * nv + k];
+    }
+
+    double com[3];
+    dyn.centerOfMass(data, q.data(), com, J.data());
+    for (int r = 0; r < 3; ++r)
+    {
+      EXPECT_NEAR(expected[r] / dyn.totalMass(), com[r], 1e-12) << r;
+      for (std::size_t k = 0; k < nv; ++k)
+        EXPECT_NEAR(expected_J[r * nv + k] / dyn.totalMass(), J[r * nv + k], 1e-12) << r << " " << k;
+    }
+    double alone[3];
+    dyn.centerOfMass(data, q.data(), alone);
+    for (int r = 0; r < 3; ++r)
+      EXPECT_EQ(com[r], alone[r]);
+  }
+}
+
+TEST(URDF_DYNAMICS, regressor_matches_inverse_dynamics)
+{
+  urdf::ModelInterfaceSharedPtr model = urdf::parseURDF(ROBOT);
+  ASSERT_TRUE(model != nullptr);
+  urdf::DynamicsModel dyn;
+  ASSERT_TRUE(dyn.init(*model));
+  const urdf::KinematicModel &kin = dyn.kinematics();
+  urdf::DynamicsData data(dyn);
+  const std::size_t nq = kin.positionSize(), nv = kin.velocitySize(), np = 10 * kin.bodyCount();
+  std::vector<double> pi(np);
+  dyn.inertialParameters(pi.data());
+
+  std::mt19937 rng(23);
+  const std::size_t count = 6;
+  std::vector<double> q, v, a;
+  for (std::size_t n = 0; n < count; ++n)
+  {
+    const std::vector<double> qn = randomConfiguration(kin, rng);
+    const std::vector<double> vn = randomVector(nv, rng, 2.0), an = randomVector(nv, rng, 3.0);
+    q.insert(q.end(), qn.begin(), qn.end());
+    v.insert(v.end(), vn.begin(), vn.end());
+    a.insert(a.end(), an.begin(), an.end());
+  }
+  std::vector<double> Y(count * nv * np), batch(count * nv * np, 1.0), tau(nv);
+  for (std::size_t n = 0; n < count; ++n)
+  {
+    double *Yn = &Y[n * nv * np];
+    dyn.regressor(data, &q[n * nq], &v[n * nv], &a[n * nv], Yn);
+    dyn.inverseDynamics(data, &q[n * nq], &v[n * nv], &a[n * nv], tau.data());
+    for (std::size_t k = 0; k < nv; ++k)
+    {
+      double sum = 0.0;
+      for (std::size_t p = 0; p < np; ++p)
+        sum += Yn[k * np + p] * pi[p];
+      EXPECT_NEAR(tau[k], sum, 1e-9) << k;
+    }
+  }
+  dyn.regressors(count, q.data(), v.data(), a.data(), batch.data(), 3);
+  for (std::size_t k = 0; k < Y.size(); ++k)
+    EXPECT_EQ(Y[k], batch[k]) << k;
+
+  // parameters written back to the model compile to the same inertias
+  std::vector<double> scaled(pi);
+  for (std::size_t p = 0; p < np; ++p)
+    scaled[p] *= 1.5;
+  ASSERT_TRUE(dyn.writeInertialParameters(scaled.data(), *model));
+  urdf::DynamicsModel again;
+  ASSERT_TRUE(again.init(*model));
+  std::vector<double> read(np);
+  again.inertialParameters(read.data());
+  for (std::size_t p = 0; p < np; ++p)
+    EXPECT_NEAR(scaled[p], read[p], 1e-12) << p;
+  EXPECT_NEAR(1.5 * dyn.subtreeMass(0), again.subtreeMass(0), 1e-12);
+  dyn.setInertialParameters(scaled.data());
+  EXPECT_NEAR(again.subtreeMass(0), dyn.subtreeMass(0), 1e-12);
+
+  scaled[10 * kin.linkIndex("shank")] = 0.0;
+  EXPECT_FALSE(dyn.writeInertialParameters(scaled.data(), *model));
+}
+
+TEST(URDF_DYNAMICS, mass_matrix_matches_inverse_dynamics)
+{
+  urdf::ModelInterfaceSharedPtr model = urdf::parseURDF(ROBOT);
+  ASSERT_TRUE(model != nullptr);
+  urdf::DynamicsModel dyn;
+  ASSERT_TRUE(dyn.init(*model));
+  const urdf::KinematicModel &kin = dyn.kinematics();
+  const std::size_t nv = kin.velocitySize();
+  urdf::DynamicsData data(dyn);
+  urdf::ClusterBlockMatrix M(dyn);
+  EXPECT_EQ(nv, M.size());
+  EXPECT_LT(M.valueCount(), nv * nv);
+
+  // the leg cluster couples with the torso and the world, not the cart
+  const std::size_t leg = dyn.clusterOf(kin.linkIndex("thigh"));
+  ASSERT_EQ(3u, M.blockCount(leg));
+  EXPECT_EQ(leg, M.blockColumn(leg, 0));
+  EXPECT_EQ(0u, M.blockColumn(leg, 2));
+
+  std::mt19937 rng(5);
+  std::vector<double> dense(nv * nv), bias(nv), column(nv), zero(nv, 0.0), unit(nv, 0.0), y(nv);
+  for (int trial = 0; trial < 5; ++trial)
+  {
+    const std::vector<double> q = randomConfiguration(kin, rng);
+    dyn.massMatrix(data, q.data(), M);
+    M.toDense(dense.data());
+
+    // column k of M is the change of tau for a unit acceleration of k
+    dyn.inverseDynamics(data, q.data(), zero.data(), zero.data(), bias.data());
+    for (std::size_t k = 0; k < nv; ++k)
+    {
+      unit[k] = 1.0;
+      dyn.inverseDynamics(data, q.data(), zero.data(), unit.data(), column.data());
+      unit[k] = 0.0;
+      for (std::size_t r = 0; r < nv; ++r)
+        EXPECT_NEAR(column[r] - bias[r], dense[r * nv + k], 1e-10) << r << " " << k;
+    }
+
+    const std::vector<double> x = randomVector(nv, rng, 1.0);
+    M.multiply(x.data(), y.data());
+    for (std::size_t r = 0; r < nv; ++r)
+    {
+      double expected = 0.0;
+      for (std::size_t k = 0; k < nv; ++k)
+        expected += dense[r * nv + k] * x[k];
+      EXPECT_NEAR(expected, y[r], 1e-12);
+    }
+  }
+}
+
+TEST(URDF_DYNAMICS, independent_coordinate_map)
+{
+  urdf::ModelInterfaceSharedPtr model = urdf::parseURDF(ROBOT);
+  ASSERT_TRUE(model != nullptr);
+  urdf::DynamicsModel dyn;
+  ASSERT_TRUE(dyn.init(*model));
+  const urdf::KinematicModel &kin = dyn.kinematics();
+  urdf::LoopConstraintModel loops;
+  ASSERT_TRUE(loops.init(*model, kin));
+  urdf::IndependentCoordinateMap map;
+  ASSERT_TRUE(map.init(*model, dyn, loops));
+
+  // knee, motor and rod are dependent: the motor through the gear, the
+  // others through the four bar loop
+  const std::size_t nv = kin.velocitySize(), ni = map.independentSize();
+  EXPECT_EQ(nv, map.spanningSize());
+  EXPECT_EQ(nv - 3, ni);
+  const std::size_t leg = dyn.clusterOf(kin.linkIndex("thigh"));
+  EXPECT_EQ(5u, map.block(leg).span_size);
+  EXPECT_EQ(2u, map.block(leg).ind_size);
+  const std::size_t hip = kin.body(kin.jointIndex("hip")).v_offset;
+  const std::size_t knee = kin.body(kin.jointIndex("knee")).v_offset;
+  const std::size_t motor = kin.body(kin.jointIndex("motor")).v_offset;
+  const std::size_t rocker = kin.body(kin.jointIndex("rocker")).v_offset;
+  const std::size_t rod = kin.body(kin.jointIndex("rod")).v_offset;
+
+  std::mt19937 rng(7);
+  std::vector<urdf::RigidTransform> poses(kin.bodyCount());
+  std::vector<double> K(loops.rowCount() * nv), x(nv), y(ni), back(ni);
+  for (int trial = 0; trial < 5; ++trial)
+  {
+    const std::vector<double> q = randomConfiguration(kin, rng);
+    kin.forwardKinematics(q.data(), poses.data());
+    ASSERT_TRUE(map.update(loops, poses.data(), q.data()));
+
+    // G y follows the gear, keeps the independent coordinates and moves
+    // tangent to the loop, in the least squares sense as the tilted hip
+    // makes it spatial
+    const std::vector<double> yr = randomVector(ni, rng, 1.0);
+    map.apply(yr.data(), x.data());
+    EXPECT_NEAR(6.0 * x[hip], x[motor], 1e-12);
+    map.gather(x.data(), y.data());
+    for (std::size_t i = 0; i < ni; ++i)
+      EXPECT_NEAR(yr[i], y[i], 1e-12);
+    loops.jacobian(poses.data(), K.data());
+    double knee_residual = 0.0, rod_residual = 0.0;
+    for (std::size_t r = 0; r < loops.rowCount(); ++r)
+    {
+      double rate = 0.0;
+      for (std::size_t k = 0; k < nv; ++k)
+        rate += K[r * nv + k] * x[k];
+      knee_residual += K[r * nv + knee] * rate;
+      rod_residual += K[r * nv + rod] * rate;
+    }
+    EXPECT_NEAR(0.0, knee_residual, 1e-12);
+    EXPECT_NEAR(0.0, rod_residual, 1e-12);
+
+    // the transpose, and the batched kernels
+    const std::vector<double> f = randomVector(nv, rng, 1.0);
+    map.applyTranspose(f.data(), back.data());
+    double xf = 0.0, yb = 0.0;
+    for (std::size_t k = 0; k < nv; ++k)
+      xf += x[k] * f[k];
+    for (std::size_t i = 0; i < ni; ++i)
+      yb += yr[i] * back[i];
+    EXPECT_NEAR(xf, yb, 1e-12);
+    const std::size_t count = 3;
+    const std::vector<double> ys = randomVector(count * ni, rng, 1.0), fs = randomVector(count * nv, rng, 1.0);
+    std::vector<double> xs(count * nv), bs(count * ni);
+    map.apply(count, ys.data(), xs.data());
+    map.applyTranspose(count, fs.data(), bs.data());
+    for (std::size_t n = 0; n < count; ++n)
+    {
+      map.apply(&ys[n * ni], x.data());
+      map.applyTranspose(&fs[n * nv], back.data());
+      for (std::size_t k = 0; k < nv; ++k)
+        EXPECT_EQ(x[k], xs[n * nv + k]);
+      for (std::size_t i = 0; i < ni; ++i)
+        EXPECT_EQ(back[i], bs[n * ni + i]);
+    }
+
+    // the affine map reproduces the loop coordinates at the linearization
+    // point
+    std::fill(y.begin(), y.end(), 0.0);
+    for (std::size_t i = 0; i < ni; ++i)
+    {
+      const std::size_t k = map.independentCoordinates()[i];
+      if (k == hip || k == rocker)
+        y[i] = q[kin.body(k == hip ? kin.jointIndex("hip") : kin.jointIndex("rocker")).q_offset];
+    }
+    map.applyAffine(y.data(), x.data());
+    EXPECT_NEAR(q[kin.body(kin.jointIndex("knee")).q_offset], x[knee], 1e-12);
+    EXPECT_NEAR(q[kin.body(kin.jointIndex("rod")).q_offset], x[rod], 1e-12);
+  }
+}
+
+// Two planar four bar linkages on a floating body, each with a crank, a
+// coupler and a rocker closed by a loop, and a rotor geared to the crank.
+static std::string linkages()
+{
+  std::string xml = "<robot name=\"linkages\"><link name=\"world\"/>"
+                    "<link name=\"body\">" INERTIAL(4.0, "0.1 0 0.05", "0 0 0", 0.05, 0, 0, 0.08, 0, 0.06) "</link>"
+                    "<joint name=\"base\" type=\"floating\"><parent link=\"world\"/><child link=\"body\"/></joint>";
+  const char *sides[2] = {"left", "right"};
+  for (int k = 0; k < 2; ++k)
+  {
+    const std::string side = sides[k], y = k == 0 ? "0.2" : "-0.2";
+    const std::string limit = "<limit effort=\"1\" velocity=\"1\" lower=\"-10\" upper=\"10\"/>";
+    xml += "<link name=\"" + side + "_crank\">" INERTIAL(0.3, "0 0 0.05", "0 0 0", 0.0003, 0, 0, 0.0003, 0, 0.0001)
+           "</link><link name=\"" + side + "_coupler\">" INERTIAL(0.2, "0.1 0 0.15", "0 0.3 0", 0.002, 0, 0, 0.002, 0, 0.0002)
+           "</link><link name=\"" + side + "_rocker\">" INERTIAL(0.4, "0 0 0.12", "0 0 0", 0.002, 0, 0, 0.002, 0, 0.0001)
+           "</link><link name=\"" + side + "_rotor\">" INERTIAL(0.1, "0 0 0", "0 0 0", 0.0001, 0, 0, 0.0002, 0, 0.0001)
+           "</link>"
+           "<joint name=\"" + side + "_crank\" type=\"revolute\"><parent link=\"body\"/>"
+           "<child link=\"" + side + "_crank\"/><origin xyz=\"0 " + y + " 0\"/><axis xyz=\"0 1 0\"/>" + limit +
+           "</joint><joint name=\"" + side + "_coupler\" type=\"revolute\" independent=\"false\">"
+           "<parent link=\"" + side + "_crank\"/><child link=\"" + side + "_coupler\"/>"
+           "<origin xyz=\"0 0 0.1\"/><axis xyz=\"0 1 0\"/>" + limit +
+           "</joint><joint name=\"" + side + "_rocker\" type=\"revolute\" independent=\"false\">"
+           "<parent link=\"body\"/><child link=\"" + side + "_rocker\"/>"
+           "<origin xyz=\"0.25 " + y + " 0\"/><axis xyz=\"0 1 0\"/>" + limit +
+           "</joint><joint name=\"" + side + "_motor\" type=\"continuous\" independent=\"false\">"
+           "<parent link=\"body\"/><child link=\"" + side + "_rotor\"/>"
+           "<origin xyz=\"0 " + y + " 0.1\"/><axis xyz=\"0 1 0\"/></joint>"
+           "<loop name=\"" + side + "_loop\" type=\"revolute\">"
+           "<predecessor link=\"" + side + "_rocker\"><origin xyz=\"0 0 0.25\"/></predecessor>"
+           "<successor link=\"" + side + "_coupler\"><origin xyz=\"0 0 0.3\"/></successor>"
+           "<axis xyz=\"0 1 0\"/></loop>"
+           "<coupling name=\"" + side + "_gear\"><predecessor link=\"" + side + "_crank\"/>"
+           "<successor link=\"" + side + "_rotor\"/><ratio value=\"3\"/></coupling>";
+  }
+  return xml + "</robot>";
+}
+
+TEST(URDF_DYNAMICS, close_loops)
+{
+  urdf::ModelInterfaceSharedPtr model = urdf::parseURDF(linkages());
+  ASSERT_TRUE(model != nullptr);
+  urdf::DynamicsModel dyn;
+  ASSERT_TRUE(dyn.init(*model));
+  const urdf::KinematicModel &kin = dyn.kinematics();
+  urdf::LoopConstraintModel loops;
+  ASSERT_TRUE(loops.init(*model, kin));
+  urdf::IndependentCoordinateMap map;
+  ASSERT_TRUE(map.init(*model, dyn, loops));
+  const std::size_t nv = kin.velocitySize();
+  EXPECT_EQ(6u + 2u, map.independentSize());
+
+  std::mt19937 rng(9);
+  std::vector<double> q = randomConfiguration(kin, rng), v = randomVector(nv, rng, 1.0);
+  std::vector<urdf::RigidTransform> poses(kin.bodyCount()), reference(kin.bodyCount());
+  urdf::LoopClosureStatus status;
+  ASSERT_TRUE(map.closeLoops(dyn, loops, q.data(), v.data(), poses.data(), urdf::LoopClosureOptions(), &status));
+  EXPECT_GT(status.iterations, 0u);
+
+  // the loops are closed, the gears followed and the poses those of q
+  std::vector<double> phi(loops.rowCount()), K(loops.rowCount() * nv);
+  kin.forwardKinematics(q.data(), reference.data());
+  loops.residual(reference.data(), phi.data());
+  for (double value : phi)
+    EXPECT_NEAR(0.0, value, 1e-10);
+  for (std::size_t i = 0; i < kin.bodyCount(); ++i)
+    for (int k = 0; k < 3; ++k)
+      EXPECT_NEAR(reference[i].p[k], poses[i].p[k], 1e-12);
+  const std::size_t crank = kin.jointIndex("left_crank"), motor = kin.jointIndex("left_motor");
+  EXPECT_NEAR(3.0 * q[kin.body(crank).q_offset], q[kin.body(motor).q_offset], 1e-12);
+  EXPECT_NEAR(3.0 * v[kin.body(crank).v_offset], v[kin.body(motor).v_offset], 1e-12);
+  loops.jacobian(reference.data(), K.data());
+  for (std::size_t r = 0; r < loops.rowCount(); ++r)
+  {
+    double rate = 0.0;
+    for (std::size_t k = 0; k < nv; ++k)
+      rate += K[r * nv + k] * v[k];
+    EXPECT_NEAR(0.0, rate, 1e-10);
+  }
+
+  // a small move of the cranks warm starts from the last solution, and a
+  // closed configuration is left as it is
+  for (const char *name : {"left_crank", "right_crank"})
+    q[kin.body(kin.jointIndex(name)).q_offset] += 0.01;
+  ASSERT_TRUE(map.closeLoops(dyn, loops, q.data(), v.data(), poses.data(), urdf::LoopClosureOptions(), &status));
+  EXPECT_LE(status.iterations, 4u);
+  std::vector<double> qt = q, vt = v;
+  ASSERT_TRUE(map.closeLoops(dyn, loops, qt.data(), vt.data(), poses.data(), urdf::LoopClosureOptions(), &status));
+  EXPECT_EQ(0u, status.iterations);
+  for (std::size_t k = 0; k < q.size(); ++k)
+    EXPECT_EQ(q[k], qt[k]);
+  for (std::size_t k = 0; k < nv; ++k)
+    EXPECT_NEAR(v[k], vt[k], 1e-12);
+}
+
+TEST(URDF_DYNAMICS, constrained_inverse_dynamics_matches_momentum_rate)
+{
+  urdf::ModelInterfaceSharedPtr model = urdf::parseURDF(linkages());
+  ASSERT_TRUE(model != nullptr);
+  urdf::DynamicsModel dyn;
+  ASSERT_TRUE(dyn.init(*model));
+  const urdf::KinematicModel &kin = dyn.kinematics();
+  urdf::DynamicsData data(dyn);
+  urdf::LoopConstraintModel loops;
+  ASSERT_TRUE(loops.init(*model, kin));
+  urdf::IndependentCoordinateMap map;
+  ASSERT_TRUE(map.init(*model, dyn, loops));
+  const std::size_t nv = kin.velocitySize(), ni = map.independentSize();
+  urdf::LoopClosureOptions options;
+  options.tolerance = 1e-12;
+
+  std::mt19937 rng(13);
+  std::vector<urdf::RigidTransform> poses(kin.bodyCount());
+  std::vector<double> q(kin.positionSize()), v(nv, 0.0), tau(ni), expected(ni), mid(nv);
+  kin.neutralConfiguration(q.data());
+  const std::size_t base = kin.body(kin.jointIndex("base")).q_offset;
+  for (int trial = 0; trial < 5; ++trial)
+  {
+    // a random base and the cranks moved from the last closed
+    // configuration, which warm starts the loop closure
+    const std::vector<double> random = randomConfiguration(kin, rng);
+    std::copy(random.begin() + base, random.begin() + base + 7, q.begin() + base);
+    for (const char *name : {"left_crank", "right_crank"})
+    {
+      const std::size_t k = kin.body(kin.jointIndex(name)).q_offset;
+      q[k] += 0.2 * random[k];
+    }
+    ASSERT_TRUE(map.closeLoops(dyn, loops, q.data(), v.data(), poses.data(), options));
+    const std::vector<double> yd = randomVector(ni, rng, 2.0), ydd = randomVector(ni, rng, 5.0);
+
+    // the trajectory of constant independent acceleration, with the loops
+    // closed at -dt and dt
+    const double dt = 1e-5;
+    std::vector<double> h[2];
+    for (int side = 0; side < 2; ++side)
+    {
+      const double t = side == 0 ? -dt : dt;
+      std::vector<double> y(ni), qt(q.size()), vt(nv);
+      for (std::size_t i = 0; i < ni; ++i)
+        y[i] = yd[i] + 0.5 * t * ydd[i];
+      map.apply(y.data(), mid.data());
+      kin.integrate(q.data(), mid.data(), t, qt.data());
+      for (std::size_t i = 0; i < ni; ++i)
+        vt[map.independentCoordinates()[i]] = yd[i] + t * ydd[i];
+      ASSERT_TRUE(map.closeLoops(dyn, loops, qt.data(), vt.data(), poses.data(), options));
+      h[side] = momenta(dyn, qt, vt);
+    }
+    const std::vector<double> reference = momentumRateForces(dyn, q, h[0], h[1], dt);
+
+    ASSERT_TRUE(map.inverseDynamics(dyn, loops, data, q.data(), yd.data(), ydd.data(), tau.data()));
+    map.applyTranspose(reference.data(), expected.data());
+    for (std::size_t i = 0; i < ni; ++i)
+      EXPECT_NEAR(expected[i], tau[i], 1e-5 * (1.0 + std::fabs(expected[i]))) << i;
+  }
+}
+
+TEST(URDF_DYNAMICS, tree_factorization)
+{
+  urdf::ModelInterfaceSharedPtr model = urdf::parseURDF(ROBOT);
+  ASSERT_TRUE(model != nullptr);
+  urdf::DynamicsModel dyn;
+  ASSERT_TRUE(dyn.init(*model));
+  const urdf::KinematicModel &kin = dyn.kinematics();
+  const std::size_t nv = kin.velocitySize();
+  urdf::DynamicsData data(dyn);
+  urdf::ClusterBlockMatrix M(dyn);
+  urdf::TreeFactorization L(dyn);
+  ASSERT_EQ(nv, L.size());
+  EXPECT_LT(L.valueCount(), nv * (nv + 1) / 2);
+
+  // the knee coordinate descends from the hip and the six base coordinates
+  const std::size_t base = kin.body(kin.jointIndex("base")).v_offset;
+  const std::size_t hip = kin.body(kin.jointIndex("hip")).v_offset;
+  const std::size_t knee = kin.body(kin.jointIndex("knee")).v_offset;
+  EXPECT_EQ(static_cast<int>(hip), L.parent(knee));
+  EXPECT_EQ(static_cast<int>(base + 5), L.parent(hip));
+  EXPECT_EQ(7u, L.depth(knee));
+  EXPECT_EQ(-1, L.parent(kin.body(kin.jointIndex("cart")).v_offset));
+
+  std::mt19937 rng(13);
+  std::vector<double> dense(nv * nv), product(nv);
+  for (int trial = 0; trial < 3; ++trial)
+  {
+    const std::vector<double> q = randomConfiguration(kin, rng);
+    dyn.massMatrix(data, q.data(), M);
+    M.toDense(dense.data());
+    const std::vector<double> b = randomVector(nv, rng, 1.0);
+
+    for (int mode = 0; mode < 3; ++mode)
+    {
+      if (mode == 0)
+        ASSERT_TRUE(L.factorLTL(M));
+      else if (mode == 1)
+        ASSERT_TRUE(L.factorLTDL(M));
+      else
+        ASSERT_TRUE(L.factorLTDL(dense.data()));
+
+      // M x = b
+      std::vector<double> x = b;
+      L.solve(x.data());
+      M.multiply(x.data(), product.data());
+      for (std::size_t k = 0; k < nv; ++k)
+        EXPECT_NEAR(b[k], product[k], 1e-9) << mode;
+
+      // L^T D L rebuilt from the rows matches M
+      std::vector<double> Ld(nv * nv, 0.0), D(nv, 1.0);
+      for (std::size_t k = 0; k < nv; ++k)
+      {
+        const double *row = L.row(k);
+        Ld[k * nv + k] = mode == 0 ? row[0] : 1.0;
+        if (mode > 0)
+          D[k] = row[0];
+        int a = L.parent(k);
+        for (std::size_t e = 1; e <= L.depth(k); ++e, a = L.parent(a))
+          Ld[k * nv + a] = row[e];
+      }
+      for (std::size_t i = 0; i < nv; ++i)
+        for (std::size_t j = 0; j < nv; ++j)
+        {
+          double sum = 0.0;
+          for (std::size_t k = 0; k < nv; ++k)
+            sum += Ld[k * nv + i] * D[k] * Ld[k * nv + j];
+          EXPECT_NEAR(dense[i * nv + j], sum, 1e-10);
+        }
+    }
+  }
+
+  // a matrix that is not positive definite is refused
+  std::fill(dense.begin(), dense.end(), 0.0);
+  EXPECT_FALSE(L.factorLTL(dense.data()));
+}
+
+// ROBOT with a sensor on the torso, a flange and tool chain on the shank
+// carrying a spinning bit, a mount on the world and a loop closed on the
+// tool, all but the bit joint fixed
+static std::string sensorMounts()
+{
+  std::string xml = ROBOT;
+  xml.replace(xml.find("</robot>"), std::string("</robot>").size(),
+    "  <link name=\"imu\">" INERTIAL(0.1, "0.01 0 0", "0.3 0 0.2", 0.0001, 0, 0, 0.0002, 0, 0.0003) "</link>"
+    "  <link name=\"flange\">" INERTIAL(0.4, "0 0.01 -0.01", "0 0.5 0", 0.001, 0, 0, 0.001, 0, 0.002) "</link>"
+    "  <link name=\"tool\">" INERTIAL(0.6, "0 0 -0.05", "0.2 0.1 0", 0.003, 0, 0, 0.002, 0.0001, 0.001) "</link>"
+    "  <link name=\"bit\">" INERTIAL(0.05, "0 0 -0.01", "0 0 0", 0.00001, 0, 0, 0.00001, 0, 0.00002) "</link>"
+    "  <link name=\"mount\"/>"
+    "  <joint name=\"imu_joint\" type=\"fixed\"><parent link=\"torso\"/><child link=\"imu\"/>"
+    "    <origin xyz=\"0 0.05 0.2\" rpy=\"0.1 -0.2 0.3\"/></joint>"
+    "  <joint name=\"flange_joint\" type=\"fixed\"><parent link=\"shank\"/><child link=\"flange\"/>"
+    "    <origin xyz=\"0 0 -0.3\" rpy=\"0 0 0.5\"/></joint>"
+    "  <joint name=\"tool_joint\" type=\"fixed\"><parent link=\"flange\"/><child link=\"tool\"/>"
+    "    <origin xyz=\"0.02 0 -0.03\" rpy=\"0.4 0 0\"/></joint>"
+    "  <joint name=\"spin\" type=\"continuous\"><parent link=\"tool\"/><child link=\"bit\"/>"
+    "    <origin xyz=\"0 0 -0.1\" rpy=\"0 0.2 0\"/><axis xyz=\"0 0 1\"/></joint>"
+    "  <joint name=\"mount_joint\" type=\"fixed\"><parent link=\"world\"/><child link=\"mount\"/>"
+    "    <origin xyz=\"1 2 0\"/></joint>"
+    "  <loop name=\"tool_loop\" type=\"revolute\">"
+    "    <predecessor link=\"tool\"><origin xyz=\"0.01 0 0\" rpy=\"0 0 0.3\"/></predecessor>"
+    "    <successor link=\"slider\"><origin xyz=\"0 0.1 0\"/></successor>"
+    "    <axis xyz=\"1 0 0\"/>"
+    "  </loop>"
+    "</robot>");
+  return xml;
+}
+
+TEST(URDF_DYNAMICS, fixed_joint_lumping)
+{
+  urdf::ModelInterfaceSharedPtr model = urdf::parseURDF(sensorMounts());
+  ASSERT_TRUE(model != nullptr);
+  urdf::FrameTable frames;
+  urdf::ModelInterfaceSharedPtr reduced = urdf::lumpFixedJoints(*model, frames);
+  ASSERT_TRUE(reduced != nullptr);
+  EXPECT_EQ(model->links_.size(), frames.frameCount());
+  EXPECT_EQ(model->links_.size() - 4, reduced->links_.size());
+  EXPECT_TRUE(reduced->getJoint("spin") != nullptr);
+  EXPECT_TRUE(reduced->getJoint("tool_joint") == nullptr);
+  EXPECT_EQ("shank", frames.frame(frames.frameIndex("tool")).link);
+  EXPECT_EQ("world", frames.frame(frames.frameIndex("mount")).link);
+  EXPECT_EQ("shank", reduced->getConstraint("tool_loop")->predecessor_link_name);
+  EXPECT_EQ(frames.frameCount(), frames.frameIndex("nowhere"));
+
+  urdf::DynamicsModel full, lumped;
+  ASSERT_TRUE(full.init(*model));
+  ASSERT_TRUE(lumped.init(*reduced));
+  const urdf::KinematicModel &kin = full.kinematics(), &small = lumped.kinematics();
+  ASSERT_TRUE(frames.bind(small));
+  EXPECT_EQ(kin.bodyCount() - 4, small.bodyCount());
+  ASSERT_EQ(kin.positionSize(), small.positionSize());
+  EXPECT_NEAR(full.totalMass(), lumped.totalMass(), 1e-12);
+  urdf::LoopConstraintModel loops, small_loops;
+  ASSERT_TRUE(loops.init(*model, kin));
+  ASSERT_TRUE(small_loops.init(*reduced, small));
+
+  // the same motion of both models, mapped by joint name
+  std::mt19937 rng(43);
+  const std::size_t nv = kin.velocitySize();
+  urdf::DynamicsData data(full), small_data(lumped);
+  std::vector<urdf::RigidTransform> poses(kin.bodyCount()), small_poses(small.bodyCount());
+  std::vector<double> tau(nv), small_tau(nv), phi(loops.rowCount()), small_phi(small_loops.rowCount());
+  for (int trial = 0; trial < 3; ++trial)
+  {
+    const std::vector<double> q = randomConfiguration(kin, rng);
+    const std::vector<double> v = randomVector(nv, rng, 2.0), a = randomVector(nv, rng, 3.0);
+    std::vector<double> sq(q.size()), sv(nv), sa(nv);
+    for (std::size_t i = 1; i < kin.bodyCount(); ++i)
+    {
+      const urdf::KinematicModel::Body &body = kin.body(i);
+      if (body.type == urdf::Joint::FIXED)
+        continue;
+      const urdf::KinematicModel::Body &other = small.body(small.jointIndex(kin.jointName(i)));
+      std::copy(&q[body.q_offset], &q[body.q_offset] + body.q_size, &sq[other.q_offset]);
+      std::copy(&v[body.v_offset], &v[body.v_offset] + body.v_size, &sv[other.v_offset]);
+      std::copy(&a[body.v_offset], &a[body.v_offset] + body.v_size, &sa[other.v_offset]);
+    }
+
+    kin.forwardKinematics(q.data(), poses.data());
+    small.forwardKinematics(sq.data(), small_poses.data());
+    for (std::size_t i = 0; i < kin.bodyCount(); ++i)
+    {
+      urdf::RigidTransform X;
+      frames.pose(small_poses.data(), frames.frameIndex(kin.linkName(i)), X);
+      for (int c = 0; c < 9; ++c)
+        EXPECT_NEAR(poses[i].R[c], X.R[c], 1e-12) << kin.linkName(i);
+      for (int c = 0; c < 3; ++c)
+        EXPECT_NEAR(poses[i].p[c], X.p[c], 1e-12) << kin.linkName(i);
+    }
+    loops.residual(poses.data(), phi.data());
+    small_loops.residual(small_poses.data(), small_phi.data());
+    for (std::size_t r = 0; r < phi.size(); ++r)
+      EXPECT_NEAR(phi[r], small_phi[r], 1e-12) << r;
+
+    full.inverseDynamics(data, q.data(), v.data(), a.data(), tau.data());
+    lumped.inverseDynamics(small_data, sq.data(), sv.data(), sa.data(), small_tau.data());
+    for (std::size_t i = 1; i < kin.bodyCount(); ++i)
+    {
+      const urdf::KinematicModel::Body &body = kin.body(i);
+      if (body.type == urdf::Joint::FIXED)
+        continue;
+      const urdf::KinematicModel::Body &other = small.body(small.jointIndex(kin.jointName(i)));
+      for (std::size_t k = 0; k < body.v_size; ++k)
+        EXPECT_NEAR(tau[body.v_offset + k], small_tau[other.v_offset + k], 1e-10) << kin.jointName(i);
+    }
+  }
+
+  // a loop whose two ends merge into one link constrains nothing and is
+  // dropped
+  std::string xml = sensorMounts();
+  xml.replace(xml.find("</robot>"), std::string("</robot>").size(),
+    "  <loop name=\"bracket\" type=\"fixed\">"
+    "    <predecessor link=\"flange\"/><successor link=\"tool\"/>"
+    "  </loop>"
+    "</robot>");
+  model = urdf::parseURDF(xml);
+  ASSERT_TRUE(model != nullptr);
+  ASSERT_TRUE(model->getConstraint("bracket") != nullptr);
+  reduced = urdf::lumpFixedJoints(*model, frames);
+  ASSERT_TRUE(reduced != nullptr);
+  EXPECT_TRUE(reduced->getConstraint("bracket") == nullptr);
+  EXPECT_TRUE(reduced->getConstraint("tool_loop") != nullptr);
+}
+
+int main(int argc, char **argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+
+  // use the environment locale so that the unit test can be repeated with various locales easily
+  setlocale(LC_ALL, "");
+
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,714 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <clocale>
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "urdf_parser/forward_kinematics_cache.h"
+#include "urdf_parser/inverse_kinematics.h"
+#include "urdf_parser/kinematics.h"
+#include "urdf_parser/loop_constraints.h"
+#include "urdf_parser/mimic_map.h"
+#include "urdf_parser/urdf_parser.h"
+
+// base -> j1 (revolute) -> l1 -> j2 (prismatic) -> l2 -> j3 (continuous) -> l3
+//                            \-> f1 (fixed) -> l4 -> j5 (revolute) -> l5
+// base -> p1 (planar) -> l6
+// base -> float (floating) -> l7 -> j8 (revolute) -> l8
+static const char *ROBOT =
+  "<robot name=\"test\">"
+  "  <link name=\"base\"/>"
+  "  <link name=\"l1\"/><link name=\"l2\"/><link name=\"l3\"/><link name=\"l4\"/>"
+  "  <link name=\"l5\"/><link name=\"l6\"/><link name=\"l7\"/><link name=\"l8\"/>"
+  "  <joint name=\"j1\" type=\"revolute\"><parent link=\"base\"/><child link=\"l1\"/>"
+  "    <origin xyz=\"0.1 0.2 0.3\" rpy=\"0.3 -0.2 0.1\"/><axis xyz=\"0 0 1\"/>"
+  "    <limit effort=\"1\" velocity=\"1\" lower=\"-3\" upper=\"3\"/></joint>"
+  "  <joint name=\"j2\" type=\"prismatic\"><parent link=\"l1\"/><child link=\"l2\"/>"
+  "    <origin xyz=\"0 0 0.5\" rpy=\"0 0.5 0\"/><axis xyz=\"1 1 0\"/>"
+  "    <limit effort=\"1\" velocity=\"1\" lower=\"-3\" upper=\"3\"/></joint>"
+  "  <joint name=\"j3\" type=\"continuous\"><parent link=\"l2\"/><child link=\"l3\"/>"
+  "    <origin xyz=\"0.2 0 0\" rpy=\"1.0 0 0\"/><axis xyz=\"0.3 -0.4 0.5\"/></joint>"
+  "  <joint name=\"f1\" type=\"fixed\"><parent link=\"l1\"/><child link=\"l4\"/>"
+  "    <origin xyz=\"0 0.3 0\" rpy=\"0 0 1.2\"/></joint>"
+  "  <joint name=\"j5\" type=\"revolute\"><parent link=\"l4\"/><child link=\"l5\"/>"
+  "    <origin xyz=\"0.1 0 -0.2\" rpy=\"0.4 0.4 0.4\"/><axis xyz=\"0 1 0\"/>"
+  "    <limit effort=\"1\" velocity=\"1\" lower=\"-3\" upper=\"3\"/></joint>"
+  "  <joint name=\"p1\" type=\"planar\"><parent link=\"base\"/><child link=\"l6\"/>"
+  "    <origin xyz=\"1 0 0\" rpy=\"0 0 0.7\"/><axis xyz=\"0 0 1\"/></joint>"
+  "  <joint name=\"float\" type=\"floating\"><parent link=\"base\"/><child link=\"l7\"/>"
+  "    <origin xyz=\"0 0 1\"/></joint>"
+  "  <joint name=\"j8\" type=\"revolute\"><parent link=\"l7\"/><child link=\"l8\"/>"
+  "    <origin xyz=\"0.3 0.1 0\" rpy=\"-0.3 0.2 0\"/><axis xyz=\"1 0 0\"/>"
+  "    <limit effort=\"1\" velocity=\"1\" lower=\"-3\" upper=\"3\"/></joint>"
+  "</robot>";
+
+// reference forward kinematics by chasing Link pointers with urdf::Pose math
+static urdf::Pose referencePose(const urdf::ModelInterface &model, const urdf::KinematicModel &kin,
+                                const std::string &link_name, const std::vector<double> &q)
+{
+  urdf::LinkConstSharedPtr link = model.getLink(link_name);
+  if (!link->parent_joint)
+    return urdf::Pose();
+
+  const urdf::Joint &joint = *link->parent_joint;
+  const urdf::KinematicModel::Body &body = kin.body(kin.jointIndex(joint.name));
+  const double *qi = &q[body.q_offset];
+  urdf::Vector3 axis(body.axis[0], body.axis[1], body.axis[2]);
+
+  urdf::Pose motion;
+  switch (joint.type)
+  {
+    case urdf::Joint::REVOLUTE:
+    case urdf::Joint::CONTINUOUS:
+      motion.rotation = urdf::Rotation(axis.x * std::sin(qi[0] / 2), axis.y * std::sin(qi[0] / 2),
+                                       axis.z * std::sin(qi[0] / 2), std::cos(qi[0] / 2));
+      break;
+    case urdf::Joint::PRISMATIC:
+      motion.position = urdf::Vector3(axis.x * qi[0], axis.y * qi[0], axis.z * qi[0]);
+      break;
+    case urdf::Joint::PLANAR:
+      motion.position = urdf::Vector3(qi[0] * body.plane_u[0] + qi[1] * body.plane_w[0],
+                                      qi[0] * body.plane_u[1] + qi[1] * body.plane_w[1],
+                                      qi[0] * body.plane_u[2] + qi[1] * body.plane_w[2]);
+      motion.rotation = urdf::Rotation(axis.x * std::sin(qi[2] / 2), axis.y * std::sin(qi[2] / 2),
+                                       axis.z * std::sin(qi[2] / 2), std::cos(qi[2] / 2));
+      break;
+    case urdf::Joint::FLOATING:
+      motion.position = urdf::Vector3(qi[0], qi[1], qi[2]);
+      motion.rotation = urdf::Rotation(qi[3], qi[4], qi[5], qi[6]);
+      motion.rotation.normalize();
+      break;
+    default:
+      break;
+  }
+
+  urdf::Pose parent = referencePose(model, kin, joint.parent_link_name, q);
+  urdf::Pose origin = joint.parent_to_joint_origin_transform;
+  urdf::Pose local;
+  local.rotation = origin.rotation * motion.rotation;
+  local.position = origin.position + origin.rotation * motion.position;
+  urdf::Pose world;
+  world.rotation = parent.rotation * local.rotation;
+  world.position = parent.position + parent.rotation * local.position;
+  return world;
+}
+
+static void expectPoseNear(const urdf::Pose &expected, const urdf::RigidTransform &actual, double tolerance)
+{
+  EXPECT_NEAR(expected.position.x, actual.p[0], tolerance);
+  EXPECT_NEAR(expected.position.y, actual.p[1], tolerance);
+  EXPECT_NEAR(expected.position.z, actual.p[2], tolerance);
+  const urdf::Vector3 axes[3] = {urdf::Vector3(1, 0, 0), urdf::Vector3(0, 1, 0), urdf::Vector3(0, 0, 1)};
+  for (int c = 0; c < 3; ++c)
+  {
+    const urdf::Vector3 column = expected.rotation * axes[c];
+    EXPECT_NEAR(column.x, actual.R[c], tolerance);
+    EXPECT_NEAR(column.y, actual.R[3 + c], tolerance);
+    EXPECT_NEAR(column.z, actual.R[6 + c], tolerance);
+  }
+}
+
+static std::vector<double> randomConfiguration(const urdf::KinematicModel &kin, std::mt19937 &rng)
+{
+  std::uniform_real_distribution<double> uniform(-2.0, 2.0);
+  std::vector<double> q(kin.positionSize());
+  for (double &value : q)
+    value = uniform(rng);
+  return q;
+}
+
+TEST(URDF_KINEMATICS, compile_model)
+{
+  urdf::ModelInterfaceSharedPtr model = urdf::parseURDF(ROBOT);
+  ASSERT_TRUE(model != nullptr);
+  urdf::KinematicModel kin;
+  ASSERT_TRUE(kin.init(*model));
+
+  ASSERT_EQ(9u, kin.bodyCount());
+  EXPECT_EQ(1u + 1u + 1u + 1u + 3u + 7u + 1u, kin.positionSize());
+  EXPECT_EQ(1u + 1u + 1u + 1u + 3u + 6u + 1u, kin.velocitySize());
+  EXPECT_EQ("base", kin.linkName(0));
+  EXPECT_EQ(-1, kin.body(0).parent);
+  EXPECT_EQ(kin.bodyCount(), kin.body(0).subtree_end);
+  for (std::size_t i = 1; i < kin.bodyCount(); ++i)
+  {
+    EXPECT_LT(kin.body(i).parent, static_cast<int>(i));
+    const std::size_t parent = kin.body(i).parent;
+    EXPECT_LE(kin.body(i).subtree_end, kin.body(parent).subtree_end);
+  }
+
+  const std::size_t l1 = kin.linkIndex("l1");
+  EXPECT_EQ(l1 + 5, kin.body(l1).subtree_end);
+  EXPECT_EQ(kin.jointIndex("f1"), kin.linkIndex("l4"));
+  EXPECT_EQ(urdf::Joint::FIXED, kin.body(kin.jointIndex("f1")).type);
+  EXPECT_EQ(0u, kin.body(kin.jointIndex("f1")).q_size);
+  EXPECT_EQ(kin.bodyCount(), kin.linkIndex("nothing"));
+
+  std::vector<double> q(kin.positionSize());
+  kin.neutralConfiguration(q.data());
+  EXPECT_EQ(1.0, q[kin.body(kin.jointIndex("float")).q_offset + 6]);
+}
+
+TEST(URDF_KINEMATICS, forward_kinematics_matches_reference)
+{
+  urdf::ModelInterfaceSharedPtr model = urdf::parseURDF(ROBOT);
+  ASSERT_TRUE(model != nullptr);
+  urdf::KinematicModel kin;
+  ASSERT_TRUE(kin.init(*model));
+
+  std::mt19937 rng(42);
+  std::vector<urdf::RigidTransform> poses(kin.bodyCount());
+  for (int trial = 0; trial < 20; ++trial)
+  {
+    std::vector<double> q = randomConfiguration(kin, rng);
+    kin.forwardKinematics(q.data(), poses.data());
+    for (std::size_t i = 0; i < kin.bodyCount(); ++i)
+      expectPoseNear(referencePose(*model, kin, kin.linkName(i), q), poses[i], 1e-12);
+  }
+}
+
+TEST(URDF_KINEMATICS, batched_forward_kinematics)
+{
+  urdf::ModelInterfaceSharedPtr model = urdf::parseURDF(ROBOT);
+  ASSERT_TRUE(model != nullptr);
+  urdf::KinematicModel kin;
+  ASSERT_TRUE(kin.init(*model));
+
+  // not a multiple of the internal block size
+  const std::size_t count = 150;
+  std::mt19937 rng(7);
+  std::vector<std::vector<double> > configurations;
+  std::vector<double> q(kin.positionSize() * count);
+  for (std::size_t n = 0; n < count; ++n)
+  {
+    configurations.push_back(randomConfiguration(kin, rng));
+    for (std::size_t k = 0; k < kin.positionSize(); ++k)
+      q[k * count + n] = configurations[n][k];
+  }
+
+  std::vector<double> poses(12 * kin.bodyCount() * count);
+  kin.forwardKinematicsBatch(count, q.data(), poses.data());
+
+  std::vector<urdf::RigidTransform> expected(kin.bodyCount());
+  for (std::size_t n = 0; n < count; ++n)
+  {
+    kin.forwardKinematics(configurations[n].data(), expected.data());
+    for (std::size_t i = 0; i < kin.bodyCount(); ++i)
+    {
+      for (int c = 0; c < 9; ++c)
+        EXPECT_NEAR(expected[i].R[c], poses[(12 * i + c) * count + n], 1e-12);
+      for (int c = 0; c < 3; ++c)
+        EXPECT_NEAR(expected[i].p[c], poses[(12 * i + 9 + c) * count + n], 1e-12);
+    }
+  }
+}
+
+TEST(URDF_KINEMATICS, jacobian_matches_finite_differences)
+{
+  urdf::ModelInterfaceSharedPtr model = urdf::parseURDF(ROBOT);
+  ASSERT_TRUE(model != nullptr);
+  urdf::KinematicModel kin;
+  ASSERT_TRUE(kin.init(*model));
+
+  // l3 is moved by j1, j2 and j3; l4 only by j1
+  const std::size_t l3 = kin.linkIndex("l3");
+  ASSERT_EQ(3u, kin.supportSize(l3));
+  EXPECT_EQ(kin.jointIndex("j1"), kin.support(l3)[0]);
+  EXPECT_EQ(kin.jointIndex("j3"), kin.support(l3)[2]);
+  EXPECT_EQ(1u, kin.supportSize(kin.linkIndex("l4")));
+  EXPECT_EQ(0u, kin.supportSize(0));
+
+  const std::size_t nv = kin.velocitySize();
+  const double point[3] = {0.1, -0.2, 0.3};
+  const double h = 1e-6;
+  std::mt19937 rng(3);
+  std::vector<urdf::RigidTransform> poses(kin.bodyCount()), plus(kin.bodyCount()), minus(kin.bodyCount());
+  std::vector<double> J(6 * nv), qp(kin.positionSize()), qm(kin.positionSize()), v(nv);
+  for (int trial = 0; trial < 5; ++trial)
+  {
+    std::vector<double> q = randomConfiguration(kin, rng);
+    kin.forwardKinematics(q.data(), poses.data());
+    for (std::size_t i = 0; i < kin.bodyCount(); ++i)
+    {
+      kin.jacobian(poses.data(), i, point, J.data());
+      for (std::size_t k = 0; k < nv; ++k)
+      {
+        std::fill(v.begin(), v.end(), 0.0);
+        v[k] = 1.0;
+        kin.integrate(q.data(), v.data(), h, qp.data());
+        kin.integrate(q.data(), v.data(), -h, qm.data());
+        kin.forwardKinematics(qp.data(), plus.data());
+        kin.forwardKinematics(qm.data(), minus.data());
+
+        // linear velocity of the point, and angular velocity from dR R^T
+        const urdf::RigidTransform &a = plus[i], &b = minus[i], &r = poses[i];
+        for (int c = 0; c < 3; ++c)
+        {
+          const double pa = a.R[3 * c] * point[0] + a.R[3 * c + 1] * point[1] + a.R[3 * c + 2] * point[2] + a.p[c];
+          const double pb = b.R[3 * c] * point[0] + b.R[3 * c + 1] * point[1] + b.R[3 * c + 2] * point[2] + b.p[c];
+          EXPECT_NEAR((pa - pb) / (2 * h), J[(3 + c) * nv + k], 1e-6) << kin.linkName(i) << " " << k;
+        }
+        double W[9];
+        for (int row = 0; row < 3; ++row)
+          for (int col = 0; col < 3; ++col)
+          {
+            W[3 * row + col] = 0.0;
+            for (int e = 0; e < 3; ++e)
+              W[3 * row + col] += (a.R[3 * row + e] - b.R[3 * row + e]) / (2 * h) * r.R[3 * col + e];
+          }
+        EXPECT_NEAR(W[7], J[0 * nv + k], 1e-6);
+        EXPECT_NEAR(W[2], J[1 * nv + k], 1e-6);
+        EXPECT_NEAR(W[3], J[2 * nv + k], 1e-6);
+      }
+    }
+
+    // batched Jacobians agree with the single body ones
+    std::vector<std::size_t> bodies;
+    std::vector<double> points;
+    for (std::size_t i = kin.bodyCount(); i-- > 0;)
+    {
+      bodies.push_back(i);
+      points.insert(points.end(), point, point + 3);
+    }
+    std::vector<double> batch(6 * nv * bodies.size()), work(kin.jacobiansWorkSize());
+    kin.jacobians(poses.data(), bodies.size(), bodies.data(), points.data(), batch.data(), work.data());
+    for (std::size_t m = 0; m < bodies.size(); ++m)
+    {
+      kin.jacobian(poses.data(), bodies[m], point, J.data());
+      for (std::size_t k = 0; k < 6 * nv; ++k)
+        EXPECT_NEAR(J[k], batch[6 * nv * m + k], 1e-15);
+    }
+  }
+}
+
+// A floating body with two arms closed on each other by loops of every
+// type, and a planar carriage closed on the world.
+//
+// world -> base (floating) -> body -> a1 (revolute) -> arm_a -> a2 (revolute) -> hand_a
+//                                 \-> b1 (prismatic) -> arm_b -> b2 (continuous) -> hand_b
+//       -> cart (planar) -> carriage
+static const char *LOOP_ROBOT =
+  "<robot name=\"loops\">"
+  "  <link name=\"world\"/><link name=\"body\"/><link name=\"arm_a\"/><link name=\"hand_a\"/>"
+  "  <link name=\"arm_b\"/><link name=\"hand_b\"/><link name=\"carriage\"/>"
+  "  <joint name=\"base\" type=\"floating\"><parent link=\"world\"/><child link=\"body\"/>"
+  "    <origin xyz=\"0 0 1\"/></joint>"
+  "  <joint name=\"a1\" type=\"revolute\"><parent link=\"body\"/><child link=\"arm_a\"/>"
+  "    <origin xyz=\"0.1 0.2 0\" rpy=\"0.2 0 0\"/><axis xyz=\"0 1 0\"/>"
+  "    <limit effort=\"1\" velocity=\"1\" lower=\"-3\" upper=\"3\"/></joint>"
+  "  <joint name=\"a2\" type=\"revolute\"><parent link=\"arm_a\"/><child link=\"hand_a\"/>"
+  "    <origin xyz=\"0 0 -0.3\"/><axis xyz=\"1 0 0.5\"/>"
+  "    <limit effort=\"1\" velocity=\"1\" lower=\"-3\" upper=\"3\"/></joint>"
+  "  <joint name=\"b1\" type=\"prismatic\"><parent link=\"body\"/><child link=\"arm_b\"/>"
+  "    <origin xyz=\"-0.1 0.2 0\" rpy=\"0 0.3 0\"/><axis xyz=\"0 0 1\"/>"
+  "    <limit effort=\"1\" velocity=\"1\" lower=\"-3\" upper=\"3\"/></joint>"
+  "  <joint name=\"b2\" type=\"continuous\"><parent link=\"arm_b\"/><child link=\"hand_b\"/>"
+  "    <origin xyz=\"0 0.1 -0.3\" rpy=\"0 0 0.4\"/><axis xyz=\"0 1 1\"/></joint>"
+  "  <joint name=\"cart\" type=\"planar\"><parent link=\"world\"/><child link=\"carriage\"/>"
+  "    <origin xyz=\"2 0 0\" rpy=\"0.2 0 0\"/><axis xyz=\"0 0 1\"/></joint>"
+  "  <loop name=\"hands\" type=\"revolute\">"
+  "    <predecessor link=\"hand_a\"><origin xyz=\"0.05 0 -0.1\" rpy=\"0.1 0.2 0.3\"/></predecessor>"
+  "    <successor link=\"hand_b\"><origin xyz=\"0 0 -0.1\"/></successor>"
+  "    <axis xyz=\"0 1 0\"/>"
+  "  </loop>"
+  "  <loop name=\"arms\" type=\"prismatic\">"
+  "    <predecessor link=\"arm_b\"><origin xyz=\"0 0 -0.2\"/></predecessor>"
+  "    <successor link=\"arm_a\"><origin xyz=\"0.2 0 0\" rpy=\"0 0.5 0\"/></successor>"
+  "    <axis xyz=\"1 0 0\"/>"
+  "  </loop>"
+  "  <loop name=\"weld\" type=\"fixed\">"
+  "    <predecessor link=\"body\"><origin xyz=\"0 0 -0.4\"/></predecessor>"
+  "    <successor link=\"hand_b\"><origin xyz=\"0.1 0 0\" rpy=\"-0.3 0 0.2\"/></successor>"
+  "  </loop>"
+  "  <loop name=\"floor\" type=\"planar\">"
+  "    <predecessor link=\"world\"><origin xyz=\"2 0 0\"/></predecessor>"
+  "    <successor link=\"carriage\"><origin xyz=\"0 0 -0.1\" rpy=\"0.1 0 0\"/></successor>"
+  "    <axis xyz=\"0 0 1\"/>"
+  "  </loop>"
+  "</robot>";
+
+TEST(URDF_KINEMATICS, loop_constraint_structure)
+{
+  urdf::ModelInterfaceSharedPtr model = urdf::parseURDF(LOOP_ROBOT);
+  ASSERT_TRUE(model != nullptr);
+  urdf::KinematicModel kin;
+  ASSERT_TRUE(kin.init(*model));
+  urdf::LoopConstraintModel loops;
+  ASSERT_TRUE(loops.init(*model, kin));
+
+  // rows in the order of the constraint map: arms, floor, hands, weld
+  ASSERT_EQ(4u, loops.constraintCount());
+  EXPECT_EQ(5u + 3u + 5u + 6u, loops.rowCount());
+  EXPECT_EQ("arms", loops.constraint(0).name);
+  EXPECT_EQ(5u, loops.constraint(0).rows);
+  EXPECT_EQ(5u, loops.constraint(1).row);
+
+  // the floating base is common to both arms and drops out of hands and
+  // arms; the weld keeps only the arm_b side
+  const urdf::LoopConstraintModel::Constraint &arms = loops.constraint(0);
+  std::vector<std::size_t> expected = {kin.body(kin.jointIndex("a1")).v_offset,
+                                       kin.body(kin.jointIndex("b1")).v_offset};
+  std::sort(expected.begin(), expected.end());
+  ASSERT_EQ(2u, arms.column_end - arms.column_begin);
+  EXPECT_EQ(expected[0], loops.columns()[arms.column_begin]);
+  EXPECT_EQ(expected[1], loops.columns()[arms.column_begin + 1]);
+  EXPECT_EQ(3u, loops.constraint(1).column_end - loops.constraint(1).column_begin);
+  EXPECT_EQ(4u, loops.constraint(2).column_end - loops.constraint(2).column_begin);
+  EXPECT_EQ(2u, loops.constraint(3).column_end - loops.constraint(3).column_begin);
+  EXPECT_EQ(5u * 2u + 3u * 3u + 5u * 4u + 6u * 2u, loops.valueCount());
+
+  // unknown links are rejected
+  urdf::LoopConstraintSharedPtr bad(new urdf::LoopConstraint);
+  bad->name = "bad";
+  bad->type = urdf::LoopConstraint::FIXED;
+  bad->predecessor_link_name = "body";
+  bad->successor_link_name = "nowhere";
+  model->constraints_["bad"] = bad;
+  EXPECT_FALSE(loops.init(*model, kin));
+  EXPECT_EQ(0u, loops.rowCount());
+}
+
+TEST(URDF_KINEMATICS, loop_constraints_match_finite_differences)
+{
+  urdf::ModelInterfaceSharedPtr model = urdf::parseURDF(LOOP_ROBOT);
+  ASSERT_TRUE(model != nullptr);
+  urdf::KinematicModel kin;
+  ASSERT_TRUE(kin.init(*model));
+  urdf::LoopConstraintModel loops;
+  ASSERT_TRUE(loops.init(*model, kin));
+
+  const std::size_t nv = kin.velocitySize(), rows = loops.rowCount();
+  const double h = 1e-6;
+  std::mt19937 rng(5);
+  std::uniform_real_distribution<double> uniform(-1.0, 1.0);
+  std::vector<urdf::RigidTransform> poses(kin.bodyCount()), plus(kin.bodyCount()), minus(kin.bodyCount());
+  std::vector<double> K(rows * nv), Kp(rows * nv), Km(rows * nv), values(loops.valueCount());
+  std::vector<double> phi(rows), phi_p(rows), phi_m(rows), k(rows);
+  std::vector<double> qp(kin.positionSize()), qm(kin.positionSize()), v(nv);
+  for (int trial = 0; trial < 5; ++trial)
+  {
+    std::vector<double> q = randomConfiguration(kin, rng);
+    double *quaternion = &q[kin.body(kin.jointIndex("base")).q_offset + 3];
+    const double norm = std::sqrt(quaternion[0] * quaternion[0] + quaternion[1] * quaternion[1] +
+                                  quaternion[2] * quaternion[2] + quaternion[3] * quaternion[3]);
+    for (int c = 0; c < 4; ++c)
+      quaternion[c] /= norm;
+    kin.forwardKinematics(q.data(), poses.data());
+    loops.jacobian(poses.data(), K.data());
+
+    // K is the derivative of the residual
+    for (std::size_t c = 0; c < nv; ++c)
+    {
+      std::fill(v.begin(), v.end(), 0.0);
+      v[c] = 1.0;
+      kin.integrate(q.data(), v.data(), h, qp.data());
+      kin.integrate(q.data(), v.data(), -h, qm.data());
+      kin.forwardKinematics(qp.data(), plus.data());
+      kin.forwardKinematics(qm.data(), minus.data());
+      loops.residual(plus.data(), phi_p.data());
+      loops.residual(minus.data(), phi_m.data());
+      for (std::size_t r = 0; r < rows; ++r)
+        EXPECT_NEAR((phi_p[r] - phi_m[r]) / (2 * h), K[r * nv + c], 1e-6) << r << " " << c;
+    }
+
+    // the sparse blocks hold every nonzero of K
+    loops.sparseJacobian(poses.data(), values.data());
+    std::vector<double> dense(rows * nv, 0.0);
+    for (std::size_t c = 0; c < loops.constraintCount(); ++c)
+    {
+      const urdf::LoopConstraintModel::Constraint &constraint = loops.constraint(c);
+      const std::size_t columns = constraint.column_end - constraint.column_begin;
+      for (std::size_t r = 0; r < constraint.rows; ++r)
+        for (std::size_t j = 0; j < columns; ++j)
+          dense[(constraint.row + r) * nv + loops.columns()[constraint.column_begin + j]] =
+            values[constraint.value_offset + r * columns + j];
+    }
+    for (std::size_t e = 0; e < rows * nv; ++e)
+      EXPECT_NEAR(K[e], dense[e], 1e-15);
+
+    // the bias is the rate of K v along v
+    for (double &value : v)
+      value = uniform(rng);
+    loops.bias(poses.data(), v.data(), k.data());
+    kin.integrate(q.data(), v.data(), h, qp.data());
+    kin.integrate(q.data(), v.data(), -h, qm.data());
+    kin.forwardKinematics(qp.data(), plus.data());
+    kin.forwardKinematics(qm.data(), minus.data());
+    loops.jacobian(plus.data(), Kp.data());
+    loops.jacobian(minus.data(), Km.data());
+    for (std::size_t r = 0; r < rows; ++r)
+    {
+      double rate = 0.0;
+      for (std::size_t c = 0; c < nv; ++c)
+        rate += (Kp[r * nv + c] - Km[r * nv + c]) / (2 * h) * v[c];
+      EXPECT_NEAR(rate, k[r], 1e-5) << r;
+    }
+  }
+}
+
+TEST(URDF_KINEMATICS, mimic_map)
+{
+  // j3 mimics j2, which mimics j1; j8 mimics j3 across the tree
+  urdf::ModelInterfaceSharedPtr model = urdf::parseURDF(ROBOT);
+  ASSERT_TRUE(model != nullptr);
+  model->joints_["j2"]->mimic.reset(new urdf::JointMimic);
+  model->joints_["j2"]->mimic->joint_name = "j1";
+  model->joints_["j2"]->mimic->multiplier = 2.0;
+  model->joints_["j2"]->mimic->offset = 0.1;
+  model->joints_["j3"]->mimic.reset(new urdf::JointMimic);
+  model->joints_["j3"]->mimic->joint_name = "j2";
+  model->joints_["j3"]->mimic->multiplier = -0.5;
+  model->joints_["j3"]->mimic->offset = 0.2;
+  model->joints_["j8"]->mimic.reset(new urdf::JointMimic);
+  model->joints_["j8"]->mimic->joint_name = "j3";
+  model->joints_["j8"]->mimic->multiplier = 3.0;
+  model->joints_["j8"]->mimic->offset = 0.0;
+  urdf::KinematicModel kin;
+  ASSERT_TRUE(kin.init(*model));
+  urdf::MimicMap mimic;
+  ASSERT_TRUE(mimic.init(*model, kin));
+
+  const std::size_t nq = kin.positionSize(), nv = kin.velocitySize();
+  EXPECT_EQ(nq - 3, mimic.activePositionSize());
+  EXPECT_EQ(nv - 3, mimic.activeVelocitySize());
+  const std::size_t j1 = kin.jointIndex("j1"), j3 = kin.jointIndex("j3"), j8 = kin.jointIndex("j8");
+  EXPECT_EQ(-1.0, mimic.multiplier(kin.body(j3).q_offset));
+  EXPECT_NEAR(-0.5 * 0.1 + 0.2, mimic.offset(kin.body(j3).q_offset), 1e-15);
+  EXPECT_EQ(mimic.positionSource(kin.body(j1).q_offset), mimic.positionSource(kin.body(j8).q_offset));
+
+  std::mt19937 rng(11);
+  const std::size_t count = 4;
+  std::vector<double> a(count * mimic.activePositionSize()), q(count * nq), back(a.size());
+  std::uniform_real_distribution<double> uniform(-1.0, 1.0);
+  for (double &value : a)
+    value = uniform(rng);
+  mimic.applyPositions(count, a.data(), q.data());
+  mimic.gatherPositions(count, q.data(), back.data());
+  for (std::size_t k = 0; k < a.size(); ++k)
+    EXPECT_EQ(a[k], back[k]);
+  for (std::size_t n = 0; n < count; ++n)
+  {
+    const double *qn = &q[n * nq];
+    const double q1 = qn[kin.body(j1).q_offset], q2 = 2.0 * q1 + 0.1, q3 = -0.5 * q2 + 0.2;
+    EXPECT_NEAR(q2, qn[kin.body(kin.jointIndex("j2")).q_offset], 1e-15);
+    EXPECT_NEAR(q3, qn[kin.body(j3).q_offset], 1e-15);
+    EXPECT_NEAR(3.0 * q3, qn[kin.body(j8).q_offset], 1e-15);
+  }
+
+  // the force map is the transpose of the velocity map
+  std::vector<double> va(count * mimic.activeVelocitySize()), v(count * nv), tau(count * nv), fa(va.size());
+  for (double &value : va)
+    value = uniform(rng);
+  for (double &value : tau)
+    value = uniform(rng);
+  mimic.applyVelocities(count, va.data(), v.data());
+  mimic.applyTranspose(count, tau.data(), fa.data());
+  double vtau = 0.0, vafa = 0.0;
+  for (std::size_t k = 0; k < v.size(); ++k)
+    vtau += v[k] * tau[k];
+  for (std::size_t k = 0; k < va.size(); ++k)
+    vafa += va[k] * fa[k];
+  EXPECT_NEAR(vtau, vafa, 1e-12);
+
+  // cycles and unknown joints are rejected
+  model->joints_["j1"]->mimic.reset(new urdf::JointMimic);
+  model->joints_["j1"]->mimic->joint_name = "j3";
+  model->joints_["j1"]->mimic->multiplier = 1.0;
+  EXPECT_FALSE(mimic.init(*model, kin));
+  EXPECT_EQ(0u, mimic.positionSize());
+  model->joints_["j1"]->mimic->joint_name = "nowhere";
+  EXPECT_FALSE(mimic.init(*model, kin));
+}
+
+TEST(URDF_KINEMATICS, forward_kinematics_cache)
+{
+  urdf::ModelInterfaceSharedPtr model = urdf::parseURDF(ROBOT);
+  ASSERT_TRUE(model != nullptr);
+  urdf::KinematicModel kin;
+  ASSERT_TRUE(kin.init(*model));
+  urdf::ForwardKinematicsCache cache(kin);
+  const std::size_t bodies = kin.bodyCount();
+  std::vector<urdf::RigidTransform> expected(bodies);
+
+  std::mt19937 rng(41);
+  std::vector<double> q = randomConfiguration(kin, rng);
+  cache.setConfiguration(q.data());
+  for (std::size_t i = 1; i < bodies; ++i)
+    EXPECT_TRUE(cache.stale(i));
+
+  // a query brings only the path to its body up to date
+  const std::size_t l3 = kin.linkIndex("l3"), l5 = kin.linkIndex("l5"), l1 = kin.linkIndex("l1");
+  kin.forwardKinematics(q.data(), expected.data());
+  const urdf::RigidTransform &tip = cache.pose(l3);
+  for (int c = 0; c < 3; ++c)
+    EXPECT_NEAR(expected[l3].p[c], tip.p[c], 1e-12);
+  EXPECT_FALSE(cache.stale(l1));
+  EXPECT_TRUE(cache.stale(l5));
+  EXPECT_TRUE(cache.stale(kin.linkIndex("l8")));
+
+  // changing j5 leaves the rest of the tree alone; a changed j1 marks both
+  // branches under it, and setting an equal value marks nothing
+  cache.poses();
+  q[kin.body(kin.jointIndex("j5")).q_offset] += 0.3;
+  cache.setConfiguration(q.data());
+  for (std::size_t i = 0; i < bodies; ++i)
+    EXPECT_EQ(i == l5, cache.stale(i)) << i;
+  cache.poses();
+  cache.setPosition(kin.body(kin.jointIndex("j5")).q_offset, q[kin.body(kin.jointIndex("j5")).q_offset]);
+  EXPECT_FALSE(cache.stale(l5));
+  const double j1 = q[kin.body(kin.jointIndex("j1")).q_offset] - 0.2;
+  cache.setJointPositions(kin.jointIndex("j1"), &j1);
+  q[kin.body(kin.jointIndex("j1")).q_offset] = j1;
+  for (std::size_t i = 0; i < bodies; ++i)
+    EXPECT_EQ(i >= l1 && i < kin.body(l1).subtree_end, cache.stale(i)) << i;
+
+  // random sparse updates and queries agree with full recomputation
+  std::uniform_int_distribution<std::size_t> coordinate(0, kin.positionSize() - 1), body(0, bodies - 1);
+  std::uniform_real_distribution<double> uniform(-2.0, 2.0);
+  for (int trial = 0; trial < 200; ++trial)
+  {
+    const std::size_t k = coordinate(rng);
+    q[k] = uniform(rng);
+    cache.setPosition(k, q[k]);
+    kin.forwardKinematics(q.data(), expected.data());
+    const std::size_t i = body(rng);
+    const urdf::RigidTransform &X = trial % 10 == 9 ? cache.poses()[i] : cache.pose(i);
+    for (int c = 0; c < 9; ++c)
+      EXPECT_NEAR(expected[i].R[c], X.R[c], 1e-12) << i;
+    for (int c = 0; c < 3; ++c)
+      EXPECT_NEAR(expected[i].p[c], X.p[c], 1e-12) << i;
+  }
+}
+
+// a seven joint arm with one prismatic joint, on the planar base of a mobile
+// platform, which inverse kinematics keeps fixed
+static const char *ARM =
+  "<robot name=\"arm\">"
+  "  <link name=\"world\"/><link name=\"cart\"/>"
+  "  <link name=\"a1\"/><link name=\"a2\"/><link name=\"a3\"/><link name=\"a4\"/>"
+  "  <link name=\"a5\"/><link name=\"a6\"/><link name=\"a7\"/><link name=\"hand\"/>"
+  "  <joint name=\"cart\" type=\"planar\"><parent link=\"world\"/><child link=\"cart\"/>"
+  "    <axis xyz=\"0 0 1\"/></joint>"
+  "  <joint name=\"s1\" type=\"revolute\"><parent link=\"cart\"/><child link=\"a1\"/>"
+  "    <origin xyz=\"0 0 0.3\"/><axis xyz=\"0 0 1\"/>"
+  "    <limit effort=\"1\" velocity=\"1\" lower=\"-2.5\" upper=\"2.5\"/></joint>"
+  "  <joint name=\"s2\" type=\"revolute\"><parent link=\"a1\"/><child link=\"a2\"/>"
+  "    <origin xyz=\"0 0 0.1\"/><axis xyz=\"0 1 0\"/>"
+  "    <limit effort=\"1\" velocity=\"1\" lower=\"-1.8\" upper=\"1.8\"/></joint>"
+  "  <joint name=\"lift\" type=\"prismatic\"><parent link=\"a2\"/><child link=\"a3\"/>"
+  "    <origin xyz=\"0 0 0.2\"/><axis xyz=\"0 0 1\"/>"
+  "    <limit effort=\"1\" velocity=\"1\" lower=\"0\" upper=\"0.3\"/></joint>"
+  "  <joint name=\"e1\" type=\"revolute\"><parent link=\"a3\"/><child link=\"a4\"/>"
+  "    <origin xyz=\"0 0 0.2\"/><axis xyz=\"0 1 0\"/>"
+  "    <limit effort=\"1\" velocity=\"1\" lower=\"-2.2\" upper=\"2.2\"/></joint>"
+  "  <joint name=\"w1\" type=\"continuous\"><parent link=\"a4\"/><child link=\"a5\"/>"
+  "    <origin xyz=\"0 0 0.25\"/><axis xyz=\"0 0 1\"/></joint>"
+  "  <joint name=\"w2\" type=\"revolute\"><parent link=\"a5\"/><child link=\"a6\"/>"
+  "    <origin xyz=\"0 0 0.05\"/><axis xyz=\"0 1 0\"/>"
+  "    <limit effort=\"1\" velocity=\"1\" lower=\"-2\" upper=\"2\"/></joint>"
+  "  <joint name=\"w3\" type=\"revolute\"><parent link=\"a6\"/><child link=\"a7\"/>"
+  "    <origin xyz=\"0 0 0.05\"/><axis xyz=\"0 0 1\"/>"
+  "    <limit effort=\"1\" velocity=\"1\" lower=\"-3\" upper=\"3\"/></joint>"
+  "  <joint name=\"palm\" type=\"fixed\"><parent link=\"a7\"/><child link=\"hand\"/>"
+  "    <origin xyz=\"0.02 0 0.1\" rpy=\"0 0.3 0\"/></joint>"
+  "</robot>";
+
+TEST(URDF_KINEMATICS, inverse_kinematics)
+{
+  urdf::ModelInterfaceSharedPtr model = urdf::parseURDF(ARM);
+  ASSERT_TRUE(model != nullptr);
+  urdf::KinematicModel kin;
+  ASSERT_TRUE(kin.init(*model));
+  urdf::InverseKinematics ik;
+  EXPECT_FALSE(ik.init(*model, kin, "nowhere"));
+  ASSERT_TRUE(ik.init(*model, kin, "hand"));
+  ASSERT_EQ(7u, ik.chainSize());
+  EXPECT_TRUE(ik.chainJoint(2).limited);
+  EXPECT_EQ(0.3, ik.chainJoint(2).upper);
+  EXPECT_FALSE(ik.chainJoint(4).limited);
+
+  // targets reached by configurations within the limits, solved from
+  // perturbed warm starts
+  std::mt19937 rng(37);
+  std::uniform_real_distribution<double> unit(0.0, 1.0), noise(-0.3, 0.3);
+  const std::size_t nq = kin.positionSize(), count = 64;
+  std::vector<double> start(count * nq), q(count * nq), reached(count * nq);
+  std::vector<urdf::RigidTransform> targets(count), poses(kin.bodyCount());
+  for (std::size_t n = 0; n < count; ++n)
+  {
+    double *qn = &reached[n * nq];
+    qn[0] = 0.5;
+    qn[1] = -0.2;
+    qn[2] = 0.4;
+    for (std::size_t k = 0; k < ik.chainSize(); ++k)
+    {
+      const urdf::InverseKinematics::ChainJoint &joint = ik.chainJoint(k);
+      const double lower = joint.limited ? joint.lower : -3.0, upper = joint.limited ? joint.upper : 3.0;
+      qn[joint.q_offset] = lower + (upper - lower) * (0.1 + 0.8 * unit(rng));
+      start[n * nq + joint.q_offset] = qn[joint.q_offset] + noise(rng);
+    }
+    std::copy(qn, qn + 3, &start[n * nq]);
+    kin.forwardKinematics(qn, poses.data());
+    targets[n] = poses[kin.linkIndex("hand")];
+  }
+
+  urdf::InverseKinematicsOptions options;
+  options.threads = 4;
+  std::vector<urdf::InverseKinematicsStatus> status(count);
+  EXPECT_TRUE(ik.solve(count, targets.data(), start.data(), q.data(), status.data(), options));
+  for (std::size_t n = 0; n < count; ++n)
+  {
+    EXPECT_TRUE(status[n].converged) << n;
+    EXPECT_GT(status[n].iterations, 0u);
+    EXPECT_LE(status[n].position_error, options.position_tolerance);
+    EXPECT_LE(status[n].orientation_error, options.orientation_tolerance);
+    const double *qn = &q[n * nq];
+    for (int k = 0; k < 3; ++k)
+      EXPECT_EQ(start[n * nq + k], qn[k]);
+    for (std::size_t k = 0; k < ik.chainSize(); ++k)
+    {
+      const urdf::InverseKinematics::ChainJoint &joint = ik.chainJoint(k);
+      EXPECT_LE(joint.lower, qn[joint.q_offset]);
+      EXPECT_GE(joint.upper, qn[joint.q_offset]);
+    }
+    kin.forwardKinematics(qn, poses.data());
+    const urdf::RigidTransform &hand = poses[kin.linkIndex("hand")];
+    for (int c = 0; c < 3; ++c)
+      EXPECT_NEAR(targets[n].p[c], hand.p[c], 1e-6);
+    for (int c = 0; c < 9; ++c)
+      EXPECT_NEAR(targets[n].R[c], hand.R[c], 1e-6);
+
+    // the batch solves each query as a single solve would
+    std::vector<double> single(start.begin() + n * nq, start.begin() + (n + 1) * nq);
+    urdf::InverseKinematicsStatus alone;
+    ik.solve(targets[n], single.data(), &alone, options);
+    EXPECT_EQ(status[n].iterations, alone.iterations);
+    for (std::size_t k = 0; k < nq; ++k)
+      EXPECT_EQ(qn[k], single[k]);
+  }
+
+  // a target out of reach stops at the iteration limit, the lift at its
+  // upper limit
+  urdf::RigidTransform far = targets[0];
+  far.p[2] = 5.0;
+  std::vector<double> stretched(start.begin(), start.begin() + nq);
+  urdf::InverseKinematicsStatus failed;
+  options.position_only = true;
+  EXPECT_FALSE(ik.solve(far, stretched.data(), &failed, options));
+  EXPECT_FALSE(failed.converged);
+  EXPECT_EQ(options.max_iterations, failed.iterations);
+  EXPECT_NEAR(0.3, stretched[ik.chainJoint(2).q_offset], 1e-12);
+}
+
+int main(int argc, char **argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+
+  // use the environment locale so that the unit test can be repeated with various locales easily
+  setlocale(LC_ALL, "");
+
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,415 @@
+#include <gtest/gtest.h>
+
+#include <clocale>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <urdf_model/utils.h>
+
+#include "urdf_parser/joint_state_binding.h"
+#include "urdf_parser/model_state_log.h"
+#include "urdf_parser/model_state_reader.h"
+#include "urdf_parser/urdf_parser.h"
+
+TEST(URDF_MODEL_STATE, read_all_records_and_joint_states)
+{
+  std::istringstream stream(
+    "<?xml version=\"1.0\"?>"
+    "<model_states>"
+    "  <!-- <model_state name=\"commented\"/> -->"
+    "  <model_state name=\"robot\" time_stamp=\"1.5\">"
+    "    <joint_state joint=\"j1\" position=\"0.1 -2.5e-3  7\" velocity=\"1\" effort=\"3.25\"/>"
+    "    <joint_state joint=\"j2\" position=\"0.2\"/>"
+    "  </model_state>"
+    "  <model_state name=\"robot\" time_stamp=\"2.25\">"
+    "    <joint_state joint=\"j1\" position=\"1.5\"/>"
+    "  </model_state>"
+    "  <model_state name=\"empty\"/>"
+    "</model_states>");
+
+  urdf::ModelStateReader reader;
+  reader.open(stream);
+  urdf::ModelState ms;
+
+  ASSERT_TRUE(reader.next(ms));
+  EXPECT_EQ("robot", ms.name);
+  EXPECT_EQ(1, ms.time_stamp.sec);
+  EXPECT_EQ(500000000, ms.time_stamp.nsec);
+  ASSERT_EQ(2u, ms.joint_states.size());
+  EXPECT_EQ("j1", ms.joint_states[0]->joint);
+  ASSERT_EQ(3u, ms.joint_states[0]->position.size());
+  EXPECT_EQ(0.1, ms.joint_states[0]->position[0]);
+  EXPECT_EQ(-2.5e-3, ms.joint_states[0]->position[1]);
+  EXPECT_EQ(7.0, ms.joint_states[0]->position[2]);
+  ASSERT_EQ(1u, ms.joint_states[0]->velocity.size());
+  EXPECT_EQ(1.0, ms.joint_states[0]->velocity[0]);
+  ASSERT_EQ(1u, ms.joint_states[0]->effort.size());
+  EXPECT_EQ(3.25, ms.joint_states[0]->effort[0]);
+  EXPECT_EQ("j2", ms.joint_states[1]->joint);
+  ASSERT_EQ(1u, ms.joint_states[1]->position.size());
+  EXPECT_EQ(0.2, ms.joint_states[1]->position[0]);
+
+  const urdf::JointState *reused = ms.joint_states[0].get();
+  ASSERT_TRUE(reader.next(ms));
+  EXPECT_EQ(2, ms.time_stamp.sec);
+  ASSERT_EQ(1u, ms.joint_states.size());
+  EXPECT_EQ(reused, ms.joint_states[0].get());
+  ASSERT_EQ(1u, ms.joint_states[0]->position.size());
+  EXPECT_EQ(1.5, ms.joint_states[0]->position[0]);
+  EXPECT_TRUE(ms.joint_states[0]->velocity.empty());
+
+  ASSERT_TRUE(reader.next(ms));
+  EXPECT_EQ("empty", ms.name);
+  EXPECT_TRUE(ms.joint_states.empty());
+
+  EXPECT_FALSE(reader.next(ms));
+  EXPECT_FALSE(reader.failed());
+  EXPECT_EQ(3u, reader.recordCount());
+}
+
+TEST(URDF_MODEL_STATE, number_conversion_matches_strtod)
+{
+  const char *numbers[] = {"0", "-0.0", "1e3", "3.14159265358979", "0.30000000000000004",
+                           "123456789012345678901234", "1.7976931348623157e308", "4.9e-324",
+                           "-.5", "+2.", "6.02214076E23", "1e-30"};
+  std::string values;
+  for (const char *n : numbers)
+    values += std::string(n) + " ";
+
+  std::istringstream stream("<model_state name=\"m\"><joint_state joint=\"j\" position=\"" + values + "\"/></model_state>");
+  urdf::ModelStateReader reader;
+  reader.open(stream);
+  urdf::ModelState ms;
+  ASSERT_TRUE(reader.next(ms));
+  ASSERT_EQ(sizeof(numbers) / sizeof(numbers[0]), ms.joint_states[0]->position.size());
+  for (std::size_t i = 0; i < ms.joint_states[0]->position.size(); ++i)
+    EXPECT_EQ(urdf::strToDouble(numbers[i]), ms.joint_states[0]->position[i]) << numbers[i];
+}
+
+TEST(URDF_MODEL_STATE, malformed_records)
+{
+  std::istringstream bad_number("<model_state name=\"m\"><joint_state joint=\"j\" position=\"1 foo\"/></model_state>");
+  urdf::ModelStateReader reader;
+  reader.open(bad_number);
+  urdf::ModelState ms;
+  EXPECT_FALSE(reader.next(ms));
+  EXPECT_TRUE(reader.failed());
+
+  std::istringstream truncated("<model_state name=\"m\"><joint_state joint=\"j\" position=\"1\"/>");
+  reader.open(truncated);
+  EXPECT_FALSE(reader.next(ms));
+  EXPECT_TRUE(reader.failed());
+
+  std::istringstream trailing_junk("<model_state name=\"m\" time_stamp=\"1.5 junk\"/>");
+  reader.open(trailing_junk);
+  EXPECT_FALSE(reader.next(ms));
+  EXPECT_TRUE(reader.failed());
+
+  EXPECT_FALSE(reader.open("/nonexistent/model_states.xml"));
+}
+
+TEST(URDF_MODEL_STATE, record_across_chunk_boundary)
+{
+  // the reader pulls its input in 1 MiB chunks: pad the document so that the
+  // second position value of the record is split between two of them
+  const std::string record =
+    "<model_state name=\"robot\" time_stamp=\" 3.5 \">"
+    "<joint_state joint=\"j1\" position=\"0.125 0.25 0.5\" velocity=\"-1\"/>"
+    "</model_state>";
+  const std::size_t chunk = 1 << 20;
+  std::string xml = "<model_states>";
+  xml.append(chunk - xml.size() - record.find("0.25") - 2, ' ');
+  xml += record + record + "</model_states>";
+  ASSERT_EQ("0.", xml.substr(chunk - 2, 2));
+
+  std::istringstream stream(xml);
+  urdf::ModelStateReader reader;
+  reader.open(stream);
+  urdf::ModelState ms;
+  for (int n = 0; n < 2; ++n)
+  {
+    ASSERT_TRUE(reader.next(ms));
+    EXPECT_EQ(3, ms.time_stamp.sec);
+    EXPECT_EQ(500000000, ms.time_stamp.nsec);
+    ASSERT_EQ(1u, ms.joint_states.size());
+    ASSERT_EQ(3u, ms.joint_states[0]->position.size());
+    EXPECT_EQ(0.125, ms.joint_states[0]->position[0]);
+    EXPECT_EQ(0.25, ms.joint_states[0]->position[1]);
+    EXPECT_EQ(0.5, ms.joint_states[0]->position[2]);
+    ASSERT_EQ(1u, ms.joint_states[0]->velocity.size());
+    EXPECT_EQ(-1.0, ms.joint_states[0]->velocity[0]);
+  }
+  EXPECT_FALSE(reader.next(ms));
+  EXPECT_FALSE(reader.failed());
+}
+
+static urdf::ModelState makeState(int i)
+{
+  urdf::ModelState ms;
+  ms.name = "robot";
+  ms.time_stamp.sec = i / 1000;
+  ms.time_stamp.nsec = (i % 1000) * 1000000;
+  for (int j = 0; j < 3; ++j)
+  {
+    urdf::JointStateSharedPtr js(new urdf::JointState());
+    js->joint = "j" + std::to_string(j);
+    js->position.push_back(0.001 * i + j);
+    if (j != 1)
+      js->velocity.push_back(-0.5 * j);
+    js->effort.push_back(j == 2 ? 1e-3 * i * i : 0.0);
+    ms.joint_states.push_back(js);
+  }
+  return ms;
+}
+
+TEST(URDF_MODEL_STATE, log_round_trip_and_seek)
+{
+  const std::string path = ::testing::TempDir() + "urdf_model_state_log_" +
+                           std::to_string(std::random_device()()) + ".bin";
+  const int records = 2500;
+  {
+    urdf::ModelStateLogWriter writer;
+    ASSERT_TRUE(writer.open(path, makeState(0), 1000));
+    for (int i = 0; i < records; ++i)
+      ASSERT_TRUE(writer.append(makeState(i)));
+    urdf::ModelState wrong = makeState(0);
+    wrong.joint_states.pop_back();
+    EXPECT_FALSE(writer.append(wrong));
+    EXPECT_FALSE(writer.append(makeState(records - 1)));
+    EXPECT_FALSE(writer.append(makeState(records - 2)));
+    std::vector<double> row(writer.layout().columnCount(), 0.0);
+    EXPECT_FALSE(writer.append(static_cast<int64_t>(records - 1) * 1000000, row.data()));
+    EXPECT_EQ(static_cast<std::size_t>(records), writer.recordCount());
+  }
+
+  urdf::ModelStateLogReader reader;
+  ASSERT_TRUE(reader.open(path));
+  ASSERT_EQ(static_cast<std::size_t>(records), reader.recordCount());
+  const urdf::ModelStateLogLayout &layout = reader.layout();
+  EXPECT_EQ("robot", layout.model_name);
+  ASSERT_EQ(3u, layout.joints.size());
+  EXPECT_EQ(8u, layout.columnCount());
+  EXPECT_EQ(0, reader.startTime());
+  EXPECT_EQ(static_cast<int64_t>(records - 1) * 1000000, reader.endTime());
+
+  urdf::ModelState ms;
+  for (int i : {0, 999, 1000, 1777, records - 1})
+  {
+    ASSERT_TRUE(reader.read(i, ms));
+    urdf::ModelState expected = makeState(i);
+    EXPECT_EQ(expected.time_stamp.sec, ms.time_stamp.sec);
+    EXPECT_EQ(expected.time_stamp.nsec, ms.time_stamp.nsec);
+    ASSERT_EQ(3u, ms.joint_states.size());
+    for (int j = 0; j < 3; ++j)
+    {
+      EXPECT_EQ(expected.joint_states[j]->joint, ms.joint_states[j]->joint);
+      EXPECT_EQ(expected.joint_states[j]->position, ms.joint_states[j]->position);
+      EXPECT_EQ(expected.joint_states[j]->velocity, ms.joint_states[j]->velocity);
+      EXPECT_EQ(expected.joint_states[j]->effort, ms.joint_states[j]->effort);
+    }
+  }
+
+  EXPECT_EQ(0u, reader.seek(-5));
+  EXPECT_EQ(1500u, reader.seek(1500000000));
+  EXPECT_EQ(1501u, reader.seek(1500000001));
+  EXPECT_EQ(static_cast<std::size_t>(records), reader.seek(static_cast<int64_t>(records) * 1000000));
+
+  // a batch spanning a block boundary, structure-of-arrays
+  const std::size_t count = 10;
+  std::vector<int64_t> times(count);
+  std::vector<double> values(count * layout.columnCount());
+  ASSERT_EQ(count, reader.read(995, count, times.data(), values.data()));
+  for (std::size_t i = 0; i < count; ++i)
+  {
+    urdf::ModelState expected = makeState(995 + static_cast<int>(i));
+    EXPECT_EQ(static_cast<int64_t>(995 + i) * 1000000, times[i]);
+    EXPECT_EQ(expected.joint_states[2]->position[0], values[layout.position_offset[2] * count + i]);
+    EXPECT_EQ(expected.joint_states[2]->velocity[0], values[layout.velocity_offset[2] * count + i]);
+    EXPECT_EQ(expected.joint_states[2]->effort[0], values[layout.effort_offset[2] * count + i]);
+  }
+  EXPECT_EQ(5u, reader.read(records - 5, count, times.data(), nullptr));
+
+  reader.close();
+  std::remove(path.c_str());
+}
+
+TEST(URDF_MODEL_STATE, log_corrupt_block_keeps_cache_valid)
+{
+  const std::string path = ::testing::TempDir() + "urdf_model_state_log_" +
+                           std::to_string(std::random_device()()) + ".bin";
+  {
+    urdf::ModelStateLogWriter writer;
+    ASSERT_TRUE(writer.open(path, makeState(0), 10));
+    for (int i = 0; i < 20; ++i)
+      ASSERT_TRUE(writer.append(makeState(i)));
+  }
+
+  // shrink the payload of the second block to one byte per time stamp and
+  // column, so that it is still indexed but runs out of data half way
+  // through decoding
+  {
+    std::fstream file(path.c_str(), std::ios::in | std::ios::out | std::ios::binary);
+    std::string contents((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    std::size_t second = contents.find("SBLK", contents.find("SBLK") + 4);
+    ASSERT_NE(std::string::npos, second);
+    const char payload[8] = {10 * 9, 0, 0, 0, 0, 0, 0, 0};
+    file.clear();
+    file.seekp(static_cast<std::streamoff>(second + 8));
+    file.write(payload, sizeof(payload));
+  }
+
+  urdf::ModelStateLogReader reader;
+  ASSERT_TRUE(reader.open(path));
+  ASSERT_EQ(20u, reader.recordCount());
+
+  urdf::ModelState ms;
+  ASSERT_TRUE(reader.read(3, ms));
+  EXPECT_FALSE(reader.read(13, ms));
+  ASSERT_TRUE(reader.read(0, ms));
+  urdf::ModelState expected = makeState(0);
+  EXPECT_EQ(expected.time_stamp.sec, ms.time_stamp.sec);
+  EXPECT_EQ(expected.time_stamp.nsec, ms.time_stamp.nsec);
+  EXPECT_EQ(expected.joint_states[2]->position, ms.joint_states[2]->position);
+
+  int64_t time = -1;
+  EXPECT_EQ(1u, reader.read(0, 1, &time, nullptr));
+  EXPECT_EQ(0, time);
+
+  reader.close();
+  std::remove(path.c_str());
+}
+
+static void putU32(std::string &s, uint32_t v)
+{
+  for (int i = 0; i < 4; ++i)
+    s.push_back(static_cast<char>((v >> (8 * i)) & 0xff));
+}
+
+static std::string logHeader(uint32_t capacity, uint32_t positions)
+{
+  std::string s("UMSLOG2", 8);
+  putU32(s, capacity);
+  putU32(s, 5);
+  s += "robot";
+  putU32(s, 1);
+  putU32(s, 1);
+  s += "j";
+  putU32(s, positions);
+  putU32(s, 0);
+  putU32(s, 0);
+  return s;
+}
+
+TEST(URDF_MODEL_STATE, log_header_cannot_exhaust_memory)
+{
+  const std::string path = ::testing::TempDir() + "urdf_model_state_log_" +
+                           std::to_string(std::random_device()()) + ".bin";
+  urdf::ModelStateLogReader reader;
+
+  // more columns than the file has bytes
+  {
+    std::ofstream file(path.c_str(), std::ios::binary);
+    file << logHeader(0xffffffffu, 0x40000000u);
+  }
+  EXPECT_FALSE(reader.open(path));
+
+  // a huge capacity and a block claiming more records than its payload holds
+  {
+    std::string contents = logHeader(0xffffffffu, 1);
+    putU32(contents, 0x4b4c4253);
+    putU32(contents, 0xfffffff0u);
+    putU32(contents, 4);
+    putU32(contents, 0);
+    contents.append(16 + 4, '\0');
+    std::ofstream file(path.c_str(), std::ios::binary);
+    file << contents;
+  }
+  ASSERT_TRUE(reader.open(path));
+  EXPECT_EQ(0u, reader.recordCount());
+
+  reader.close();
+  std::remove(path.c_str());
+}
+
+TEST(URDF_MODEL_STATE, joint_state_binding)
+{
+  urdf::ModelInterfaceSharedPtr model = urdf::parseURDF(
+    "<robot name=\"r\">"
+    "  <link name=\"base\"/><link name=\"plate\"/><link name=\"arm\"/><link name=\"slider\"/><link name=\"free\"/>"
+    "  <joint name=\"a_fixed\" type=\"fixed\"><parent link=\"base\"/><child link=\"plate\"/></joint>"
+    "  <joint name=\"b_free\" type=\"floating\"><parent link=\"base\"/><child link=\"free\"/></joint>"
+    "  <joint name=\"c_arm\" type=\"continuous\"><parent link=\"plate\"/><child link=\"arm\"/></joint>"
+    "  <joint name=\"d_slide\" type=\"planar\"><parent link=\"arm\"/><child link=\"slider\"/></joint>"
+    "</robot>");
+  ASSERT_TRUE(model);
+
+  urdf::ModelState ms;
+  ms.name = "r";
+  const char *names[] = {"d_slide", "a_fixed", "c_arm"};
+  const std::size_t widths[] = {3, 0, 1};
+  for (int j = 0; j < 3; ++j)
+  {
+    urdf::JointStateSharedPtr js(new urdf::JointState());
+    js->joint = names[j];
+    for (std::size_t k = 0; k < widths[j]; ++k)
+    {
+      js->position.push_back(10.0 * j + k);
+      js->velocity.push_back(-10.0 * j - k);
+    }
+    ms.joint_states.push_back(js);
+  }
+
+  urdf::JointStateBinding binding;
+  ASSERT_TRUE(binding.init(*model, ms));
+  ASSERT_EQ(3u, binding.modelJoints().size());
+  EXPECT_EQ("c_arm", binding.modelJoints()[0]);
+  EXPECT_EQ("d_slide", binding.modelJoints()[1]);
+  EXPECT_EQ("b_free", binding.modelJoints()[2]);
+  EXPECT_EQ(11u, binding.positionSize());
+  EXPECT_EQ(10u, binding.velocitySize());
+  EXPECT_EQ(4u, binding.boundPositionSize());
+  EXPECT_TRUE(binding.matches(ms));
+
+  std::vector<double> q(binding.positionSize(), -1.0), v(binding.velocitySize(), -1.0);
+  ASSERT_TRUE(binding.scatter(ms, q.data(), v.data(), nullptr));
+  EXPECT_EQ(20.0, q[0]);
+  EXPECT_EQ(0.0, q[1]);
+  EXPECT_EQ(2.0, q[3]);
+  EXPECT_EQ(-1.0, q[4]);
+  EXPECT_EQ(-2.0, v[3]);
+
+  q[2] = 5.0;
+  ASSERT_TRUE(binding.gather(q.data(), nullptr, nullptr, ms));
+  EXPECT_EQ(5.0, ms.joint_states[0]->position[1]);
+
+  double flat[4];
+  binding.gatherPositions(q.data(), flat);
+  EXPECT_EQ(0.0, flat[0]);
+  EXPECT_EQ(5.0, flat[1]);
+  EXPECT_EQ(20.0, flat[3]);
+  flat[3] = 7.0;
+  binding.scatterPositions(flat, q.data());
+  EXPECT_EQ(7.0, q[0]);
+
+  ms.joint_states[2]->position.push_back(1.0);
+  EXPECT_FALSE(binding.matches(ms));
+  EXPECT_FALSE(binding.scatter(ms, q.data(), nullptr, nullptr));
+
+  EXPECT_FALSE(binding.init(*model, std::vector<std::string>{"c_arm", "nope"}));
+  EXPECT_FALSE(binding.init(*model, std::vector<std::string>{"c_arm", "c_arm"}));
+}
+
+int main(int argc, char **argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+
+  // use the environment locale so that the unit test can be repeated with various locales easily
+  setlocale(LC_ALL, "");
+
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,145 @@
+#include <gtest/gtest.h>
+
+#include <clocale>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "urdf_parser/camera_model.h"
+#include "urdf_parser/ray_table.h"
+
+#ifndef M_PI
+  # define M_PI 3.141592653589793
+#endif
+
+TEST(URDF_SENSOR, ray_table_directions_and_points)
+{
+  urdf::Ray ray;
+  ray.horizontal_samples = 5;
+  ray.horizontal_min_angle = -M_PI / 2;
+  ray.horizontal_max_angle = M_PI / 2;
+  ray.vertical_samples = 3;
+  ray.vertical_min_angle = -0.2;
+  ray.vertical_max_angle = 0.2;
+
+  urdf::Pose origin;
+  origin.position = urdf::Vector3(1.0, 2.0, 3.0);
+  origin.rotation.setFromRPY(0.0, 0.0, M_PI / 2);
+
+  urdf::RayTable table;
+  ASSERT_TRUE(table.init(ray, origin));
+  ASSERT_EQ(15u, table.size());
+  EXPECT_EQ(0u, reinterpret_cast<std::uintptr_t>(table.directionX()) % 64);
+  EXPECT_EQ(0u, reinterpret_cast<std::uintptr_t>(table.directionZ(urdf::RayTable::LINK_FRAME)) % 64);
+
+  // middle ring, straight ahead
+  const std::size_t ahead = 1 * 5 + 2;
+  EXPECT_NEAR(1.0, table.directionX()[ahead], 1e-12);
+  EXPECT_NEAR(0.0, table.directionY()[ahead], 1e-12);
+  // top ring, leftmost ray
+  const std::size_t left_up = 2 * 5 + 4;
+  EXPECT_NEAR(0.0, table.directionX()[left_up], 1e-12);
+  EXPECT_NEAR(std::cos(0.2), table.directionY()[left_up], 1e-12);
+  EXPECT_NEAR(std::sin(0.2), table.directionZ()[left_up], 1e-12);
+
+  std::vector<double> ranges(table.size(), 2.0), x(table.size()), y(table.size()), z(table.size());
+  table.toPoints(ranges.data(), x.data(), y.data(), z.data());
+  EXPECT_NEAR(2.0, x[ahead], 1e-12);
+
+  // the sensor looks along the link y axis
+  table.toPoints(ranges.data(), x.data(), y.data(), z.data(), urdf::RayTable::LINK_FRAME);
+  EXPECT_NEAR(1.0, x[ahead], 1e-12);
+  EXPECT_NEAR(4.0, y[ahead], 1e-12);
+  EXPECT_NEAR(3.0, z[ahead], 1e-12);
+
+  table.toPoints(left_up, 1, &ranges[0], &x[0], &y[0], &z[0], urdf::RayTable::LINK_FRAME);
+  EXPECT_NEAR(1.0 - 2.0 * std::cos(0.2), x[0], 1e-12);
+  EXPECT_NEAR(2.0, y[0], 1e-12);
+  EXPECT_NEAR(3.0 + 2.0 * std::sin(0.2), z[0], 1e-12);
+
+  // resolution scales the number of returned ranges
+  ray.horizontal_resolution = 2.0;
+  ray.vertical_resolution = 0.5;
+  ASSERT_TRUE(table.init(ray));
+  EXPECT_EQ(10u, table.horizontalCount());
+  EXPECT_EQ(2u, table.verticalCount());
+  EXPECT_NEAR(std::cos(-0.2) * std::cos(-M_PI / 2 + 2 * M_PI / 9), table.directionX()[2], 1e-12);
+  EXPECT_NEAR(std::sin(0.2), table.directionZ()[10], 1e-12);
+  ray.vertical_resolution = 0.0;
+  EXPECT_FALSE(table.init(ray));
+
+  ray.vertical_resolution = 1.0;
+  ray.horizontal_samples = 0;
+  EXPECT_FALSE(table.init(ray));
+  EXPECT_EQ(0u, table.size());
+}
+
+TEST(URDF_SENSOR, camera_model_projection)
+{
+  urdf::Camera camera;
+  camera.width = 640;
+  camera.height = 480;
+  camera.hfov = M_PI / 2;
+  camera.near = 0.1;
+  camera.far = 10.0;
+
+  urdf::CameraModel model;
+  ASSERT_TRUE(model.init(camera));
+  EXPECT_NEAR(320.0, model.fx(), 1e-9);
+  EXPECT_EQ(320.0, model.cx());
+  EXPECT_EQ(240.0, model.cy());
+  EXPECT_NEAR(2.0 * std::atan(0.75), model.verticalFov(), 1e-12);
+
+  const double x[] = {0.0, 0.9, -0.5, 0.0, 0.0, 3.0};
+  const double y[] = {0.0, 0.0, 0.25, 0.0, 0.0, 0.0};
+  const double z[] = {2.0, 1.0, 1.0, 0.05, 20.0, -1.0};
+  double u[6], v[6];
+  model.project(6, x, y, z, u, v);
+  EXPECT_EQ(320.0, u[0]);
+  EXPECT_EQ(240.0, v[0]);
+  EXPECT_NEAR(608.0, u[1], 1e-9);
+  EXPECT_NEAR(160.0, u[2], 1e-9);
+  EXPECT_NEAR(320.0, v[2], 1e-9);
+  EXPECT_TRUE(std::isnan(u[5]));
+
+  double px[6], py[6], pz[6];
+  model.unproject(3, u, v, z, px, py, pz);
+  for (int i = 0; i < 3; ++i)
+  {
+    EXPECT_NEAR(x[i], px[i], 1e-12);
+    EXPECT_NEAR(y[i], py[i], 1e-12);
+    EXPECT_EQ(z[i], pz[i]);
+  }
+
+  uint8_t inside[6];
+  EXPECT_EQ(3u, model.cull(6, x, y, z, inside));
+  EXPECT_EQ(1, inside[0]);
+  EXPECT_EQ(1, inside[1]);
+  EXPECT_EQ(1, inside[2]);
+  EXPECT_EQ(0, inside[3]);
+  EXPECT_EQ(0, inside[4]);
+  EXPECT_EQ(0, inside[5]);
+  EXPECT_EQ(3u, model.cullDepth(6, z, inside));
+
+  // every point in the frustum is on the inner side of all planes
+  for (std::size_t p = 0; p < urdf::CameraModel::PLANE_COUNT; ++p)
+  {
+    const urdf::CameraModel::Plane &plane = model.plane(p);
+    EXPECT_GE(plane.normal[0] * x[2] + plane.normal[1] * y[2] + plane.normal[2] * z[2] + plane.offset, 0.0);
+  }
+  const urdf::CameraModel::Plane &right = model.plane(urdf::CameraModel::RIGHT_PLANE);
+  EXPECT_LT(right.normal[0] * 2.0 + right.normal[2] * 1.0 + right.offset, 0.0);
+
+  camera.near = 0.0;
+  EXPECT_FALSE(model.init(camera));
+}
+
+int main(int argc, char **argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+
+  // use the environment locale so that the unit test can be repeated with various locales easily
+  setlocale(LC_ALL, "");
+
+  return RUN_ALL_TESTS();
+}
@@ -2,10 +2,13 @@
 #include <iostream>
 #include <iomanip>
 #include <cmath>
+#include <cstdio>
+#include <fstream>
 #include <vector>
 
 #include "urdf_model/pose.h"
 #include "urdf_parser/urdf_parser.h"
+#include "urdf_parser/world_parser.h"
 
 #ifndef M_PI
   # define M_PI 3.141592653589793
@@ -420,6 +423,144 @@ TEST(URDF_UNIT_TEST, parse_constraint)
 
 }
 
+TEST(URDF_UNIT_TEST, parse_sensors)
+{
+  std::string robot_str =
+    "<robot name=\"test\">"
+    "  <link name=\"base_link\"/>"
+    "  <link name=\"head\"/>"
+    "  <joint name=\"neck\" type=\"fixed\">"
+    "    <parent link=\"base_link\"/>"
+    "    <child link=\"head\"/>"
+    "  </joint>"
+    "  <sensor name=\"lidar\">"
+    "    <parent link=\"base_link\"/>"
+    "    <origin xyz=\"0 0 0.5\"/>"
+    "    <ray>"
+    "      <horizontal samples=\"720\" resolution=\"1\" min_angle=\"-1.5\" max_angle=\"1.5\"/>"
+    "    </ray>"
+    "  </sensor>"
+    "  <sensor name=\"left_eye\" parent_link_name=\"head\">"
+    "    <camera><image width=\"640\" height=\"480\" format=\"RGB8\" hfov=\"1.0\" near=\"0.01\" far=\"50.0\"/></camera>"
+    "  </sensor>"
+    "  <sensor name=\"imu\"><parent link=\"head\"/><imu/></sensor>"
+    "  <sensor name=\"right_eye\" parent_link_name=\"head\">"
+    "    <camera><image width=\"320\" height=\"240\" format=\"RGB8\" hfov=\"1.0\" near=\"0.01\" far=\"50.0\"/></camera>"
+    "  </sensor>"
+    "</robot>";
+
+  urdf::SensorTable sensors;
+  urdf::ModelInterfaceSharedPtr urdf = urdf::parseURDF(robot_str, sensors);
+  ASSERT_TRUE(urdf != nullptr);
+  ASSERT_EQ(3u, sensors.size());
+  ASSERT_EQ(2u, sensors.linkCount());
+
+  std::size_t head = sensors.linkIndex("head");
+  ASSERT_LT(head, sensors.linkCount());
+  ASSERT_EQ(2u, sensors.sensorCount(head));
+  EXPECT_EQ("left_eye", sensors.sensor(sensors.firstSensor(head)).name);
+  EXPECT_EQ("right_eye", sensors.sensor(sensors.firstSensor(head) + 1).name);
+  EXPECT_EQ(head, sensors.sensorLink(sensors.firstSensor(head)));
+  EXPECT_EQ(sensors.linkCount(), sensors.linkIndex("nose"));
+
+  const urdf::Sensor *lidar = sensors.findSensor("lidar");
+  ASSERT_TRUE(lidar != nullptr);
+  EXPECT_EQ("base_link", lidar->parent_link_name);
+  EXPECT_EQ(0.5, lidar->origin.position.z);
+  ASSERT_TRUE(lidar->sensor != nullptr);
+  ASSERT_EQ(urdf::VisualSensor::RAY, lidar->sensor->type);
+  EXPECT_EQ(720u, std::static_pointer_cast<urdf::Ray>(lidar->sensor)->horizontal_samples);
+
+  const urdf::Sensor *right_eye = sensors.findSensor("right_eye");
+  ASSERT_TRUE(right_eye != nullptr);
+  ASSERT_EQ(urdf::VisualSensor::CAMERA, right_eye->sensor->type);
+  EXPECT_EQ(320u, std::static_pointer_cast<urdf::Camera>(right_eye->sensor)->width);
+  EXPECT_TRUE(sensors.findSensor("imu") == nullptr);
+
+  // sensors on unknown links and duplicate sensor names fail the load
+  std::string bad_link = robot_str;
+  bad_link.replace(bad_link.find("parent_link_name=\"head\""), 23, "parent_link_name=\"nose\"");
+  EXPECT_TRUE(urdf::parseURDF(bad_link, sensors) == nullptr);
+  EXPECT_TRUE(sensors.empty());
+
+  std::string duplicate = robot_str;
+  duplicate.replace(duplicate.find("right_eye"), 9, "left_eye");
+  EXPECT_TRUE(urdf::parseURDF(duplicate, sensors) == nullptr);
+
+  // the plain overload ignores sensors
+  EXPECT_TRUE(urdf::parseURDF(bad_link) != nullptr);
+}
+
+TEST(URDF_UNIT_TEST, parse_world)
+{
+  const std::string dir = ::testing::TempDir();
+  {
+    std::ofstream arm((dir + "urdf_world_arm.urdf").c_str());
+    arm << "<robot name=\"arm\">"
+           "  <link name=\"base\"/><link name=\"tool\"/>"
+           "  <joint name=\"j1\" type=\"continuous\"><parent link=\"base\"/><child link=\"tool\"/></joint>"
+           "</robot>";
+    std::ofstream table((dir + "urdf_world_table.urdf").c_str());
+    table << "<robot name=\"table\"><link name=\"top\"/></robot>";
+  }
+
+  std::string world_str =
+    "<world name=\"cell\">"
+    "  <include filename=\"urdf_world_arm.urdf\" model_name=\"arm\"/>"
+    "  <include filename=\"urdf_world_table.urdf\" model_name=\"table\"/>"
+    "  <include filename=\"urdf_world_arm.urdf\" model_name=\"same_arm\"/>"
+    "  <entity model=\"arm\" name=\"left\"><origin xyz=\"0 0.5 0\"/></entity>"
+    "  <entity model=\"same_arm\" name=\"right\">"
+    "    <origin xyz=\"0 -0.5 0\" rpy=\"0 0 3.14159265\"/><twist linear=\"0.1 0 0\"/>"
+    "  </entity>"
+    "  <entity model=\"table\" name=\"table\"/>"
+    "</world>";
+
+  urdf::WorldDescription world;
+  ASSERT_TRUE(urdf::parseWorld(world_str, world, dir));
+  EXPECT_EQ("cell", world.world.name);
+  ASSERT_EQ(2u, world.models.size());
+  ASSERT_EQ(3u, world.instances.size());
+  ASSERT_EQ(3u, world.world.models.size());
+
+  // both arms share one parsed model
+  EXPECT_EQ(world.instances[0].model, world.instances[1].model);
+  EXPECT_TRUE(world.world.models[0].model == world.world.models[1].model);
+  EXPECT_EQ("arm", world.world.models[0].model->getName());
+  EXPECT_EQ("table", world.world.models[2].model->getName());
+  EXPECT_EQ(0.5, world.world.models[0].origin.position.y);
+  EXPECT_EQ(-0.5, world.world.models[1].origin.position.y);
+  EXPECT_EQ(0.1, world.world.models[1].twist.linear.x);
+
+  EXPECT_EQ(1u, world.findInstance("right"));
+  EXPECT_EQ(3u, world.findInstance("nobody"));
+  EXPECT_EQ("right/tool", world.qualifiedName(1, "tool"));
+  EXPECT_GT(world.models[0].load_seconds, 0.0);
+  EXPECT_GE(world.load_seconds, world.models[1].load_seconds);
+
+  // the result does not depend on the size of the loading pool
+  urdf::WorldDescription serial;
+  ASSERT_TRUE(urdf::parseWorld(world_str, serial, dir, 1));
+  ASSERT_EQ(world.models.size(), serial.models.size());
+  for (std::size_t i = 0; i < world.models.size(); ++i)
+  {
+    EXPECT_EQ(world.models[i].filename, serial.models[i].filename);
+    EXPECT_EQ(world.models[i].model->getName(), serial.models[i].model->getName());
+  }
+
+  std::string missing = world_str;
+  missing.replace(missing.find("model=\"table\""), 13, "model=\"chair\"");
+  EXPECT_FALSE(urdf::parseWorld(missing, world, dir));
+  EXPECT_TRUE(world.instances.empty());
+
+  std::string duplicate = world_str;
+  duplicate.replace(duplicate.find("name=\"right\""), 12, "name=\"left\"");
+  EXPECT_FALSE(urdf::parseWorld(duplicate, world, dir));
+
+  std::remove((dir + "urdf_world_arm.urdf").c_str());
+  std::remove((dir + "urdf_world_table.urdf").c_str());
+}
+
 int main(int argc, char **argv)
 {
   ::testing::InitGoogleTest(&argc, argv);